@@ -47,6 +47,11 @@ F_NONNULL
 const char* gdmaps_logf_dclist(const gdmaps_t* gdmaps, const unsigned gdmap_idx, const uint8_t* dclist);
 F_NONNULL
 const uint8_t* gdmaps_lookup(const gdmaps_t* gdmaps, const unsigned gdmap_idx, const client_info_t* client, unsigned* scope_mask);
+// The generation of the map's current runtime data, which changes every
+//   time it's reloaded.  If this is fetched before a gdmaps_lookup(), the
+//   lookup's result is from that generation of the map or a later one.
+F_NONNULL
+unsigned gdmaps_map_gen(const gdmaps_t* gdmaps, const unsigned gdmap_idx);
 F_NONNULL
 void gdmaps_setup_watchers(gdmaps_t* gdmaps);
 
@@ -25,6 +25,11 @@
 // Kill+Reap pids from gdnsd_register_child_pid()
 void gdnsd_kill_registered_children(void);
 
+// Seeds the PRNG init interfaces of <gdnsd/misc.h>.  This is done by
+//   gdnsd_initialize(), and is only for helper binaries which use them
+//   without it.  Must be called only once, before any gdnsd_randXX_init().
+void gdnsd_rand_meta_init(void);
+
 #pragma GCC visibility pop
 
 #endif // GDNSD_MISC_PROT_H
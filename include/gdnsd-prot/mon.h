@@ -52,9 +52,15 @@ void gdnsd_mon_cfg_stypes_p2(vscf_data_t* svctypes_cfg);
 //    but can't be loaded correctly
 void gdnsd_mon_check_admin_file(void);
 
-// main.c calls this for adding monio events to the main thread's eventloop
+// main.c calls this for adding monio events to the main thread's eventloop,
+//   and for setting up "mon_threads" monitoring shards (see
+//   gdnsd_mon_get_loop()), the first of which is mon_loop itself.
 F_NONNULL
-void gdnsd_mon_start(struct ev_loop* mon_loop);
+void gdnsd_mon_start(struct ev_loop* mon_loop, const unsigned mon_threads);
+
+// main.c calls this to start the threads of the additional monitoring
+//   shards, with all signals blocked.
+void gdnsd_mon_start_threads(void);
 
 // statio.c calls these
 unsigned gdnsd_mon_stats_get_max_len(void);
@@ -65,6 +71,12 @@ unsigned gdnsd_mon_stats_out_json(char* buf);
 F_NONNULL
 unsigned gdnsd_mon_stats_out_html(char* buf);
 
+// statio.c calls these for the check history output, where glob
+//   optionally selects services by name as in admin_state
+unsigned gdnsd_mon_hist_get_max_len(void);
+F_NONNULLX(1)
+unsigned gdnsd_mon_hist_out_json(char* buf, const char* glob);
+
 #pragma GCC visibility pop
 
 #endif // GDNSD_MON_PROT_H
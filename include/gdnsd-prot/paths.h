@@ -0,0 +1,36 @@
+/* Copyright © 2012 Brandon L Black <blblack@gmail.com>
+ *
+ * This file is part of gdnsd.
+ *
+ * gdnsd is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gdnsd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gdnsd.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef GDNSD_PATHS_PROT_H
+#define GDNSD_PATHS_PROT_H
+
+#include <gdnsd/vscf.h>
+
+#pragma GCC visibility push(default)
+
+// For commandline tools which must load a second, independent config
+//   directory after gdnsd_initialize() (e.g. gdnsd_geoip_test -C).
+//   Re-points the config directory used by gdnsd_resolve_path_cfg()
+//   and returns the parsed config file from the new directory (or NULL
+//   if it has none).  The run/state directories are left unchanged.
+vscf_data_t* gdnsd_reinit_cfg_dir(const char* config_dir);
+
+#pragma GCC visibility pop
+
+#endif // GDNSD_PATHS_PROT_H
@@ -58,6 +58,37 @@ unsigned gdnsd_result_get_v6_offset(void);
 F_PURE
 unsigned gdnsd_result_get_alloc(void);
 
+// Empties the calling I/O thread's scratch arena (see
+//   gdnsd_scratch_alloc()), called by dnspacket.c at the start of each
+//   query.  Any allocations which overflowed the arena since the last
+//   reset are freed here, and the arena is grown to fit them.
+void gdnsd_scratch_reset(void);
+
+// A plugin which is linked into the daemon itself rather than loaded
+//   via dlopen(), see --enable-builtin-plugins.  The callbacks are the
+//   same as in plugin_t, and NULL where the plugin doesn't implement them.
+typedef struct {
+    const char* name;
+    gdnsd_apiv_cb_t get_api_version;
+    gdnsd_load_config_cb_t load_config;
+    gdnsd_map_res_cb_t map_res;
+    gdnsd_pre_run_cb_t pre_run;
+    gdnsd_iothread_init_cb_t iothread_init;
+    gdnsd_resolve_cb_t resolve;
+    gdnsd_exit_cb_t exit;
+    gdnsd_add_svctype_cb_t add_svctype;
+    gdnsd_add_mon_addr_cb_t add_mon_addr;
+    gdnsd_add_mon_cname_cb_t add_mon_cname;
+    gdnsd_init_monitors_cb_t init_monitors;
+    gdnsd_start_monitors_cb_t start_monitors;
+} gdnsd_plugin_builtin_t;
+
+// Registers the daemon's table of built-in plugins, terminated by an entry
+//   with a NULL name.  These take precedence over plugins of the same
+//   name in the search path.  MUST be called before loading plugins below.
+F_NONNULL
+void gdnsd_plugins_set_builtins(const gdnsd_plugin_builtin_t* builtin_table);
+
 // MUST call this before loading plugins below,
 //   array can be NULL for just the default
 //   MUST only call this once per program
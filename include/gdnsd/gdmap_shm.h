@@ -0,0 +1,85 @@
+/* Copyright © 2012 Brandon L Black <blblack@gmail.com>
+ *
+ * This file is part of gdnsd.
+ *
+ * gdnsd is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gdnsd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gdnsd.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef GDNSD_GDMAP_SHM_H
+#define GDNSD_GDMAP_SHM_H
+
+// Read-only access to the geoip plugin maps which gdnsd publishes via
+//   the per-map "shm_file" option, for other processes on the same host
+//   which need the same client -> datacenter mapping.  This library does
+//   not depend on libgdnsd.
+// Lookups are lock-free and operate directly on a shared mapping of the
+//   published file.  Each published generation is an immutable file, which
+//   gdnsd replaces atomically with the next one.  A handle keeps using the
+//   generation it has mapped until gdmap_shm_refresh() is called.
+// A handle must not be used by multiple threads concurrently: open one
+//   per thread (the mapped pages themselves are shared regardless).
+
+#include <gdnsd/compiler.h>
+
+#include <inttypes.h>
+#include <sys/socket.h>
+
+typedef struct gdmap_shm_s_ gdmap_shm_t;
+
+#pragma GCC visibility push(default)
+
+// Opens and maps the current generation published at "path".
+// Returns NULL and sets errno on failure, with errno EINVAL
+//   meaning the file is not a valid published map.
+F_NONNULL F_WUNUSED
+gdmap_shm_t* gdmap_shm_open(const char* path);
+
+// Checks for a newer generation at the original path, and switches
+//   to it if one exists.  Returns 1 if switched, 0 if the current
+//   generation is still the latest, or -1 (with errno set) if a new
+//   generation couldn't be mapped, in which case the old one remains
+//   in use.  Any pointers previously returned by the functions below are
+//   invalidated if this returns 1.
+F_NONNULL
+int gdmap_shm_refresh(gdmap_shm_t* shm);
+
+// The generation number of the currently-mapped data, which is
+//   unique and increases with each publication.
+F_NONNULL F_PURE
+uint64_t gdmap_shm_generation(const gdmap_shm_t* shm);
+
+// The count of datacenters, and the name of datacenter "dcnum"
+//   (1 -> count, as used in the lists from gdmap_shm_lookup()).
+//   Returns NULL for an invalid dcnum.
+F_NONNULL F_PURE
+unsigned gdmap_shm_dc_count(const gdmap_shm_t* shm);
+F_NONNULL F_PURE
+const char* gdmap_shm_dc_name(const gdmap_shm_t* shm, const unsigned dcnum);
+
+// Looks up the client address "addr" (AF_INET or AF_INET6), exactly
+//   as gdnsd would for the same map.  The result is a NUL-terminated list
+//   of dcnums in preference order, and the network mask of the matching
+//   entry is stored in *scope_mask.  Returns NULL for unsupported address
+//   families (or inconsistent data).
+F_NONNULL
+const uint8_t* gdmap_shm_lookup(const gdmap_shm_t* shm, const struct sockaddr* addr, unsigned* scope_mask);
+
+// Unmaps the data and frees the handle
+F_NONNULL
+void gdmap_shm_close(gdmap_shm_t* shm);
+
+#pragma GCC visibility pop
+
+#endif // GDNSD_GDMAP_SHM_H
@@ -44,6 +44,22 @@ static const gdnsd_sttl_t GDNSD_STTL_TTL_MAX       = ((1U << 28U) - 1U);
 // the only hard rule on this data type is zero in the reserved bits for now
 #define assert_valid_sttl(_x) dmn_assert(!((_x) & GDNSD_STTL_RESERVED_MASK))
 
+// The table of current sttl values (one per monitored index) is published
+//   to consumers as a set of fixed-size pages, so that the monitoring code
+//   only has to copy and swap the pages which actually changed.  Consumers
+//   should treat this as opaque and use gdnsd_mon_get_sttl_table() and
+//   gdnsd_sttl_get() below.  Each publication of the table gets a new
+//   generation number, see gdnsd_sttl_tbl_gen().
+#define GDNSD_STTL_PAGE_SHIFT 10U
+#define GDNSD_STTL_PAGE_SIZE (1U << GDNSD_STTL_PAGE_SHIFT)
+#define GDNSD_STTL_PAGE_MASK (GDNSD_STTL_PAGE_SIZE - 1U)
+
+typedef struct {
+    unsigned num_pages;
+    unsigned gen;
+    gdnsd_sttl_t* pages[];
+} gdnsd_sttl_tbl_t;
+
 #pragma GCC visibility push(default)
 
 // Parses a string of the form STATE[/TTL], where STATE is UP or DOWN and
@@ -69,6 +85,10 @@ const char* gdnsd_logf_sttl(const gdnsd_sttl_t s);
 // latest -> 0 failed, 1 succeeded
 void gdnsd_mon_state_updater(unsigned idx, const bool latest);
 
+// The same as above, but also reporting how long the check took, in
+//   seconds, which is kept in the check history of the stats output.
+void gdnsd_mon_state_updater_timed(unsigned idx, const bool latest, const double latency);
+
 // A more-advanced monitoring plugin may wish to do its own
 //   anti-flap state-tracking and TTL-calculations, in which
 //   case it can use this interface to provide full, direct updates.
@@ -76,6 +96,29 @@ void gdnsd_mon_state_updater(unsigned idx, const bool latest);
 //   bit in "new_sttl" - this is checked as an assertion!
 void gdnsd_mon_sttl_updater(unsigned idx, gdnsd_sttl_t new_sttl);
 
+// Check scheduling for monitoring plugins which run periodic checks:
+// gdnsd_mon_get_start_delay() returns the delay (in seconds, less than
+//   the interval) from the start of runtime monitoring until the first
+//   regular check of "idx".  These phases are spread evenly over the
+//   interval for all resources sharing the same interval.
+// gdnsd_mon_get_next_delay() returns the delay from the start of one
+//   check until the next one, which is the interval randomized by the
+//   service type's "jitter" option, or zero if it has no jitter (in which
+//   case the plugin should simply repeat at the interval).  The jitter
+//   never affects the anti-flap thresholds of gdnsd_mon_state_updater().
+double gdnsd_mon_get_start_delay(unsigned idx);
+double gdnsd_mon_get_next_delay(unsigned idx);
+
+// Runtime monitoring may be spread over several threads (the global
+//   option "monitor_threads").  A plugin which supports this should start
+//   the runtime watchers of "idx" in its start_monitors callback in the
+//   loop returned here instead of the one passed in, and then only touch
+//   that monitor's state from that loop's callbacks.  Both updater
+//   functions above may be called from any of these loops.  The initial
+//   round of monitoring (init_monitors) always runs in the main monitoring
+//   loop.
+struct ev_loop* gdnsd_mon_get_loop(unsigned idx);
+
 // called during load_config to register address healthchecks, returns
 //   an index to check state with...
 F_NONNULL
@@ -94,17 +137,34 @@ unsigned gdnsd_mon_admin(const char* desc);
 
 // do not ref this directly in a plugin!
 // use gdnsd_mon_get_sttl_table() below for access!
-extern gdnsd_sttl_t* smgr_sttl_consumer_;
+extern gdnsd_sttl_tbl_t* smgr_sttl_consumer_;
 
 #pragma GCC visibility pop
 
 // State-fetching (one table call per resolve invocation, reused
 //   for as many index fetches as necc)
 F_UNUSED
-static const gdnsd_sttl_t* gdnsd_mon_get_sttl_table(void) {
+static const gdnsd_sttl_tbl_t* gdnsd_mon_get_sttl_table(void) {
     return gdnsd_prcu_rdr_deref(smgr_sttl_consumer_);
 }
 
+// Fetch a single index from the table above
+F_NONNULL F_PURE F_UNUSED
+static gdnsd_sttl_t gdnsd_sttl_get(const gdnsd_sttl_tbl_t* sttl_tbl, const unsigned idx) {
+    return sttl_tbl->pages[idx >> GDNSD_STTL_PAGE_SHIFT][idx & GDNSD_STTL_PAGE_MASK];
+}
+
+// The generation of the table, which changes every time a new table is
+//   published.  Plugins can use this to cache anything they derive from
+//   the table contents until the next change.  The table pointer itself
+//   is not suitable for this, as its memory may be reused by a later
+//   table.  Note that gdnsd_mon_get_sttl_table() returns NULL if nothing
+//   is monitored at all, which is treated as generation zero.
+F_PURE F_UNUSED
+static unsigned gdnsd_sttl_tbl_gen(const gdnsd_sttl_tbl_t* sttl_tbl) {
+    return sttl_tbl ? sttl_tbl->gen : 0;
+}
+
 // Given two sttl values, combine them according to the following rules:
 //   1) result TTL is the lesser of both TTLs
 //   2) if either is down, result is down
@@ -127,10 +187,10 @@ static gdnsd_sttl_t gdnsd_sttl_min2(const gdnsd_sttl_t a, const gdnsd_sttl_t b)
 //   several different service_type checks against a single IP for
 //   a single resource.
 F_NONNULLX(1) F_PURE F_UNUSED
-static gdnsd_sttl_t gdnsd_sttl_min(const gdnsd_sttl_t* sttl_tbl, const unsigned* idx_ary, const unsigned idx_ary_len) {
+static gdnsd_sttl_t gdnsd_sttl_min(const gdnsd_sttl_tbl_t* sttl_tbl, const unsigned* idx_ary, const unsigned idx_ary_len) {
     gdnsd_sttl_t rv = GDNSD_STTL_TTL_MAX;
     for(unsigned i = 0; i < idx_ary_len; i++)
-        rv = gdnsd_sttl_min2(rv, sttl_tbl[idx_ary[i]]);
+        rv = gdnsd_sttl_min2(rv, gdnsd_sttl_get(sttl_tbl, idx_ary[i]));
     return rv;
 }
 
@@ -51,7 +51,7 @@
 // We have room for 16 option bits here coming from bopts.h/config.h
 #define API_B_OPT_QSBR_ ((GDNSD_B_QSBR ? 1 : 0) << 0)
 #define API_B_OPTS_ (API_B_OPT_QSBR_)
-#define API_ACTUAL_VERSION_ 17
+#define API_ACTUAL_VERSION_ 18
 #define GDNSD_PLUGIN_API_VERSION (((API_B_OPTS_) << 16) | (API_ACTUAL_VERSION_))
 
 #pragma GCC visibility push(default)
@@ -70,7 +70,10 @@ typedef struct {
     dmn_anysin_t dns_source;       // address of last source DNS cache/forwarder
     dmn_anysin_t edns_client;      // edns-client-subnet address portion
     unsigned edns_client_mask; // edns-client-subnet mask portion
-} client_info_t;               //  ^(if zero, edns_client is invalid (was not sent))
+                               //  ^(if zero, edns_client is invalid (was not sent))
+    uint64_t query_id;         // per-I/O-thread query number, shared by all
+                               //  resolve calls for one query (zero if unknown)
+} client_info_t;
 
 // Private result structure for dynamic resolution plugins
 // Modified via the functions below...
@@ -115,6 +118,85 @@ void gdnsd_result_reset_scope_mask(dyn_result_t* result);
 F_NONNULL
 void gdnsd_result_add_scope_mask(dyn_result_t* result, unsigned scope);
 
+// Returns the current edns scope mask of the result
+F_NONNULL F_PURE
+unsigned gdnsd_result_get_scope_mask(const dyn_result_t* result);
+
+// Per-thread memoization of whole results, for resolver plugins whose
+//   results depend only on the resource and the sttl table (and not on
+//   the origin or client info).  A plugin creates one memo per I/O thread
+//   from its iothread_init callback, with one slot per resource, and uses
+//   it like this in its resolve callback:
+//
+//     const gdnsd_sttl_tbl_t* sttl_tbl = gdnsd_mon_get_sttl_table();
+//     const unsigned gen = gdnsd_sttl_tbl_gen(sttl_tbl);
+//     gdnsd_sttl_t rv;
+//     if(gdnsd_result_memo_get(memo, resnum, gen, result, &rv))
+//         return rv;
+//     ... resolve as usual into result and rv ...
+//     gdnsd_result_memo_put(memo, resnum, result, rv);
+//     return rv;
+//
+// A hit copies the memoized addresses or CNAME into the result.  Results
+//   are only memoized when the result was empty on entry, otherwise
+//   _get() always misses and the following _put() does nothing.  The
+//   scope mask of the result is not affected.
+struct gdnsd_result_memo;
+typedef struct gdnsd_result_memo gdnsd_result_memo_t;
+
+gdnsd_result_memo_t* gdnsd_result_memo_new(const unsigned num_slots);
+F_NONNULL
+bool gdnsd_result_memo_get(gdnsd_result_memo_t* memo, const unsigned slot, const unsigned gen, dyn_result_t* result, gdnsd_sttl_t* sttl_out);
+F_NONNULL
+void gdnsd_result_memo_put(gdnsd_result_memo_t* memo, const unsigned slot, const dyn_result_t* result, const gdnsd_sttl_t sttl);
+
+// Per-query caching of per-client work, for resolver plugins which may be
+//   called several times while building the response to a single query
+//   (e.g. A and AAAA from one DYNA, each step of a chain of DYNC CNAMEs,
+//   or several additional-section addresses), and whose results depend
+//   on client_info_t in some expensive way (e.g. a geographic map
+//   lookup).  Entries are valid only for the query they were stored
+//   during, as identified by cinfo->query_id, so a plugin creates one
+//   cache per I/O thread from its iothread_init callback, with one slot
+//   per distinct lookup (e.g. per map), and uses it like this:
+//
+//     unsigned scope;
+//     const foo_t* foo = gdnsd_query_cache_get(qcache, cinfo, slot, &scope);
+//     if(!foo) {
+//         foo = expensive_lookup(slot, cinfo, &scope);
+//         gdnsd_query_cache_put(qcache, cinfo, slot, foo, scope);
+//     }
+//
+// Only the pointer is cached, so the pointed-to data must remain valid
+//   for the duration of the query (e.g. data under the prcu read lock,
+//   which the core holds across the whole query).  A cinfo with a zero
+//   query_id always misses.
+struct gdnsd_query_cache;
+typedef struct gdnsd_query_cache gdnsd_query_cache_t;
+
+gdnsd_query_cache_t* gdnsd_query_cache_new(const unsigned num_slots);
+F_NONNULL
+const void* gdnsd_query_cache_get(const gdnsd_query_cache_t* qcache, const client_info_t* cinfo, const unsigned slot, unsigned* scope_out);
+F_NONNULL
+void gdnsd_query_cache_put(gdnsd_query_cache_t* qcache, const client_info_t* cinfo, const unsigned slot, const void* data, const unsigned scope);
+
+// Per-thread scratch memory for resolve callbacks.  Each I/O thread has
+//   a bump arena which is emptied at the start of every query, so memory
+//   from gdnsd_scratch_alloc() stays valid for the rest of the current
+//   query and is never freed explicitly.  It's meant for temporary arrays
+//   sized by configuration data, which would otherwise be VLAs on the
+//   stack or malloc() calls at runtime.  Allocations are aligned for any
+//   type, and never fail.
+// gdnsd_scratch_reserve() declares the most scratch memory a plugin
+//   expects to use during a single query, and may be called from the
+//   load_config, pre_run, or iothread_init callbacks.  Every arena is
+//   sized for the largest reservation.  Exceeding it still works, but
+//   costs a malloc() each time until the arena is grown to fit at the
+//   start of the next query.
+void gdnsd_scratch_reserve(const size_t size);
+F_MALLOC F_ALLOCSZ(1) F_RETNN
+void* gdnsd_scratch_alloc(const size_t size);
+
 /**** Typedefs for plugin callbacks ****/
 
 typedef unsigned (*gdnsd_apiv_cb_t)(void);
@@ -49,13 +49,15 @@
 //  datacenter in the case that auto_dc_coords was used.  This
 //  array of doubles is twice as long as the names array, and stores
 //  a latitude follow by a longitude for each datacenter, in
-//  radian units.
+//  radian units.  The same coordinates are also stored as unit
+//  vectors (see dcinfo_get_vectors()) for distance ranking.
 
 struct _dcinfo {
     unsigned num_dcs;    // count of datacenters
     unsigned auto_limit; // lesser of num_dcs and dc_auto_limit cfg
     char** names;        // #num_dcs, ordered map
     double* coords;      // #(num_dcs * 2, lat then lon, in radians)
+    double* vectors;     // #(num_dcs * 4, x[], y[], z[], bias[])
     unsigned* indices;   // mon_admin indices for map-level forced state
 };
 
@@ -126,9 +128,29 @@ dcinfo_t* dcinfo_new(vscf_data_t* dc_cfg, vscf_data_t* dc_auto_cfg, vscf_data_t*
             info->coords[(dcidx * 2)] = lat * DEG2RAD;
             info->coords[(dcidx * 2) + 1] = lon * DEG2RAD;
         }
+        info->vectors = xmalloc(num_dcs * 4 * sizeof(double));
+        double* vx = info->vectors;
+        double* vy = &vx[num_dcs];
+        double* vz = &vy[num_dcs];
+        double* vbias = &vz[num_dcs];
+        for(unsigned i = 0; i < num_dcs; i++) {
+            const double lat = info->coords[(i * 2)];
+            const double lon = info->coords[(i * 2) + 1];
+            if(isnan(lat)) {
+                vx[i] = vy[i] = vz[i] = 0.0;
+                vbias[i] = (double)-INFINITY;
+            }
+            else {
+                vx[i] = cos(lat) * cos(lon);
+                vy[i] = cos(lat) * sin(lon);
+                vz[i] = sin(lat);
+                vbias[i] = 0.0;
+            }
+        }
     }
     else {
         info->coords = NULL;
+        info->vectors = NULL;
     }
 
     if(dc_auto_limit_cfg) {
@@ -159,6 +181,11 @@ const double* dcinfo_get_coords(const dcinfo_t* info, const unsigned dcnum) {
     return &info->coords[dcnum * 2];
 }
 
+const double* dcinfo_get_vectors(const dcinfo_t* info) {
+    dmn_assert(info->vectors);
+    return info->vectors;
+}
+
 unsigned dcinfo_name2num(const dcinfo_t* info, const char* dcname) {
     if(dcname)
         for(unsigned i = 0; i < info->num_dcs; i++)
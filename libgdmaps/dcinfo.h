@@ -26,8 +26,8 @@
 // DEG2RAD converts degrees to radians.  Our auto_dc_coords input
 //   and GeoIPCity coordinate data is in degrees, and must be
 //   converted to radians before storage (auto_dc_coords) or use
-//   (GeoIPCity data), because our haversine() func takes its inputs
-//   in radian format
+//   (GeoIPCity data), because our distance calculations take their
+//   inputs in radian format
 static const double DEG2RAD = 0.017453292519943295769236907684886;
 
 typedef struct _dcinfo dcinfo_t;
@@ -40,6 +40,12 @@ F_NONNULL F_PURE
 unsigned dcinfo_get_limit(const dcinfo_t* info);
 F_NONNULL F_PURE
 const double* dcinfo_get_coords(const dcinfo_t* info, const unsigned dcnum);
+// Returns the auto_dc_coords as unit-sphere vectors, laid out as
+//   four consecutive arrays of num_dcs doubles: x[], y[], z[], and
+//   a bias[] which is -INFINITY for datacenters without coordinates
+//   (whose vectors are zero) and zero otherwise.
+F_NONNULL F_PURE
+const double* dcinfo_get_vectors(const dcinfo_t* info);
 F_NONNULLX(1) F_PURE
 unsigned dcinfo_name2num(const dcinfo_t* info, const char* dcname);
 F_NONNULL F_PURE
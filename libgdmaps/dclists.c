@@ -24,6 +24,7 @@
 
 #include <gdnsd/alloc.h>
 #include <gdnsd/log.h>
+#include <gdnsd/misc.h>
 #include <gdnsd/vscf.h>
 
 #include <math.h>
@@ -59,14 +60,63 @@
 //  be aborted, and the destruct-all-strings form is
 //  used on true shutdown of the whole gdmap (only debug
 //  mode for the real plugin).
+// Because city-auto mode can generate many thousands of unique
+//  lists while translating a City database, de-duplication is
+//  done via an open-addressing hash of list indices (stored +1,
+//  so that zero means an empty slot) kept alongside the list
+//  itself, and both arrays grow by doubling.  The hash is copied
+//  as-is on clone, since the clone shares the same string storage.
+// City-auto mode also keeps a cache of results per lat/lon grid
+//  cell (see dclists_city_auto_map()), which is only of use while
+//  a database is being translated, and so is not copied on clone.
+
+typedef struct {
+    uint32_t key;    // from auto_cell_key(), 0 == empty
+    uint32_t dclist; // DCLIST_AUTO if not uniform across the cell
+} auto_cell_t;
 
 struct _dclists {
     unsigned count; // count of unique result lists
     unsigned old_count; // count from object we cloned from
+    unsigned alloc; // allocated slots in "list"
+    unsigned hash_alloc; // allocated slots in "hash", power of two
     uint8_t** list;    // strings of dc numbers
+    uint32_t* hash;    // hash slots -> (list index + 1), 0 == empty
+    unsigned cells_count; // used slots in "cells"
+    unsigned cells_alloc; // allocated slots in "cells", power of two or zero
+    auto_cell_t* cells;   // city-auto grid cell cache
     const dcinfo_t* info; // dclists_t doesn't own "info", just uses it for reference a lot
 };
 
+#define DCLISTS_INIT_ALLOC 16U
+
+F_NONNULL F_PURE
+static uint32_t dclist_hash(const uint8_t* dclist, const uint32_t hash_mask) {
+    return gdnsd_lookup2(dclist, strlen((const char*)dclist)) & hash_mask;
+}
+
+// Inserts an index into the hash, without checking for an existing match
+F_NONNULL
+static void dclists_hash_insert(dclists_t* lists, const uint32_t idx) {
+    const uint32_t hash_mask = lists->hash_alloc - 1U;
+    unsigned jmpby = 1;
+    uint32_t slot = dclist_hash(lists->list[idx], hash_mask);
+    while(lists->hash[slot]) {
+        slot += jmpby++;
+        slot &= hash_mask;
+    }
+    lists->hash[slot] = idx + 1U;
+}
+
+// (Re-)builds the hash from scratch at the current hash_alloc size
+F_NONNULL
+static void dclists_hash_rebuild(dclists_t* lists) {
+    free(lists->hash);
+    lists->hash = xcalloc(lists->hash_alloc, sizeof(uint32_t));
+    for(uint32_t i = 0; i < lists->count; i++)
+        dclists_hash_insert(lists, i);
+}
+
 dclists_t* dclists_new(const dcinfo_t* info) {
     const unsigned num_dcs = dcinfo_get_count(info);
     uint8_t* deflist = xmalloc(num_dcs + 1);
@@ -77,9 +127,16 @@ dclists_t* dclists_new(const dcinfo_t* info) {
     dclists_t* newdcl = xmalloc(sizeof(dclists_t));
     newdcl->count = 1;
     newdcl->old_count = 0;
-    newdcl->list = xmalloc(sizeof(uint8_t*));
+    newdcl->alloc = DCLISTS_INIT_ALLOC;
+    newdcl->hash_alloc = DCLISTS_INIT_ALLOC << 1;
+    newdcl->list = xmalloc(newdcl->alloc * sizeof(uint8_t*));
     newdcl->list[0] = deflist;
+    newdcl->hash = NULL;
+    newdcl->cells_count = 0;
+    newdcl->cells_alloc = 0;
+    newdcl->cells = NULL;
     newdcl->info = info;
+    dclists_hash_rebuild(newdcl);
 
     return newdcl;
 }
@@ -89,8 +146,15 @@ dclists_t* dclists_clone(const dclists_t* old) {
     dcl_clone->info = old->info;
     dcl_clone->count = old->count;
     dcl_clone->old_count = old->count;
-    dcl_clone->list = xmalloc(dcl_clone->count * sizeof(uint8_t*));
+    dcl_clone->alloc = old->alloc;
+    dcl_clone->hash_alloc = old->hash_alloc;
+    dcl_clone->list = xmalloc(dcl_clone->alloc * sizeof(uint8_t*));
     memcpy(dcl_clone->list, old->list, dcl_clone->count * sizeof(uint8_t*));
+    dcl_clone->hash = xmalloc(dcl_clone->hash_alloc * sizeof(uint32_t));
+    memcpy(dcl_clone->hash, old->hash, dcl_clone->hash_alloc * sizeof(uint32_t));
+    dcl_clone->cells_count = 0;
+    dcl_clone->cells_alloc = 0;
+    dcl_clone->cells = NULL;
     return dcl_clone;
 }
 
@@ -107,23 +171,37 @@ const uint8_t* dclists_get_list(const dclists_t* lists, const uint32_t idx) {
 
 // Locates an existing dclist that matches newlist and returns its index, or if no match
 //  it copies newlist to the storage area and returns the new index.
-// If someone complains about load-time performance with large datecenter sets, this func
-//  will probably be a profiling hotspot.  It could use a hashtable rather than linear
-//  search for comparisons, and it could realloc the list by doubling instead of 1-at-a-time.
-// Not terribly worried about this unless someone complains first.
-F_NONNULL
-static uint32_t dclists_find_or_add_raw(dclists_t* lists, const uint8_t* newlist, const char* map_name) {
-    for(uint32_t i = 0; i < lists->count; i++)
-        if(!strcmp((const char*)newlist, (const char*)(lists->list[i])))
-            return i;
+uint32_t dclists_find_or_add_raw(dclists_t* lists, const uint8_t* newlist, const char* map_name) {
+    const uint32_t hash_mask = lists->hash_alloc - 1U;
+    unsigned jmpby = 1;
+    uint32_t slot = dclist_hash(newlist, hash_mask);
+    uint32_t idx_p1;
+    while((idx_p1 = lists->hash[slot])) {
+        if(!strcmp((const char*)newlist, (const char*)(lists->list[idx_p1 - 1U])))
+            return idx_p1 - 1U;
+        slot += jmpby++;
+        slot &= hash_mask;
+    }
 
     if(lists->count > DCLIST_MAX)
         log_fatal("plugin_geoip: map '%s': too many unique dclists (>%u)", map_name, lists->count);
 
-    const uint32_t newidx = lists->count;
-    lists->list = xrealloc(lists->list, (++lists->count) * sizeof(uint8_t*));
+    const uint32_t newidx = lists->count++;
+    if(lists->count > lists->alloc) {
+        lists->alloc <<= 1;
+        lists->list = xrealloc(lists->list, lists->alloc * sizeof(uint8_t*));
+    }
     lists->list[newidx] = (uint8_t*)strdup((const char*)newlist);
 
+    // max hash load is 50%
+    if(lists->count > (lists->hash_alloc >> 1)) {
+        lists->hash_alloc <<= 1;
+        dclists_hash_rebuild(lists);
+    }
+    else {
+        lists->hash[slot] = newidx + 1U;
+    }
+
     dmn_assert(newidx <= DCLIST_MAX);
     return newidx;
 }
@@ -132,6 +210,12 @@ static uint32_t dclists_find_or_add_raw(dclists_t* lists, const uint8_t* newlist
 void dclists_replace_list0(dclists_t* lists, uint8_t* newlist) {
     free(lists->list[0]);
     lists->list[0] = newlist;
+    dclists_hash_rebuild(lists);
+    // cached city-auto results are permutations of the old list0
+    free(lists->cells);
+    lists->cells = NULL;
+    lists->cells_count = 0;
+    lists->cells_alloc = 0;
 }
 
 // We should probably check for dupes in these map dclists, but really the fallout
@@ -166,55 +250,157 @@ uint32_t dclists_find_or_add_vscf(dclists_t* lists, vscf_data_t* vscf_list, cons
     return dclists_find_or_add_raw(lists, newlist, map_name);
 }
 
-// Geographic distance between two lat/long points.
-// Because we only care about rough distance comparison rather than
-//  the precise values themselves, input is specified in radians
-//  and output in units of the earth's diameter.
+// Ranks the datacenters by distance from the unit vector (cx, cy, cz),
+//  leaving the nearest "keep" of them in order in "sortlist", with ties
+//  in the order of the default list.  The dot product of two unit vectors
+//  is the cosine of the angle between them, which is monotonic in
+//  great-circle distance, so we don't need any trig here.  The dot products
+//  are stored in "dots", which is offset by one so that the actual 1-based
+//  dcnums can be used as direct indices.  The loop over the separate x/y/z
+//  arrays is simple enough for the compiler to vectorize.
+F_NONNULL
+static void dclists_auto_rank(const dclists_t* lists, const double cx, const double cy, const double cz, const unsigned keep, uint8_t* sortlist, double* dots) {
+    const unsigned num_dcs = dcinfo_get_count(lists->info);
+    dmn_assert(keep && keep <= num_dcs);
+    const double* vx = dcinfo_get_vectors(lists->info);
+    const double* vy = &vx[num_dcs];
+    const double* vz = &vy[num_dcs];
+    const double* vbias = &vz[num_dcs];
+
+    double* dcdots = &dots[1];
+    for(unsigned i = 0; i < num_dcs; i++)
+        dcdots[i] = vx[i] * cx + vy[i] * cy + vz[i] * cz + vbias[i];
+
+    // Bounded insertion sort, as only the first few results matter
+    const uint8_t* deflist = lists->list[0];
+    unsigned ranked = 0;
+    for(unsigned i = 0; i < num_dcs; i++) {
+        const unsigned dcnum = deflist[i];
+        const double dot = dots[dcnum];
+        if(ranked == keep && !(dot > dots[sortlist[keep - 1]]))
+            continue;
+        unsigned j = (ranked < keep) ? ranked++ : keep - 1;
+        while(j && dot > dots[sortlist[j - 1]]) {
+            sortlist[j] = sortlist[j - 1];
+            j--;
+        }
+        sortlist[j] = dcnum;
+    }
+    sortlist[keep] = 0;
+}
+
+// The city-auto grid cache: cells are AUTO_GRID_PER_DEG per degree of
+//  latitude and longitude.  No point within a cell is further than
+//  AUTO_GRID_RADIUS (half a cell of latitude plus half a cell of longitude,
+//  in radians) from the cell's center, so if the center's distances to the
+//  datacenters ranked 1 through auto_limit+1 are all separated by more than
+//  twice that, no point within the cell can rank them differently, and
+//  one result serves the whole cell.  Other cells are marked as such
+//  and their points are ranked individually.
+#define AUTO_GRID_PER_DEG 10U
+#define AUTO_GRID_LON_CELLS (360U * AUTO_GRID_PER_DEG + 1U)
+static const double AUTO_GRID_RADIUS = (1.0 / AUTO_GRID_PER_DEG) * 0.017453292519943295769236907684886;
+static const double AUTO_GRID_SLOP = 1E-9;
+#define AUTO_CELLS_INIT_ALLOC 1024U
+
+// Returns the cell key for a location in degrees, or zero if it's off the grid
 F_CONST
-static double haversine(double lat1, double lon1, double lat2, double lon2) {
-    double a = pow(sin((lat2 - lat1) * 0.5), 2.0)
-        + cos(lat1) * cos(lat2) * pow(sin((lon2 - lon1) * 0.5), 2.0);
-    return atan2(sqrt(a), sqrt(1.0 - a));
+static uint32_t auto_cell_key(const double lat, const double lon) {
+    if(!(lat >= -90.0 && lat <= 90.0 && lon >= -180.0 && lon <= 180.0))
+        return 0;
+    const uint32_t qlat = (uint32_t)((lat + 90.0) * AUTO_GRID_PER_DEG);
+    const uint32_t qlon = (uint32_t)((lon + 180.0) * AUTO_GRID_PER_DEG);
+    return qlat * AUTO_GRID_LON_CELLS + qlon + 1U;
 }
 
-uint32_t dclists_city_auto_map(dclists_t* lists, const char* map_name, const double lat, const double lon) {
-    const double lat_rad = lat * DEG2RAD;
-    const double lon_rad = lon * DEG2RAD;
+// Returns the slot for "key", which is either a match or the empty slot where it belongs
+F_NONNULL F_PURE
+static auto_cell_t* dclists_auto_cell_slot(const dclists_t* lists, const uint32_t key) {
+    dmn_assert(lists->cells_alloc);
+    const uint32_t cells_mask = lists->cells_alloc - 1U;
+    unsigned jmpby = 1;
+    uint32_t slot = gdnsd_lookup2((const uint8_t*)&key, sizeof(key)) & cells_mask;
+    while(lists->cells[slot].key && lists->cells[slot].key != key) {
+        slot += jmpby++;
+        slot &= cells_mask;
+    }
+    return &lists->cells[slot];
+}
+
+F_NONNULL
+static void dclists_auto_cell_add(dclists_t* lists, const uint32_t key, const uint32_t dclist) {
+    // max load is 50%
+    if(lists->cells_count >= (lists->cells_alloc >> 1)) {
+        auto_cell_t* old_cells = lists->cells;
+        const unsigned old_alloc = lists->cells_alloc;
+        lists->cells_alloc = old_alloc ? (old_alloc << 1) : AUTO_CELLS_INIT_ALLOC;
+        lists->cells = xcalloc(lists->cells_alloc, sizeof(auto_cell_t));
+        for(unsigned i = 0; i < old_alloc; i++)
+            if(old_cells[i].key)
+                *dclists_auto_cell_slot(lists, old_cells[i].key) = old_cells[i];
+        free(old_cells);
+    }
 
-    // Copy the default datacenter list to local storage for sorting
+    auto_cell_t* cell = dclists_auto_cell_slot(lists, key);
+    dmn_assert(!cell->key);
+    cell->key = key;
+    cell->dclist = dclist;
+    lists->cells_count++;
+}
+
+// Ranks the datacenters from the center of the cell "key", and returns
+//  the resulting dclist if it applies to the whole cell, else DCLIST_AUTO
+F_NONNULL
+static uint32_t dclists_auto_cell_map(dclists_t* lists, const char* map_name, const uint32_t key) {
     const unsigned num_dcs = dcinfo_get_count(lists->info);
-    const unsigned store_len = num_dcs + 1;
-    uint8_t sortlist[store_len];
-    memcpy(sortlist, lists->list[0], store_len);
-
-    // calculate the target's distance from each datacenter.
-    // note the first element of 'dists' is unused, and
-    //  storage is offset by one.  This is so that the actual
-    //  1-based dcnums in 'sortlist' can be used as direct
-    //  indices into 'dists'
-    double dists[store_len];
-    for(unsigned i = 0; i < num_dcs; i++) {
-        const double* coords = dcinfo_get_coords(lists->info, i);
-        if (!isnan(coords[0]))
-            dists[i + 1] = haversine(lat_rad, lon_rad, coords[0], coords[1]);
-        else
-            dists[i + 1] = (double)+INFINITY;
+    const unsigned limit = dcinfo_get_limit(lists->info);
+    uint8_t sortlist[num_dcs + 1];
+    double dots[num_dcs + 1];
+
+    const uint32_t qlat = (key - 1U) / AUTO_GRID_LON_CELLS;
+    const uint32_t qlon = (key - 1U) % AUTO_GRID_LON_CELLS;
+    const double lat_rad = (((qlat + 0.5) / AUTO_GRID_PER_DEG) - 90.0) * DEG2RAD;
+    const double lon_rad = (((qlon + 0.5) / AUTO_GRID_PER_DEG) - 180.0) * DEG2RAD;
+    const unsigned keep = (limit < num_dcs) ? limit + 1 : limit;
+    dclists_auto_rank(lists, cos(lat_rad) * cos(lon_rad), cos(lat_rad) * sin(lon_rad), sin(lat_rad), keep, sortlist, dots);
+
+    double near = acos(fmax(fmin(dots[sortlist[0]], 1.0), -1.0));
+    for(unsigned i = 1; i < keep; i++) {
+        const double next_dot = dots[sortlist[i]];
+        if(isinf(next_dot))
+            break; // no-coords datacenters, identical ranking everywhere
+        const double far = acos(fmax(fmin(next_dot, 1.0), -1.0));
+        if(!(far - near > 2.0 * AUTO_GRID_RADIUS + AUTO_GRID_SLOP))
+            return DCLIST_AUTO;
+        near = far;
     }
 
-    // Given the relatively small num_dcs of most configs,
-    //  this simple insertion sort is probably reasonably quick
-    for(unsigned i = 1; i < num_dcs; i++) {
-        unsigned temp = sortlist[i];
-        int j = (int)i - 1;
-        while(j >= 0 && (dists[temp] < dists[sortlist[j]])) {
-            sortlist[j + 1] = sortlist[j];
-            j--;
+    sortlist[limit] = 0;
+    return dclists_find_or_add_raw(lists, sortlist, map_name);
+}
+
+uint32_t dclists_city_auto_map(dclists_t* lists, const char* map_name, const double lat, const double lon) {
+    const uint32_t key = auto_cell_key(lat, lon);
+    if(key) {
+        const auto_cell_t* cell = lists->cells_alloc ? dclists_auto_cell_slot(lists, key) : NULL;
+        if(!cell || !cell->key) {
+            const uint32_t dclist = dclists_auto_cell_map(lists, map_name, key);
+            dclists_auto_cell_add(lists, key, dclist);
+            if(dclist != DCLIST_AUTO)
+                return dclist;
+        }
+        else if(cell->dclist != DCLIST_AUTO) {
+            return cell->dclist;
         }
-        sortlist[j + 1] = temp;
     }
 
-    // Cap the list at the auto_limit
-    sortlist[dcinfo_get_limit(lists->info)] = 0;
+    const unsigned num_dcs = dcinfo_get_count(lists->info);
+    uint8_t sortlist[num_dcs + 1];
+    double dots[num_dcs + 1];
+
+    const double lat_rad = lat * DEG2RAD;
+    const double lon_rad = lon * DEG2RAD;
+    dclists_auto_rank(lists, cos(lat_rad) * cos(lon_rad), cos(lat_rad) * sin(lon_rad), sin(lat_rad), dcinfo_get_limit(lists->info), sortlist, dots);
 
     return dclists_find_or_add_raw(lists, sortlist, map_name);
 }
@@ -233,6 +419,8 @@ void dclists_destroy(dclists_t* lists, dclists_destroy_depth_t depth) {
         default:
             break;
     }
+    free(lists->cells);
+    free(lists->hash);
     free(lists->list);
     free(lists);
 }
@@ -69,6 +69,9 @@ void dclists_replace_list0(dclists_t* lists, uint8_t* newlist);
 F_NONNULL
 bool dclists_xlate_vscf(dclists_t* lists, vscf_data_t* vscf_list, const char* map_name, uint8_t* newlist, const bool allow_auto);
 
+// newlist is a NUL-terminated list of dcnums
+F_NONNULL
+uint32_t dclists_find_or_add_raw(dclists_t* lists, const uint8_t* newlist, const char* map_name);
 F_NONNULL
 uint32_t dclists_find_or_add_vscf(dclists_t* lists, vscf_data_t* vscf_list, const char* map_name, const bool allow_auto);
 F_NONNULL
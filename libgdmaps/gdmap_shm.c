@@ -0,0 +1,331 @@
+/* Copyright © 2012 Brandon L Black <blblack@gmail.com>
+ *
+ * This file is part of gdnsd.
+ *
+ * gdnsd-plugin-geoip is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gdnsd-plugin-geoip is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gdnsd.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+// libgdmap_shm: read-only lookups against published maps, see
+//   include/gdnsd/gdmap_shm.h.  This is linked by other processes
+//   rather than gdnsd, so it deliberately uses nothing from libgdnsd,
+//   and must validate everything about its input.
+
+#include <config.h>
+#include <gdnsd/gdmap_shm.h>
+#include "mapshm_fmt.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// These must match ntree.h
+#define SHM_NN_UNDEF UINT32_MAX
+#define SHM_NN_IS_DCLIST(x) ((x) & (1U << 31U))
+#define SHM_NN_GET_DCLIST(x) ((x) & ~(1U << 31U))
+
+typedef struct {
+    const uint8_t* base;
+    size_t size;
+    dev_t dev;
+    ino_t ino;
+} shm_gen_t;
+
+struct gdmap_shm_s_ {
+    char* path;
+    shm_gen_t gen;
+};
+
+F_NONNULL F_PURE
+static const mapshm_hdr_t* shm_hdr(const shm_gen_t* gen) {
+    return (const mapshm_hdr_t*)(const void*)gen->base;
+}
+
+F_NONNULL F_PURE
+static const uint32_t* shm_nodes(const shm_gen_t* gen) {
+    return (const uint32_t*)(const void*)&gen->base[shm_hdr(gen)->nodes_off];
+}
+
+F_NONNULL F_PURE
+static const uint64_t* shm_dclists(const shm_gen_t* gen) {
+    return (const uint64_t*)(const void*)&gen->base[shm_hdr(gen)->dclists_off];
+}
+
+F_NONNULL F_PURE
+static const uint64_t* shm_dcnames(const shm_gen_t* gen) {
+    return (const uint64_t*)(const void*)&gen->base[shm_hdr(gen)->dcnames_off];
+}
+
+// true if an array of "count" elements of "elsize" at "off" fits in the
+//   file, and is aligned for its element type
+F_PURE
+static bool shm_range_ok(const uint64_t size, const uint64_t off, const uint64_t count, const uint64_t elsize) {
+    return !(off % elsize) && off <= size && count <= (size - off) / elsize;
+}
+
+F_PURE
+static bool shm_node_ref_ok(const mapshm_hdr_t* hdr, const uint32_t ref) {
+    if(SHM_NN_IS_DCLIST(ref))
+        return ref == SHM_NN_UNDEF || SHM_NN_GET_DCLIST(ref) < hdr->dclist_count;
+    return ref && ref < hdr->node_count;
+}
+
+F_NONNULL F_PURE
+static bool shm_validate(const shm_gen_t* gen) {
+    if(gen->size < sizeof(mapshm_hdr_t) || gen->base[gen->size - 1])
+        return false;
+
+    const mapshm_hdr_t* hdr = shm_hdr(gen);
+    if(memcmp(hdr->magic, MAPSHM_MAGIC, sizeof(hdr->magic))
+        || hdr->version != MAPSHM_VERSION
+        || hdr->endian != MAPSHM_ENDIAN
+        || hdr->size != gen->size
+        || !hdr->node_count
+        || !hdr->dclist_count
+        || !shm_range_ok(hdr->size, hdr->nodes_off, hdr->node_count, 2 * sizeof(uint32_t))
+        || !shm_range_ok(hdr->size, hdr->dclists_off, hdr->dclist_count, sizeof(uint64_t))
+        || !shm_range_ok(hdr->size, hdr->dcnames_off, (uint64_t)hdr->num_dcs + 1, sizeof(uint64_t))
+        || hdr->strings_off > hdr->size)
+        return false;
+
+    // node 0 is only ever the root, which is also why the v4 root
+    //   must be non-zero if it's a node reference
+    const uint32_t* nodes = shm_nodes(gen);
+    for(unsigned i = 0; i < 2U * hdr->node_count; i++)
+        if(!shm_node_ref_ok(hdr, nodes[i]))
+            return false;
+    if(!shm_node_ref_ok(hdr, hdr->ipv4))
+        return false;
+
+    // every string starts in bounds, and the file ends in NUL
+    const uint64_t* dclists = shm_dclists(gen);
+    for(unsigned i = 0; i < hdr->dclist_count; i++)
+        if(dclists[i] < hdr->strings_off || dclists[i] >= hdr->size)
+            return false;
+    const uint64_t* dcnames = shm_dcnames(gen);
+    for(unsigned i = 1; i <= hdr->num_dcs; i++)
+        if(dcnames[i] < hdr->strings_off || dcnames[i] >= hdr->size)
+            return false;
+
+    return true;
+}
+
+// returns errno value on failure, 0 on success
+F_NONNULL
+static int shm_gen_map(const char* path, shm_gen_t* gen) {
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return errno;
+
+    struct stat st;
+    if(fstat(fd, &st)) {
+        const int err = errno;
+        close(fd);
+        return err;
+    }
+
+    if(st.st_size < (off_t)sizeof(mapshm_hdr_t)) {
+        close(fd);
+        return EINVAL;
+    }
+
+    void* mapped = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    const int map_err = errno;
+    close(fd);
+    if(mapped == MAP_FAILED)
+        return map_err;
+
+    gen->base = mapped;
+    gen->size = (size_t)st.st_size;
+    gen->dev = st.st_dev;
+    gen->ino = st.st_ino;
+
+    if(!shm_validate(gen)) {
+        munmap(mapped, gen->size);
+        return EINVAL;
+    }
+
+    return 0;
+}
+
+F_NONNULL
+static void shm_gen_unmap(shm_gen_t* gen) {
+    munmap((void*)(uintptr_t)gen->base, gen->size);
+    gen->base = NULL;
+}
+
+gdmap_shm_t* gdmap_shm_open(const char* path) {
+    gdmap_shm_t* shm = calloc(1, sizeof(*shm));
+    if(!shm)
+        return NULL;
+    shm->path = strdup(path);
+    if(!shm->path) {
+        free(shm);
+        return NULL;
+    }
+
+    const int err = shm_gen_map(shm->path, &shm->gen);
+    if(err) {
+        free(shm->path);
+        free(shm);
+        errno = err;
+        return NULL;
+    }
+
+    return shm;
+}
+
+int gdmap_shm_refresh(gdmap_shm_t* shm) {
+    struct stat st;
+    if(stat(shm->path, &st))
+        return -1;
+    if(st.st_dev == shm->gen.dev && st.st_ino == shm->gen.ino)
+        return 0;
+
+    shm_gen_t newgen;
+    const int err = shm_gen_map(shm->path, &newgen);
+    if(err) {
+        errno = err;
+        return -1;
+    }
+
+    shm_gen_unmap(&shm->gen);
+    shm->gen = newgen;
+    return 1;
+}
+
+uint64_t gdmap_shm_generation(const gdmap_shm_t* shm) {
+    return shm_hdr(&shm->gen)->generation;
+}
+
+unsigned gdmap_shm_dc_count(const gdmap_shm_t* shm) {
+    return shm_hdr(&shm->gen)->num_dcs;
+}
+
+const char* gdmap_shm_dc_name(const gdmap_shm_t* shm, const unsigned dcnum) {
+    if(!dcnum || dcnum > shm_hdr(&shm->gen)->num_dcs)
+        return NULL;
+    return (const char*)&shm->gen.base[shm_dcnames(&shm->gen)[dcnum]];
+}
+
+// The rest of this mirrors the lookup code in ntree.c, other than
+//   bounding the walks rather than asserting on the data.
+
+F_NONNULL F_PURE
+static bool shm_chkbit_v6(const uint8_t* ipv6, const unsigned bit) {
+    return ipv6[bit >> 3] & (1UL << (~bit & 7));
+}
+
+F_NONNULL
+static uint32_t shm_lookup_v6(const shm_gen_t* gen, const uint8_t* ip, unsigned* mask_out) {
+    const uint32_t* nodes = shm_nodes(gen);
+    unsigned chkbit = 0;
+    uint32_t offset = 0;
+    do {
+        if(chkbit == 128)
+            return SHM_NN_UNDEF;
+        offset = nodes[(offset * 2) + (shm_chkbit_v6(ip, chkbit++) ? 1 : 0)];
+    } while(!SHM_NN_IS_DCLIST(offset));
+
+    *mask_out = chkbit;
+    return offset;
+}
+
+F_NONNULL
+static uint32_t shm_lookup_v4(const shm_gen_t* gen, const uint32_t ip, unsigned* mask_out) {
+    const uint32_t* nodes = shm_nodes(gen);
+    unsigned chkbit = 0;
+    uint32_t offset = shm_hdr(gen)->ipv4;
+    while(!SHM_NN_IS_DCLIST(offset)) {
+        if(chkbit == 32)
+            return SHM_NN_UNDEF;
+        offset = nodes[(offset * 2) + ((ip & (1U << (31U - chkbit++))) ? 1 : 0)];
+    }
+
+    *mask_out = chkbit;
+    return offset;
+}
+
+// v4mapped, SIIT, and WKP (96-bit prefixes), Teredo (32-bit), 6to4 (16-bit)
+static const uint8_t pfx_v4mapped[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF };
+static const uint8_t pfx_siit[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF, 0, 0 };
+static const uint8_t pfx_wkp[12] = { 0x00, 0x64, 0xFF, 0x9B, 0, 0, 0, 0, 0, 0, 0, 0 };
+static const uint8_t pfx_teredo[4] = { 0x20, 0x01, 0x00, 0x00 };
+static const uint8_t pfx_6to4[2] = { 0x20, 0x02 };
+
+F_NONNULL
+static uint32_t shm_get_ip4(const uint8_t* in) {
+    uint32_t ip;
+    memcpy(&ip, in, sizeof(ip));
+    return ntohl(ip);
+}
+
+const uint8_t* gdmap_shm_lookup(const gdmap_shm_t* shm, const struct sockaddr* addr, unsigned* scope_mask) {
+    const shm_gen_t* gen = &shm->gen;
+    uint32_t rv;
+
+    if(addr->sa_family == AF_INET) {
+        const struct sockaddr_in* sin = (const struct sockaddr_in*)(const void*)addr;
+        rv = shm_lookup_v4(gen, ntohl(sin->sin_addr.s_addr), scope_mask);
+    }
+    else if(addr->sa_family == AF_INET6) {
+        const struct sockaddr_in6* sin6 = (const struct sockaddr_in6*)(const void*)addr;
+        const uint8_t* in = sin6->sin6_addr.s6_addr;
+        unsigned mask_adj = 0;
+        uint32_t ipv4 = 0;
+        if(!memcmp(in, pfx_v4mapped, 12) || !memcmp(in, pfx_siit, 12) || !memcmp(in, pfx_wkp, 12)) {
+            ipv4 = shm_get_ip4(&in[12]);
+            mask_adj = 96;
+        }
+        else if(!memcmp(in, pfx_teredo, 4)) {
+            ipv4 = shm_get_ip4(&in[12]) ^ 0xFFFFFFFF;
+            mask_adj = 96;
+        }
+        else if(!memcmp(in, pfx_6to4, 2)) {
+            ipv4 = shm_get_ip4(&in[2]);
+            mask_adj = 16;
+        }
+
+        if(mask_adj) {
+            unsigned temp_mask = 0;
+            rv = shm_lookup_v4(gen, ipv4, &temp_mask);
+            *scope_mask = temp_mask + mask_adj;
+        }
+        else {
+            rv = shm_lookup_v6(gen, in, scope_mask);
+        }
+    }
+    else {
+        return NULL;
+    }
+
+    // NN_UNDEF is never a real lookup result, but don't trust the data
+    if(rv == SHM_NN_UNDEF)
+        return NULL;
+    return &gen->base[shm_dclists(gen)[SHM_NN_GET_DCLIST(rv)]];
+}
+
+void gdmap_shm_close(gdmap_shm_t* shm) {
+    shm_gen_unmap(&shm->gen);
+    free(shm->path);
+    free(shm);
+}
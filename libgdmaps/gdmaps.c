@@ -31,6 +31,8 @@
 #include "nets.h"
 #include "gdgeoip.h"
 #include "gdgeoip2.h"
+#include "rttdb.h"
+#include "mapshm.h"
 
 #include <gdnsd/alloc.h>
 #include <gdnsd/dmn.h>
@@ -51,6 +53,7 @@
 #include <unistd.h>
 #include <sys/mman.h>
 #include <pthread.h>
+#include <time.h>
 
 #include <ev.h>
 
@@ -84,6 +87,10 @@ typedef struct {
     nlist_t* geoip_v4o_list; // optional v4 overlay
     nlist_t* nets_list; // net overrides, optional
     ntree_t* tree; // merged->translated from the lists above
+    unsigned tree_gen; // ->gen of the current tree
+    char* shm_path; // optional publication path for other processes
+    uint64_t shm_generation; // last published generation
+    bool shm_live; // publishing has started, see gdmap_setup_watchers()
     ev_stat* geoip_stat_watcher;
     ev_stat* geoip_v4o_stat_watcher;
     ev_stat* nets_stat_watcher;
@@ -91,7 +98,9 @@ typedef struct {
     ev_timer* geoip_v4o_reload_timer;
     ev_timer* nets_reload_timer;
     ev_timer* tree_update_timer;
+    unsigned rtt_hysteresis;
     bool geoip_is_v2;
+    bool geoip_is_rtt; // geoip_path is an RTT matrix, see rttdb.h
     bool city_no_region;
     bool city_auto_mode;
 } gdmap_t;
@@ -151,12 +160,35 @@ static gdmap_t* gdmap_new(const char* name, vscf_data_t* map_cfg, const fips_t*
         gdmap->geoip_is_v2 = true;
     }
 
+    // rtt_db config
+    vscf_data_t* rtt_cfg = vscf_hash_get_data_byconstkey(map_cfg, "rtt_db", true);
+    if(rtt_cfg) {
+        if(!vscf_is_simple(rtt_cfg) || !vscf_simple_get_len(rtt_cfg))
+            log_fatal("plugin_geoip: map '%s': 'rtt_db' must have a non-empty string value", name);
+        if(gdmap->geoip_path)
+            log_fatal("plugin_geoip: map '%s': 'rtt_db' cannot be combined with 'geoip_db' or 'geoip2_db'", name);
+        if(gdmap->city_auto_mode)
+            log_fatal("plugin_geoip: map '%s': 'rtt_db' cannot be combined with 'auto_dc_coords'", name);
+        gdmap->geoip_path = gdnsd_resolve_path_cfg(vscf_simple_get_data(rtt_cfg), "geoip");
+        gdmap->geoip_is_rtt = true;
+    }
+
+    vscf_data_t* rtt_hyst_cfg = vscf_hash_get_data_byconstkey(map_cfg, "rtt_hysteresis", true);
+    if(rtt_hyst_cfg) {
+        unsigned long hyst;
+        if(!rtt_cfg)
+            log_fatal("plugin_geoip: map '%s': 'rtt_hysteresis' requires 'rtt_db'", name);
+        if(!vscf_is_simple(rtt_hyst_cfg) || !vscf_simple_get_as_ulong(rtt_hyst_cfg, &hyst) || hyst > 65535U)
+            log_fatal("plugin_geoip: map '%s': 'rtt_hysteresis' must be an integer in the range 0 - 65535", name);
+        gdmap->rtt_hysteresis = (unsigned)hyst;
+    }
+
     // map config
     vscf_data_t* map_map = vscf_hash_get_data_byconstkey(map_cfg, "map", true);
     if(map_map) {
         if(!vscf_is_hash(map_map))
             log_fatal("plugin_geoip: map '%s': 'map' stanza must be a hash", name);
-        if(!gdmap->geoip_path)
+        if(!gdmap->geoip_path || gdmap->geoip_is_rtt)
             log_fatal("plugin_geoip: map '%s': 'map' stanza requires 'geoip_db'", name);
         gdmap->dcmap = dcmap_new(map_map, gdmap->dclists_pend, 0, 0, name, gdmap->city_auto_mode);
     }
@@ -185,12 +217,62 @@ static gdmap_t* gdmap_new(const char* name, vscf_data_t* map_cfg, const fips_t*
             log_fatal("plugin_geoip: map '%s': 'city_no_region' must be a boolean value ('true' or 'false')", name);
     }
 
+    // optional publication for other processes (see mapshm.h)
+    vscf_data_t* shm_cfg = vscf_hash_get_data_byconstkey(map_cfg, "shm_file", true);
+    if(shm_cfg) {
+        if(!vscf_is_simple(shm_cfg) || !vscf_simple_get_len(shm_cfg))
+            log_fatal("plugin_geoip: map '%s': 'shm_file' must have a non-empty string value", name);
+        gdmap->shm_path = gdnsd_resolve_path_run(vscf_simple_get_data(shm_cfg), NULL);
+    }
+
     // check for invalid keys
     vscf_hash_iterate_const(map_cfg, true, _gdmap_badkey, name);
 
     return gdmap;
 }
 
+// Publishes the current tree+dclists if configured.  Generations are
+//   based on the realtime clock so that they keep increasing across
+//   daemon restarts.
+F_NONNULL
+static void gdmap_shm_publish(gdmap_t* gdmap) {
+    dmn_assert(gdmap->shm_path);
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    uint64_t generation = (uint64_t)now.tv_sec * 1000000U + (uint64_t)now.tv_nsec / 1000U;
+    if(generation <= gdmap->shm_generation)
+        generation = gdmap->shm_generation + 1U;
+    if(!mapshm_publish(gdmap->shm_path, gdmap->name, generation, gdmap->tree, gdmap->dclists, gdmap->dcinfo))
+        gdmap->shm_generation = generation;
+}
+
+// swap in a new tree along with the pending dclists
+F_NONNULL
+static void gdmap_tree_swap(gdmap_t* gdmap, ntree_t* new_tree) {
+    dmn_assert(gdmap->dclists_pend);
+
+    ntree_t* old_tree = gdmap->tree;
+    dclists_t* old_lists = gdmap->dclists;
+    new_tree->gen = ++gdmap->tree_gen;
+
+    gdnsd_prcu_upd_lock();
+    gdnsd_prcu_upd_assign(gdmap->dclists, gdmap->dclists_pend);
+    gdnsd_prcu_upd_assign(gdmap->tree, new_tree);
+    gdnsd_prcu_upd_unlock();
+
+    gdmap->dclists_pend = NULL;
+    if(old_tree)
+        ntree_destroy(old_tree);
+    if(old_lists)
+        dclists_destroy(old_lists, KILL_NO_LISTS);
+
+    // The initial load is published when the watchers are set up instead,
+    //   as e.g. gdnsd_geoip_test and checkconf never get that far.
+    if(gdmap->shm_live)
+        gdmap_shm_publish(gdmap);
+}
+
 F_NONNULL
 static void gdmap_tree_update(gdmap_t* gdmap) {
     dmn_assert(gdmap->dclists_pend);
@@ -209,21 +291,28 @@ static void gdmap_tree_update(gdmap_t* gdmap) {
         merged = nlist_xlate_tree(gdmap->nets_list);
     }
 
-    ntree_t* old_tree = gdmap->tree;
-    dclists_t* old_lists = gdmap->dclists;
+    gdmap_tree_swap(gdmap, merged);
 
-    gdnsd_prcu_upd_lock();
-    gdnsd_prcu_upd_assign(gdmap->dclists, gdmap->dclists_pend);
-    gdnsd_prcu_upd_assign(gdmap->tree, merged);
-    gdnsd_prcu_upd_unlock();
+    log_info("plugin_geoip: map '%s' runtime db updated. nets: %u dclists: %u", gdmap->name, gdmap->tree->count + 1, dclists_get_count(gdmap->dclists));
+}
 
-    gdmap->dclists_pend = NULL;
-    if(old_tree)
-        ntree_destroy(old_tree);
-    if(old_lists)
-        dclists_destroy(old_lists, KILL_NO_LISTS);
+// Applies the difference between old_nets and the current nets_list
+//   directly to a copy of the current tree, which is only valid
+//   when the tree is otherwise up to date with the GeoIP lists.
+//   Returns true if a full update is required instead.
+F_NONNULL
+static bool gdmap_tree_update_nets(gdmap_t* gdmap, const nlist_t* old_nets) {
+    dmn_assert(gdmap->dclists_pend);
+    dmn_assert(gdmap->tree);
 
-    log_info("plugin_geoip: map '%s' runtime db updated. nets: %u dclists: %u", gdmap->name, gdmap->tree->count + 1, dclists_get_count(gdmap->dclists));
+    ntree_t* updated = nlist_nets_delta_tree(gdmap->tree, gdmap->geoip_list, gdmap->geoip_v4o_list, old_nets, gdmap->nets_list);
+    if(!updated)
+        return true;
+
+    gdmap_tree_swap(gdmap, updated);
+
+    log_info("plugin_geoip: map '%s' runtime db incrementally updated from nets changes. nets: %u dclists: %u", gdmap->name, gdmap->tree->count + 1, dclists_get_count(gdmap->dclists));
+    return false;
 }
 
 F_NONNULL
@@ -240,7 +329,21 @@ static bool gdmap_update_geoip(gdmap_t* gdmap, const char* path, nlist_t** out_l
 
     nlist_t* new_list;
 
-    if(gdmap->geoip_is_v2) {
+    if(gdmap->geoip_is_rtt) {
+        dmn_assert(v4o_flag == V4O_NONE);
+        // gdmap->tree and ->dclists are only replaced by this same
+        //   thread, so they can be read directly as the previous state
+        new_list = rttdb_make_list(
+            path,
+            gdmap->name,
+            update_dclists,
+            gdmap->dcinfo,
+            gdmap->rtt_hysteresis,
+            gdmap->tree,
+            gdmap->dclists
+        );
+    }
+    else if(gdmap->geoip_is_v2) {
         dmn_assert(!gdmap->geoip_v4o_path);
         dmn_assert(v4o_flag == V4O_NONE);
         new_list = gdgeoip2_make_list(
@@ -284,8 +387,10 @@ static bool gdmap_update_geoip(gdmap_t* gdmap, const char* path, nlist_t** out_l
     return rv;
 }
 
-F_NONNULL
-static bool gdmap_update_nets(gdmap_t* gdmap) {
+// If old_nets_ptr is non-NULL, the replaced nets list is handed
+//   back there rather than destroyed.
+F_NONNULLX(1)
+static bool gdmap_update_nets(gdmap_t* gdmap, nlist_t** old_nets_ptr) {
     dmn_assert(gdmap->nets_path);
 
     dclists_t* update_dclists;
@@ -326,7 +431,9 @@ static bool gdmap_update_nets(gdmap_t* gdmap) {
     else {
         if(!gdmap->dclists_pend)
             gdmap->dclists_pend = update_dclists;
-        if(gdmap->nets_list)
+        if(old_nets_ptr)
+            *old_nets_ptr = gdmap->nets_list;
+        else if(gdmap->nets_list)
             nlist_destroy(gdmap->nets_list);
         gdmap->nets_list = new_list;
     }
@@ -352,7 +459,7 @@ static void gdmap_initial_load_all(gdmap_t* gdmap) {
 
     if(!gdmap->nets_list) {
         dmn_assert(gdmap->nets_path);
-        if(gdmap_update_nets(gdmap))
+        if(gdmap_update_nets(gdmap, NULL))
             log_fatal("plugin_geoip: map '%s': cannot continue initial load", gdmap->name);
     }
 
@@ -411,10 +518,20 @@ static void gdmap_nets_reload_timer_cb(struct ev_loop* loop, ev_timer* w V_UNUSE
 
     ev_timer_stop(loop, gdmap->nets_reload_timer);
 
-    if(!gdmap_update_nets(gdmap)) {
+    // If no other changes are pending, the tree is up to date with
+    //   the GeoIP data and the nets changes can be applied to it
+    //   immediately, without the full rebuild and its quiescence wait.
+    const bool incremental = !gdmap->dclists_pend && gdmap->tree;
+    nlist_t* old_nets = NULL;
+
+    if(!gdmap_update_nets(gdmap, incremental ? &old_nets : NULL)) {
         dmn_assert(gdmap->dclists_pend);
-        gdmap_kick_tree_update(gdmap, loop);
+        if(!incremental || gdmap_tree_update_nets(gdmap, old_nets))
+            gdmap_kick_tree_update(gdmap, loop);
     }
+
+    if(old_nets)
+        nlist_destroy(old_nets);
 }
 
 F_NONNULL
@@ -547,6 +664,11 @@ static void gdmap_setup_watchers(gdmap_t* gdmap, struct ev_loop* loop) {
     ev_set_priority(gdmap->tree_update_timer, -2);
     gdmap->tree_update_timer->repeat = ALL_RELOAD_WAIT;
     gdmap->tree_update_timer->data = gdmap;
+
+    if(gdmap->shm_path) {
+        gdmap->shm_live = true;
+        gdmap_shm_publish(gdmap);
+    }
 }
 
 F_NONNULL F_PURE
@@ -694,6 +816,11 @@ const uint8_t* gdmaps_lookup(const gdmaps_t* gdmaps, const unsigned gdmap_idx, c
     return gdmap_lookup(gdmaps->maps[gdmap_idx], client, scope_mask);
 }
 
+unsigned gdmaps_map_gen(const gdmaps_t* gdmaps, const unsigned gdmap_idx) {
+    dmn_assert(gdmap_idx < gdmaps->count);
+    return gdnsd_prcu_rdr_deref(gdmaps->maps[gdmap_idx]->tree)->gen;
+}
+
 void gdmaps_load_databases(gdmaps_t* gdmaps) {
     for(unsigned i = 0; i < gdmaps->count; i++)
         gdmap_initial_load_all(gdmaps->maps[i]);
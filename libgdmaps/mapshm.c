@@ -0,0 +1,128 @@
+/* Copyright © 2012 Brandon L Black <blblack@gmail.com>
+ *
+ * This file is part of gdnsd.
+ *
+ * gdnsd-plugin-geoip is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gdnsd-plugin-geoip is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gdnsd.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <config.h>
+#include "mapshm.h"
+#include "mapshm_fmt.h"
+
+#include <gdnsd/alloc.h>
+#include <gdnsd/log.h>
+#include <gdnsd/misc.h>
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+F_NONNULL
+static bool mapshm_write(FILE* fp, const mapshm_hdr_t* hdr, const ntree_t* tree, const dclists_t* dclists, const dcinfo_t* dcinfo) {
+    const unsigned num_dcs = dcinfo_get_count(dcinfo);
+
+    // string offsets for dclists and dc names
+    uint64_t* dclist_offs = xmalloc(hdr->dclist_count * sizeof(uint64_t));
+    uint64_t* dcname_offs = xmalloc((num_dcs + 1) * sizeof(uint64_t));
+    uint64_t pos = hdr->strings_off;
+    for(unsigned i = 0; i < hdr->dclist_count; i++) {
+        dclist_offs[i] = pos;
+        pos += strlen((const char*)dclists_get_list(dclists, i)) + 1;
+    }
+    dcname_offs[0] = 0;
+    for(unsigned i = 1; i <= num_dcs; i++) {
+        dcname_offs[i] = pos;
+        pos += strlen(dcinfo_num2name(dcinfo, i)) + 1;
+    }
+    dmn_assert(pos == hdr->size);
+
+    bool failed = fwrite(hdr, sizeof(*hdr), 1, fp) != 1
+        || fwrite(tree->store, sizeof(nnode_t), tree->count, fp) != tree->count
+        || fwrite(dclist_offs, sizeof(uint64_t), hdr->dclist_count, fp) != hdr->dclist_count
+        || fwrite(dcname_offs, sizeof(uint64_t), num_dcs + 1, fp) != num_dcs + 1;
+
+    for(unsigned i = 0; !failed && i < hdr->dclist_count; i++) {
+        const char* dclist = (const char*)dclists_get_list(dclists, i);
+        failed = fwrite(dclist, strlen(dclist) + 1, 1, fp) != 1;
+    }
+    for(unsigned i = 1; !failed && i <= num_dcs; i++) {
+        const char* dcname = dcinfo_num2name(dcinfo, i);
+        failed = fwrite(dcname, strlen(dcname) + 1, 1, fp) != 1;
+    }
+
+    free(dcname_offs);
+    free(dclist_offs);
+    return failed;
+}
+
+bool mapshm_publish(const char* path, const char* map_name, const uint64_t generation, const ntree_t* tree, const dclists_t* dclists, const dcinfo_t* dcinfo) {
+    dmn_assert(!tree->alloc); // ntree_finish() was called
+
+    mapshm_hdr_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, MAPSHM_MAGIC, sizeof(hdr.magic));
+    hdr.version = MAPSHM_VERSION;
+    hdr.endian = MAPSHM_ENDIAN;
+    hdr.generation = generation;
+    hdr.node_count = tree->count;
+    hdr.ipv4 = tree->ipv4;
+    hdr.dclist_count = dclists_get_count(dclists);
+    hdr.num_dcs = dcinfo_get_count(dcinfo);
+    hdr.nodes_off = sizeof(hdr);
+    hdr.dclists_off = hdr.nodes_off + (uint64_t)hdr.node_count * sizeof(nnode_t);
+    hdr.dcnames_off = hdr.dclists_off + (uint64_t)hdr.dclist_count * sizeof(uint64_t);
+    hdr.strings_off = hdr.dcnames_off + (uint64_t)(hdr.num_dcs + 1) * sizeof(uint64_t);
+    hdr.size = hdr.strings_off;
+    for(unsigned i = 0; i < hdr.dclist_count; i++)
+        hdr.size += strlen((const char*)dclists_get_list(dclists, i)) + 1;
+    for(unsigned i = 1; i <= hdr.num_dcs; i++)
+        hdr.size += strlen(dcinfo_num2name(dcinfo, i)) + 1;
+
+    char* tmp_path = gdnsd_str_combine(path, ".tmp", NULL);
+    bool failed = true;
+    const int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd < 0) {
+        log_err("plugin_geoip: map '%s': cannot create '%s': %s", map_name, tmp_path, dmn_logf_errno());
+    }
+    else {
+        FILE* fp = fdopen(fd, "w");
+        if(!fp) {
+            log_err("plugin_geoip: map '%s': fdopen('%s') failed: %s", map_name, tmp_path, dmn_logf_errno());
+            close(fd);
+        }
+        else {
+            failed = mapshm_write(fp, &hdr, tree, dclists, dcinfo);
+            if(fclose(fp))
+                failed = true;
+            if(failed)
+                log_err("plugin_geoip: map '%s': failed to write '%s': %s", map_name, tmp_path, dmn_logf_errno());
+            else if(rename(tmp_path, path)) {
+                log_err("plugin_geoip: map '%s': rename('%s', '%s') failed: %s", map_name, tmp_path, path, dmn_logf_errno());
+                failed = true;
+            }
+        }
+        if(failed)
+            unlink(tmp_path);
+    }
+
+    if(!failed)
+        log_info("plugin_geoip: map '%s': published generation %" PRIu64 " to '%s' (%" PRIu64 " bytes)", map_name, generation, path, hdr.size);
+
+    free(tmp_path);
+    return failed;
+}
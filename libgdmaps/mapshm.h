@@ -0,0 +1,40 @@
+/* Copyright © 2012 Brandon L Black <blblack@gmail.com>
+ *
+ * This file is part of gdnsd.
+ *
+ * gdnsd-plugin-geoip is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gdnsd-plugin-geoip is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gdnsd.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef MAPSHM_H
+#define MAPSHM_H
+
+#include "dcinfo.h"
+#include "dclists.h"
+#include "ntree.h"
+
+#include <gdnsd/compiler.h>
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+// Publishes the tree and dclists of a map to "path" (via a temporary
+//   file and rename()), for lookups by other processes through
+//   libgdmap_shm (see include/gdnsd/gdmap_shm.h).  Failures are logged,
+//   and are non-fatal (retval true).
+F_NONNULL
+bool mapshm_publish(const char* path, const char* map_name, const uint64_t generation, const ntree_t* tree, const dclists_t* dclists, const dcinfo_t* dcinfo);
+
+#endif // MAPSHM_H
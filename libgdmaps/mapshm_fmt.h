@@ -0,0 +1,59 @@
+/* Copyright © 2012 Brandon L Black <blblack@gmail.com>
+ *
+ * This file is part of gdnsd.
+ *
+ * gdnsd-plugin-geoip is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gdnsd-plugin-geoip is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gdnsd.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef MAPSHM_FMT_H
+#define MAPSHM_FMT_H
+
+// The on-disk (well, usually in-tmpfs) format of a published map, shared
+//   by the writer in mapshm.c and the reader library in gdmap_shm.c.
+// A published file is never modified in place: each new generation is
+//   written to a temporary file and renamed over the old one, so readers
+//   holding a mapping of an older generation are never disturbed.
+// All values are in host byte order, as these files are only meant for
+//   other processes on the same host, which is what "endian" checks.
+// After the header come the tree nodes (nnode_t's layout, see ntree.h),
+//   then the offsets of the dclist strings, then the offsets of the
+//   datacenter name strings (one per dcnum, with index 0 unused), then
+//   the strings themselves, all NUL-terminated.  All offsets are relative
+//   to the start of the file, and the file itself ends in a NUL byte.
+
+#include <inttypes.h>
+
+#define MAPSHM_MAGIC "GDMAPSHM"
+#define MAPSHM_VERSION 1U
+#define MAPSHM_ENDIAN 0x01020304U
+
+typedef struct {
+    char magic[8];          // MAPSHM_MAGIC, without NUL
+    uint32_t version;       // MAPSHM_VERSION
+    uint32_t endian;        // MAPSHM_ENDIAN
+    uint64_t generation;    // unique per publication, increasing
+    uint64_t size;          // total size of the file
+    uint32_t node_count;    // count of nodes
+    uint32_t ipv4;          // node (or terminal) for ::/96, see ntree.h
+    uint32_t dclist_count;  // count of dclists
+    uint32_t num_dcs;       // count of datacenters
+    uint64_t nodes_off;     // uint32_t[node_count][2]: zero, one
+    uint64_t dclists_off;   // uint64_t[dclist_count]: dclist string offsets
+    uint64_t dcnames_off;   // uint64_t[num_dcs + 1]: dc name offsets
+    uint64_t strings_off;   // start of string storage
+} mapshm_hdr_t;
+
+#endif // MAPSHM_FMT_H
@@ -44,8 +44,7 @@ static bool v6_subnet_of(const uint8_t* check, const unsigned check_mask, const
     return rv;
 }
 
-F_NONNULL F_PURE
-static bool check_v4_issues(const uint8_t* ipv6, const unsigned mask) {
+bool nets_check_v4_issues(const uint8_t* ipv6, const unsigned mask) {
     dmn_assert(mask < 129);
 
     return (
@@ -99,7 +98,7 @@ static bool nets_parse(vscf_data_t* nets_cfg, dclists_t* dclists, const char* ma
                 break;
             }
             memcpy(ipv6, tempsin.sin6.sin6_addr.s6_addr, 16);
-            if(check_v4_issues(ipv6, mask)) {
+            if(nets_check_v4_issues(ipv6, mask)) {
                 log_err("plugin_geoip: map '%s': 'nets' entry '%s/%s' covers illegal IPv4-like space, see the documentation for more info", map_name, net_str, mask_str);
                 rv = true;
                 break;
@@ -25,6 +25,13 @@
 
 #include <gdnsd/vscf.h>
 
+#include <inttypes.h>
+
+// true if the network overlaps the IPv4-like spaces (v4mapped, SIIT,
+//   WKP, 6to4, and Teredo), which can't be given dclists directly
+F_NONNULL F_PURE
+bool nets_check_v4_issues(const uint8_t* ipv6, const unsigned mask);
+
 F_NONNULLX(2, 3)
 nlist_t* nets_make_list(vscf_data_t* nets_cfg, dclists_t* dclists, const char* map_name);
 
@@ -491,3 +491,240 @@ ntree_t* nlist_merge3_tree(const nlist_t* nl_a, const nlist_t* nl_b, const nlist
     nlist_destroy(merge2);
     return rv;
 }
+
+// Index of the first entry in the list which sorts at or after
+//   "net" itself, which is where any subnets of it begin
+F_NONNULL F_PURE
+static unsigned nlist_lower_bound(const nlist_t* nl, const net_t* net) {
+    unsigned lo = 0;
+    unsigned hi = nl->count;
+    while(lo < hi) {
+        const unsigned mid = lo + ((hi - lo) >> 1);
+        if(net_sorter(&nl->nets[mid], net) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Index of the first entry at or after "lo" (from _lower_bound() above)
+//   which is not a subnet of "net".  In a normalized list, the
+//   subnets of "net" are a contiguous run starting at "lo".
+F_NONNULL F_PURE
+static unsigned nlist_subnets_end(const nlist_t* nl, const net_t* net, unsigned lo) {
+    unsigned hi = nl->count;
+    while(lo < hi) {
+        const unsigned mid = lo + ((hi - lo) >> 1);
+        if(net_subnet_of(&nl->nets[mid], net))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+F_NONNULL F_PURE
+static unsigned nlist_count_within(const nlist_t* nl, const net_t* net) {
+    const unsigned lo = nlist_lower_bound(nl, net);
+    return nlist_subnets_end(nl, net, lo) - lo;
+}
+
+// Finds the deepest strict supernet of "net" in the list, if any,
+//   by exact searches for each shorter mask in turn.
+F_NONNULL
+static const net_t* nlist_find_cover(const nlist_t* nl, const net_t* net) {
+    net_t key = *net;
+    unsigned mask = net->mask;
+    while(mask--) {
+        key.ipv6[mask >> 3] &= ~(1U << (~mask & 7));
+        key.mask = mask;
+        const net_t* found = bsearch(&key, nl->nets, nl->count, sizeof(net_t), net_sorter);
+        if(found)
+            return found;
+    }
+    return NULL;
+}
+
+// Creates a new normalized list which maps the space within "net"
+//   exactly the same way "nl" does, and has nothing outside of it:
+//   the deepest enclosing entry of "nl" is clipped down to "net" itself,
+//   followed by all of the entries of "nl" which are subnets of "net".
+F_NONNULL F_WUNUSED
+static nlist_t* nlist_clip(const nlist_t* nl, const net_t* net) {
+    dmn_assert(nl->normalized);
+
+    nlist_t* clipped = nlist_new(nl->map_name, false);
+    const unsigned lo = nlist_lower_bound(nl, net);
+    const unsigned hi = nlist_subnets_end(nl, net, lo);
+
+    if(lo == hi || !net_eq(&nl->nets[lo], net)) {
+        const net_t* cover = nlist_find_cover(nl, net);
+        if(cover)
+            nlist_append(clipped, net->ipv6, net->mask, cover->dclist);
+    }
+
+    for(unsigned i = lo; i < hi; i++)
+        nlist_append(clipped, nl->nets[i].ipv6, nl->nets[i].mask, nl->nets[i].dclist);
+
+    nlist_finish(clipped);
+    return clipped;
+}
+
+// Like nlist_xlate_tree(), but for only the space within "net",
+//   given a list with no entries outside of it.  The result is
+//   either a terminal dclist or the index of a new subtree root
+//   within "nt", for ntree_graft().
+F_NONNULL
+static unsigned nlist_xlate_subtree(const nlist_t* nl, ntree_t* nt, const net_t* net) {
+    dmn_assert(nl->normalized);
+
+    const net_t* nlnet = &nl->nets[0];
+    const net_t* const nlnet_end = &nl->nets[nl->count];
+    net_t tree_net = *net;
+    tree_net.dclist = 0;
+
+    // As with ::/0 in the full case, an entry for "net" itself
+    //   is just the default for the rest
+    if(nl->count && net_eq(nlnet, net)) {
+        tree_net.dclist = nlnet->dclist;
+        nlnet++;
+    }
+
+    unsigned rv;
+    if(nlnet < nlnet_end)
+        rv = nxt_rec(&nlnet, nlnet_end, nt, tree_net);
+    else
+        rv = NN_SET_DCLIST(tree_net.dclist);
+
+    dmn_assert(nlnet == nlnet_end);
+    return rv;
+}
+
+// Above this fraction of the input list entries needing to be
+//   re-processed, or this fraction of the tree's nodes being orphaned,
+//   a full rebuild is the better option.
+#define DELTA_MAX_WORK_DIV 4U
+#define DELTA_MAX_ORPHAN_DIV 4U
+
+ntree_t* nlist_nets_delta_tree(const ntree_t* tree, const nlist_t* geoip, const nlist_t* geoip_v4o, const nlist_t* old_nets, const nlist_t* new_nets) {
+    dmn_assert(old_nets->normalized);
+    dmn_assert(new_nets->normalized);
+    dmn_assert(geoip || !geoip_v4o);
+
+    // Collect every network which was added, deleted, or had its dclist
+    //   changed.  Outside of these networks, the final mapping can't
+    //   have changed.  Normalization then reduces the set down to disjoint
+    //   networks (all with dummy dclist zero).
+    nlist_t* changed = nlist_new(new_nets->map_name, false);
+    const net_t* n_old = &old_nets->nets[0];
+    const net_t* n_new = &new_nets->nets[0];
+    const net_t* const end_old = &old_nets->nets[old_nets->count];
+    const net_t* const end_new = &new_nets->nets[new_nets->count];
+    while(n_old < end_old || n_new < end_new) {
+        int cmp;
+        if(n_old == end_old)
+            cmp = 1;
+        else if(n_new == end_new)
+            cmp = -1;
+        else
+            cmp = net_sorter(n_old, n_new);
+
+        if(cmp < 0) {
+            nlist_append(changed, n_old->ipv6, n_old->mask, 0);
+            n_old++;
+        }
+        else if(cmp > 0) {
+            nlist_append(changed, n_new->ipv6, n_new->mask, 0);
+            n_new++;
+        }
+        else {
+            if(n_old->dclist != n_new->dclist)
+                nlist_append(changed, n_new->ipv6, n_new->mask, 0);
+            n_old++;
+            n_new++;
+        }
+    }
+    nlist_finish(changed);
+
+    // Estimate the work as the count of list entries to re-process
+    unsigned total = new_nets->count;
+    if(geoip)
+        total += geoip->count;
+    if(geoip_v4o)
+        total += geoip_v4o->count;
+    unsigned work = 0;
+    for(unsigned i = 0; i < changed->count; i++) {
+        const net_t* net = &changed->nets[i];
+        if(!net->mask) {
+            work = total;
+            break;
+        }
+        work += 1 + nlist_count_within(new_nets, net);
+        if(geoip)
+            work += nlist_count_within(geoip, net);
+        if(geoip_v4o)
+            work += nlist_count_within(geoip_v4o, net);
+    }
+
+    if(work > total / DELTA_MAX_WORK_DIV) {
+        log_debug("plugin_geoip: map '%s': nets delta of %u networks is too large to apply incrementally", new_nets->map_name, changed->count);
+        nlist_destroy(changed);
+        return NULL;
+    }
+
+    // Re-translate the space within each changed network from clipped
+    //   copies of the input lists, and graft the results into a copy
+    //   of the existing tree.
+    ntree_t* nt = ntree_clone(tree);
+    for(unsigned i = 0; i < changed->count; i++) {
+        const net_t* net = &changed->nets[i];
+        nlist_t* merged = nlist_clip(new_nets, net);
+        if(geoip) {
+            nlist_t* sub_geoip = nlist_clip(geoip, net);
+            if(geoip_v4o) {
+                nlist_t* sub_v4o = nlist_clip(geoip_v4o, net);
+                nlist_t* merge1 = nlist_merge(sub_geoip, sub_v4o);
+                nlist_destroy(sub_v4o);
+                nlist_destroy(sub_geoip);
+                sub_geoip = merge1;
+            }
+            nlist_t* merge2 = nlist_merge(sub_geoip, merged);
+            nlist_destroy(sub_geoip);
+            nlist_destroy(merged);
+            merged = merge2;
+        }
+        const unsigned val = nlist_xlate_subtree(merged, nt, net);
+        ntree_graft(nt, net->ipv6, net->mask, val);
+        nlist_destroy(merged);
+    }
+    nlist_destroy(changed);
+
+    // Orphaned nodes are only reclaimed by a full rebuild
+    if(nt->orphans > nt->count / DELTA_MAX_ORPHAN_DIV) {
+        log_debug("plugin_geoip: map '%s': nets delta would leave too many orphaned tree nodes (%u/%u)", new_nets->map_name, nt->orphans, nt->count);
+        ntree_destroy(nt);
+        return NULL;
+    }
+
+    ntree_finish(nt);
+    ntree_assert_optimal(nt);
+
+#ifndef NDEBUG
+    // assert equivalence with a full rebuild in debug builds
+    ntree_t* full;
+    if(geoip) {
+        if(geoip_v4o)
+            full = nlist_merge3_tree(geoip, geoip_v4o, new_nets);
+        else
+            full = nlist_merge2_tree(geoip, new_nets);
+    }
+    else {
+        full = nlist_xlate_tree(new_nets);
+    }
+    ntree_assert_equiv(nt, full);
+    ntree_destroy(full);
+#endif
+
+    return nt;
+}
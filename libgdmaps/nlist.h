@@ -61,6 +61,16 @@ ntree_t* nlist_merge2_tree(const nlist_t* nl_a, const nlist_t* nl_b);
 F_NONNULL
 ntree_t* nlist_merge3_tree(const nlist_t* nl_a, const nlist_t* nl_b, const nlist_t* nl_c);
 
+// Builds an updated copy of "tree", which must have been created
+//   from the same geoip/geoip_v4o lists (either or both may be NULL,
+//   as with the functions above) and "old_nets", which reflects
+//   "new_nets" in place of "old_nets".  Only the parts of the tree
+//   within changed networks are re-translated, the rest is copied as-is.
+// Returns NULL if the change is large enough that a full rebuild
+//   via the functions above is the better option.
+F_NONNULLX(1, 4, 5) F_WUNUSED
+ntree_t* nlist_nets_delta_tree(const ntree_t* tree, const nlist_t* geoip, const nlist_t* geoip_v4o, const nlist_t* old_nets, const nlist_t* new_nets);
+
 // Just for debugging...
 F_NONNULL
 void nlist_debug_dump(const nlist_t* nl);
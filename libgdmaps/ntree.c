@@ -23,6 +23,8 @@
 #include <gdnsd/alloc.h>
 #include <gdnsd/log.h>
 
+#include <string.h>
+
 // Initial node allocation count,
 //   must be power of two due to alloc code,
 static const unsigned NT_SIZE_INIT = 128;
@@ -32,6 +34,22 @@ ntree_t* ntree_new(void) {
     newtree->store = xmalloc(NT_SIZE_INIT * sizeof(nnode_t));
     newtree->count = 0;
     newtree->alloc = NT_SIZE_INIT; // set to zero on fixation
+    newtree->orphans = 0;
+    newtree->gen = 0;
+    return newtree;
+}
+
+ntree_t* ntree_clone(const ntree_t* tree) {
+    dmn_assert(!tree->alloc); // only finished trees
+    ntree_t* newtree = xmalloc(sizeof(ntree_t));
+    newtree->alloc = NT_SIZE_INIT;
+    while(newtree->alloc <= tree->count)
+        newtree->alloc <<= 1;
+    newtree->store = xmalloc(newtree->alloc * sizeof(nnode_t));
+    memcpy(newtree->store, tree->store, tree->count * sizeof(nnode_t));
+    newtree->count = tree->count;
+    newtree->orphans = tree->orphans;
+    newtree->gen = 0;
     return newtree;
 }
 
@@ -110,20 +128,53 @@ void ntree_debug_dump(const ntree_t* tree) {
 // an ntree is optimal if it never has a terminal dclist value
 //   that's identical in the zero+one slots of a single node (which
 //   should have been merged up a layer to be optimal).  Note that
-//   we don't ever alias ntree subtrees...
+//   we don't ever alias ntree subtrees, and that we only check
+//   nodes reachable from the root, as _graft() leaves orphans behind.
+F_NONNULL
+static void ntree_assert_optimal_rec(const ntree_t* tree, const unsigned offset) {
+    dmn_assert(offset && offset < tree->count);
+    const nnode_t* current = &tree->store[offset];
+    dmn_assert(current->zero != current->one);
+    if(!NN_IS_DCLIST(current->zero))
+        ntree_assert_optimal_rec(tree, current->zero);
+    if(!NN_IS_DCLIST(current->one))
+        ntree_assert_optimal_rec(tree, current->one);
+}
+
 void ntree_assert_optimal(const ntree_t* tree) {
-    // note that for tree->count == 1 and the whole space
+    // note that for the root node and the whole space
     //   mapped to a single dclist, we can't optimize that to
     //   a full /0 mask, it has to be a pair of /1 results,
-    //   so we don't check that case.
-    if(tree->count > 1) {
-        for(unsigned offs = 0; offs < tree->count; offs++) {
-            const nnode_t* current = &tree->store[offs];
-            dmn_assert(current->zero != current->one);
-        }
+    //   so we don't check the root node itself.
+    const nnode_t* root = &tree->store[0];
+    if(!NN_IS_DCLIST(root->zero))
+        ntree_assert_optimal_rec(tree, root->zero);
+    if(!NN_IS_DCLIST(root->one))
+        ntree_assert_optimal_rec(tree, root->one);
+}
+
+// asserts that two optimal trees have identical lookup results,
+//   regardless of how their nodes are laid out in storage
+F_NONNULL
+static void ntree_assert_equiv_rec(const ntree_t* tree_a, const unsigned val_a, const ntree_t* tree_b, const unsigned val_b) {
+    dmn_assert(!NN_IS_DCLIST(val_a) == !NN_IS_DCLIST(val_b));
+    if(NN_IS_DCLIST(val_a)) {
+        dmn_assert(val_a == val_b);
+    }
+    else {
+        dmn_assert(val_a < tree_a->count && val_b < tree_b->count);
+        const nnode_t* node_a = &tree_a->store[val_a];
+        const nnode_t* node_b = &tree_b->store[val_b];
+        ntree_assert_equiv_rec(tree_a, node_a->zero, tree_b, node_b->zero);
+        ntree_assert_equiv_rec(tree_a, node_a->one, tree_b, node_b->one);
     }
 }
 
+void ntree_assert_equiv(const ntree_t* tree_a, const ntree_t* tree_b) {
+    ntree_assert_equiv_rec(tree_a, 0, tree_b, 0);
+    dmn_assert(tree_a->ipv4 == tree_b->ipv4 || !NN_IS_DCLIST(tree_a->ipv4));
+}
+
 #endif
 
 F_NONNULL
@@ -132,6 +183,68 @@ static bool CHKBIT_v6(const uint8_t* ipv6, const unsigned bit) {
     return ipv6[bit >> 3] & (1UL << (~bit & 7));
 }
 
+F_NONNULL F_PURE
+static unsigned ntree_count_nodes(const ntree_t* tree, const unsigned offset) {
+    dmn_assert(offset < tree->count);
+    const nnode_t* current = &tree->store[offset];
+    unsigned rv = 1;
+    if(!NN_IS_DCLIST(current->zero))
+        rv += ntree_count_nodes(tree, current->zero);
+    if(!NN_IS_DCLIST(current->one))
+        rv += ntree_count_nodes(tree, current->one);
+    return rv;
+}
+
+void ntree_graft(ntree_t* tree, const uint8_t* ipv6, const unsigned mask, const unsigned val) {
+    dmn_assert(tree->alloc);
+    dmn_assert(mask && mask < 129);
+
+    // path[depth] is the node whose zero/one slots are the
+    //   networks of mask depth+1 along the way to ipv6/mask
+    unsigned path[128];
+    unsigned offset = 0;
+    for(unsigned depth = 0; depth < mask - 1; depth++) {
+        path[depth] = offset;
+        const bool dir = CHKBIT_v6(ipv6, depth);
+        unsigned next = dir ? tree->store[offset].one : tree->store[offset].zero;
+        if(NN_IS_DCLIST(next)) {
+            // a terminal encloses the graft point, split it down a level
+            const unsigned term = next;
+            next = ntree_add_node(tree);
+            tree->store[next].zero = term;
+            tree->store[next].one = term;
+            if(dir)
+                tree->store[offset].one = next;
+            else
+                tree->store[offset].zero = next;
+        }
+        offset = next;
+    }
+    path[mask - 1] = offset;
+
+    nnode_t* parent = &tree->store[offset];
+    uint32_t* slot = CHKBIT_v6(ipv6, mask - 1) ? &parent->one : &parent->zero;
+    if(!NN_IS_DCLIST(*slot))
+        tree->orphans += ntree_count_nodes(tree, *slot);
+    *slot = val;
+
+    // re-collapse upwards, never collapsing the root itself
+    unsigned depth = mask - 1;
+    while(depth) {
+        const nnode_t* current = &tree->store[path[depth]];
+        if(current->zero != current->one)
+            break;
+        dmn_assert(NN_IS_DCLIST(current->zero));
+        const unsigned term = current->zero;
+        tree->orphans++;
+        depth--;
+        if(CHKBIT_v6(ipv6, depth))
+            tree->store[path[depth]].one = term;
+        else
+            tree->store[path[depth]].zero = term;
+    }
+}
+
 F_NONNULL
 static unsigned ntree_lookup_v6(const ntree_t* tree, const uint8_t* ip, unsigned* mask_out) {
     unsigned chkbit = 0;
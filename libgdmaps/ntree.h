@@ -122,6 +122,9 @@ typedef struct {
     unsigned count; // raw nodes, including interior ones
     unsigned alloc; // current allocation of store during construction,
                     //   set to zero after _finish()
+    unsigned orphans; // unreachable nodes left behind by _graft()
+    unsigned gen;     // set by the owner when publishing, so that readers
+                      //   can cache results derived from the tree
 } ntree_t;
 
 F_WUNUSED
@@ -139,14 +142,31 @@ unsigned ntree_add_node(ntree_t* tree);
 F_NONNULL
 void ntree_finish(ntree_t* tree);
 
+// Copies a finished tree into a new unfinished one, which can
+//   then be modified via _graft() and re-_finish()'d
+F_NONNULL F_WUNUSED
+ntree_t* ntree_clone(const ntree_t* tree);
+
+// Replaces the whole subtree for the network ipv6/mask (mask > 0)
+//   with "val" (a terminal dclist or a node index already added
+//   to the tree).  Collapsed terminals along the path are expanded
+//   as necessary, and the path is re-collapsed afterwards to keep the
+//   tree optimal.  Replaced nodes are not reclaimed, they're just
+//   counted in ->orphans.
+F_NONNULL
+void ntree_graft(ntree_t* tree, const uint8_t* ipv6, const unsigned mask, const unsigned val);
+
 #ifndef NDEBUG
 F_NONNULL
 void ntree_debug_dump(const ntree_t* tree);
 F_NONNULL
 void ntree_assert_optimal(const ntree_t* tree);
+F_NONNULL
+void ntree_assert_equiv(const ntree_t* tree_a, const ntree_t* tree_b);
 #else
 #define ntree_debug_dump(x)
 #define ntree_assert_optimal(x)
+#define ntree_assert_equiv(x, y)
 #endif
 
 F_NONNULL
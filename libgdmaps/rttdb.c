@@ -0,0 +1,221 @@
+/* Copyright © 2012 Brandon L Black <blblack@gmail.com>
+ *
+ * This file is part of gdnsd.
+ *
+ * gdnsd-plugin-geoip is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gdnsd-plugin-geoip is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gdnsd.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+#include "rttdb.h"
+#include "nets.h"
+
+#include <gdnsd/alloc.h>
+#include <gdnsd/file.h>
+#include <gdnsd/log.h>
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    const char* pathname;
+    const char* map_name;
+    dclists_t* dclists;
+    const dcinfo_t* dcinfo;
+    const ntree_t* prev_tree;
+    const dclists_t* prev_dclists;
+    unsigned hysteresis;
+    unsigned num_dcs;   // in the map
+    unsigned file_dcs;  // in the file
+    unsigned* file2dc;  // file column -> map dcnum, 0 if unknown
+    unsigned* rtts;     // scratch, per map dcnum (so index 0 is unused)
+} rttdb_t;
+
+// The previous first-choice datacenter for the network starting at ipv6
+F_NONNULL
+static unsigned rttdb_prev_first(const rttdb_t* rdb, const uint8_t* ipv6) {
+    dmn_assert(rdb->prev_tree);
+    dmn_assert(rdb->prev_dclists);
+
+    client_info_t cinfo;
+    memset(&cinfo, 0, sizeof(cinfo));
+    cinfo.edns_client.sin6.sin6_family = AF_INET6;
+    memcpy(cinfo.edns_client.sin6.sin6_addr.s6_addr, ipv6, 16U);
+    cinfo.edns_client.len = sizeof(struct sockaddr_in6);
+    cinfo.edns_client_mask = 128U;
+
+    unsigned scope_mask;
+    const unsigned dclist = ntree_lookup(rdb->prev_tree, &cinfo, &scope_mask);
+    return dclists_get_list(rdb->prev_dclists, dclist)[0];
+}
+
+F_NONNULL
+static uint32_t rttdb_rec_dclist(const rttdb_t* rdb, const uint8_t* ipv6, const uint8_t* rec_rtts) {
+    unsigned* rtts = rdb->rtts;
+    for(unsigned dcnum = 1; dcnum <= rdb->num_dcs; dcnum++)
+        rtts[dcnum] = RTTDB_RTT_NONE;
+    for(unsigned col = 0; col < rdb->file_dcs; col++) {
+        if(rdb->file2dc[col]) {
+            uint16_t rtt;
+            memcpy(&rtt, &rec_rtts[col * 2U], sizeof(rtt));
+            rtts[rdb->file2dc[col]] = rtt;
+        }
+    }
+
+    // stable insertion sort by RTT, so ties and the unmeasured
+    //   remain in the map's datacenter order
+    uint8_t list[256];
+    for(unsigned i = 0; i < rdb->num_dcs; i++) {
+        const unsigned dcnum = i + 1U;
+        unsigned j = i;
+        while(j && rtts[list[j - 1U]] > rtts[dcnum]) {
+            list[j] = list[j - 1U];
+            j--;
+        }
+        list[j] = (uint8_t)dcnum;
+    }
+    list[rdb->num_dcs] = 0;
+
+    if(rdb->prev_tree && rdb->hysteresis && rtts[list[0]] != RTTDB_RTT_NONE) {
+        const unsigned prev = rttdb_prev_first(rdb, ipv6);
+        if(prev && prev != list[0] && rtts[prev] != RTTDB_RTT_NONE
+            && rtts[prev] - rtts[list[0]] <= rdb->hysteresis) {
+            unsigned pos = 1;
+            while(list[pos] != prev)
+                pos++;
+            memmove(&list[1], &list[0], pos);
+            list[0] = (uint8_t)prev;
+        }
+    }
+
+    return dclists_find_or_add_raw(rdb->dclists, list, rdb->map_name);
+}
+
+F_NONNULL
+static bool rttdb_parse(rttdb_t* rdb, const uint8_t* data, const size_t len, nlist_t* nl) {
+    rttdb_hdr_t hdr;
+    if(len < sizeof(hdr)) {
+        log_err("plugin_geoip: map '%s': RTT matrix '%s' is too small", rdb->map_name, rdb->pathname);
+        return true;
+    }
+    memcpy(&hdr, data, sizeof(hdr));
+    if(memcmp(hdr.magic, RTTDB_MAGIC, sizeof(hdr.magic)) || hdr.version != RTTDB_VERSION || hdr.endian != RTTDB_ENDIAN) {
+        log_err("plugin_geoip: map '%s': RTT matrix '%s' has a bad header (wrong magic, version, or byte order)", rdb->map_name, rdb->pathname);
+        return true;
+    }
+    if(!hdr.num_dcs || hdr.num_dcs > 65535U) {
+        log_err("plugin_geoip: map '%s': RTT matrix '%s' has an invalid datacenter count %" PRIu32, rdb->map_name, rdb->pathname, hdr.num_dcs);
+        return true;
+    }
+
+    const size_t rec_size = RTTDB_REC_SIZE(hdr.num_dcs);
+    const size_t names_size = (size_t)hdr.num_dcs * RTTDB_DCNAME_LEN;
+    if(len != sizeof(hdr) + names_size + (size_t)hdr.num_nets * rec_size) {
+        log_err("plugin_geoip: map '%s': RTT matrix '%s' has the wrong size for %" PRIu32 " datacenters and %" PRIu32 " networks", rdb->map_name, rdb->pathname, hdr.num_dcs, hdr.num_nets);
+        return true;
+    }
+
+    rdb->file_dcs = hdr.num_dcs;
+    rdb->file2dc = xcalloc(hdr.num_dcs, sizeof(unsigned));
+    const char* names = (const char*)&data[sizeof(hdr)];
+    for(unsigned col = 0; col < hdr.num_dcs; col++) {
+        const char* name = &names[col * RTTDB_DCNAME_LEN];
+        if(!memchr(name, 0, RTTDB_DCNAME_LEN)) {
+            log_err("plugin_geoip: map '%s': RTT matrix '%s': datacenter name #%u is not NUL-terminated", rdb->map_name, rdb->pathname, col);
+            return true;
+        }
+        const unsigned dcnum = dcinfo_name2num(rdb->dcinfo, name);
+        if(!dcnum) {
+            log_warn("plugin_geoip: map '%s': RTT matrix '%s': ignoring unknown datacenter '%s'", rdb->map_name, rdb->pathname, name);
+            continue;
+        }
+        for(unsigned i = 0; i < col; i++) {
+            if(rdb->file2dc[i] == dcnum) {
+                log_err("plugin_geoip: map '%s': RTT matrix '%s': datacenter '%s' is listed more than once", rdb->map_name, rdb->pathname, name);
+                return true;
+            }
+        }
+        rdb->file2dc[col] = dcnum;
+    }
+
+    const uint8_t* rec = &data[sizeof(hdr) + names_size];
+    for(unsigned i = 0; i < hdr.num_nets; i++, rec += rec_size) {
+        const uint8_t* ipv6 = rec;
+        const unsigned mask = rec[16];
+        if(mask > 128U) {
+            log_err("plugin_geoip: map '%s': RTT matrix '%s': network #%u has an illegal mask (>128)", rdb->map_name, rdb->pathname, i);
+            return true;
+        }
+        for(unsigned bit = mask; bit < 128U; bit++) {
+            if(ipv6[bit >> 3] & (1U << (~bit & 7U))) {
+                log_err("plugin_geoip: map '%s': RTT matrix '%s': network #%u has bits set beyond its mask", rdb->map_name, rdb->pathname, i);
+                return true;
+            }
+        }
+        if(nets_check_v4_issues(ipv6, mask)) {
+            log_err("plugin_geoip: map '%s': RTT matrix '%s': network #%u covers illegal IPv4-like space, see the documentation for more info", rdb->map_name, rdb->pathname, i);
+            return true;
+        }
+        nlist_append(nl, ipv6, mask, rttdb_rec_dclist(rdb, ipv6, &rec[20]));
+    }
+
+    return false;
+}
+
+nlist_t* rttdb_make_list(const char* pathname, const char* map_name, dclists_t* dclists, const dcinfo_t* dcinfo, const unsigned hysteresis, const ntree_t* prev_tree, const dclists_t* prev_dclists) {
+    log_info("plugin_geoip: map '%s': Processing RTT matrix '%s'", map_name, pathname);
+
+    gdnsd_fmap_t* fmap = gdnsd_fmap_new(pathname, true);
+    if(!fmap) {
+        log_err("plugin_geoip: map '%s': Cannot load '%s'", map_name, pathname);
+        return NULL;
+    }
+
+    const unsigned num_dcs = dcinfo_get_count(dcinfo);
+    rttdb_t rdb = {
+        .pathname = pathname,
+        .map_name = map_name,
+        .dclists = dclists,
+        .dcinfo = dcinfo,
+        .prev_tree = prev_tree,
+        .prev_dclists = prev_dclists,
+        .hysteresis = hysteresis,
+        .num_dcs = num_dcs,
+        .file_dcs = 0,
+        .file2dc = NULL,
+        .rtts = xmalloc((num_dcs + 1U) * sizeof(unsigned)),
+    };
+
+    nlist_t* nl = nlist_new(map_name, false);
+    const bool parse_rv = rttdb_parse(&rdb, gdnsd_fmap_get_buf(fmap), gdnsd_fmap_get_len(fmap), nl);
+    const bool close_rv = gdnsd_fmap_delete(fmap);
+    free(rdb.file2dc);
+    free(rdb.rtts);
+
+    if(parse_rv || close_rv) {
+        nlist_destroy(nl);
+        return NULL;
+    }
+
+    // as with nets_make_list(), mask out the v4-like spaces
+    nlist_append(nl, start_v4mapped, 96, NN_UNDEF);
+    nlist_append(nl, start_siit, 96, NN_UNDEF);
+    nlist_append(nl, start_wkp, 96, NN_UNDEF);
+    nlist_append(nl, start_6to4, 16, NN_UNDEF);
+    nlist_append(nl, start_teredo, 32, NN_UNDEF);
+    nlist_finish(nl);
+    return nl;
+}
@@ -0,0 +1,74 @@
+/* Copyright © 2012 Brandon L Black <blblack@gmail.com>
+ *
+ * This file is part of gdnsd.
+ *
+ * gdnsd-plugin-geoip is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gdnsd-plugin-geoip is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gdnsd.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef RTTDB_H
+#define RTTDB_H
+
+#include "dcinfo.h"
+#include "dclists.h"
+#include "nlist.h"
+#include "ntree.h"
+
+#include <gdnsd/compiler.h>
+
+#include <inttypes.h>
+
+// The input format of an "rtt_db" file, a matrix of measured round-trip
+//   times from client networks to datacenters, which is mmap()'d and read
+//   in place.  All values are in host byte order, which is what "endian"
+//   checks, so the file should be generated on a host of the same
+//   endianness.
+// After the header come "num_dcs" datacenter names, each in a field of
+//   RTTDB_DCNAME_LEN bytes and NUL-padded, and then "num_nets" network
+//   records of RTTDB_REC_SIZE(num_dcs) bytes each:
+//     uint8_t ipv6[16]   // network, IPv4 as ::A.B.C.D (v4compat)
+//     uint8_t mask       // 0 - 128, with IPv4 masks offset by 96
+//     uint8_t pad[3]
+//     uint16_t rtt[num_dcs] // per datacenter, in the order of the names
+//     (zero-padding to a 4-byte boundary)
+// RTTs are in any unit (milliseconds are suggested), as long as the map's
+//   "rtt_hysteresis" uses the same one.  RTTDB_RTT_NONE means the
+//   datacenter wasn't measured for this network.  Datacenter names which
+//   aren't in the map's "datacenters" are ignored, and the map's
+//   datacenters that aren't in the file are treated as unmeasured.
+
+#define RTTDB_MAGIC "GDRTTMAT"
+#define RTTDB_VERSION 1U
+#define RTTDB_ENDIAN 0x01020304U
+#define RTTDB_DCNAME_LEN 32U
+#define RTTDB_RTT_NONE UINT16_MAX
+#define RTTDB_REC_SIZE(_num_dcs) ((20U + 2U * (_num_dcs) + 3U) & ~3U)
+
+typedef struct {
+    char magic[8];     // RTTDB_MAGIC, without NUL
+    uint32_t version;  // RTTDB_VERSION
+    uint32_t endian;   // RTTDB_ENDIAN
+    uint32_t num_dcs;  // count of datacenter name fields
+    uint32_t num_nets; // count of network records
+} rttdb_hdr_t;
+
+// Each network's dclist is the map's datacenters in ascending RTT order,
+//   with unmeasured ones last, in the map's order.  If "prev_tree" (with
+//   its "prev_dclists") is given, which should be the map's current
+//   runtime data, then a network's previous first choice is kept first
+//   as long as its RTT is within "hysteresis" of the new lowest RTT.
+F_NONNULLX(1,2,3,4)
+nlist_t* rttdb_make_list(const char* pathname, const char* map_name, dclists_t* dclists, const dcinfo_t* dcinfo, const unsigned hysteresis, const ntree_t* prev_tree, const dclists_t* prev_dclists);
+
+#endif // RTTDB_H
@@ -20,7 +20,6 @@
 #include <config.h>
 #include <gdnsd/misc.h>
 #include <gdnsd-prot/misc.h>
-#include "misc.h"
 
 #include <gdnsd/alloc.h>
 #include <gdnsd/log.h>
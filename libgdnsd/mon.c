@@ -31,10 +31,14 @@
 #include <gdnsd/prcu.h>
 #include <gdnsd/vscf.h>
 #include <gdnsd/misc.h>
+#include <gdnsd/stats.h>
 
+#include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <fnmatch.h>
+#include <pthread.h>
 
 #include <ev.h>
 
@@ -46,6 +50,7 @@ typedef struct {
     unsigned down_thresh;
     unsigned interval;
     unsigned timeout;
+    double jitter;
 } service_type_t;
 
 // if type is NULL, there is no real monitoring,
@@ -66,6 +71,10 @@ typedef struct {
     unsigned n_success;
     bool is_cname;
     gdnsd_sttl_t real_sttl;
+    // the latest state from the monitor itself, which is owned by the
+    //   monitoring shard of this smgr (real_sttl is updated from it later)
+    gdnsd_sttl_t mon_sttl;
+    double start_delay; // see gdnsd_mon_get_start_delay()
 } smgr_t;
 
 static unsigned num_svc_types = 0;
@@ -77,44 +86,171 @@ static smgr_t* smgrs = NULL;
 // There are two copies of the sttl table.
 // The "consumer" copy is always ready for consumption
 //   (via prcu deref) by other threads, and does not
-//   get mutated directly.  The updates flow into
-//   the non-consumer table and the tables are later
-//   prcu swapped (with the old copy updated to new values)
-// There are only ever the two chunks of memory that are
-//   first allocated for these, they just get swapped around
-//   and copied over each other.
+//   get mutated directly.  It is split into pages of
+//   GDNSD_STTL_PAGE_SIZE entries.  The updates flow into
+//   the flat smgr_sttl table via sttl_set(), which tracks
+//   the dirty pages.  Later, fresh copies of only the dirty
+//   pages are published under a new page table, and the
+//   replaced pages are freed after the prcu swap.
 // (see sttl_table_update() below)
 static gdnsd_sttl_t* smgr_sttl = NULL;
-gdnsd_sttl_t* smgr_sttl_consumer_ = NULL;
+gdnsd_sttl_tbl_t* smgr_sttl_consumer_ = NULL;
+static bool* sttl_page_dirty = NULL;
+static unsigned* sttl_dirty_pages = NULL;
+static unsigned sttl_num_dirty = 0;
+
+// counts of table publications and of the sttl changes they carried
+static stats_t sttl_publications;
+static stats_t sttl_changes;
 
 static unsigned max_stats_len = 0;
 
+// Recent check history of each monitored smgr, for the check history
+//   stats output.  Each smgr with a type has MON_HIST_SIZE entries at
+//   mon_hist[idx * MON_HIST_SIZE] used as a ring buffer, the next slot
+//   being mon_hist_count[idx] % MON_HIST_SIZE.  These are written by the
+//   monitoring shards and read by the statio thread, under one of the
+//   mon_hist_locks[] selected by idx.
+#define MON_HIST_SIZE 16U
+#define MON_HIST_LOCKS 64U
+#define MON_HIST_LAT_NONE 0x7FFFFFFFU
+
+typedef struct {
+    uint32_t when;       // unix time
+    uint32_t lat_us : 31; // latency in microseconds, or MON_HIST_LAT_NONE
+    uint32_t ok : 1;
+} mon_hist_ent_t;
+
+static mon_hist_ent_t* mon_hist = NULL;
+static unsigned* mon_hist_count = NULL;
+static pthread_mutex_t mon_hist_locks[MON_HIST_LOCKS];
+static unsigned max_hist_len = 0;
+
 static bool initial_round = false;
 static bool testsuite_nodelay = false;
 
 static struct ev_loop* mon_loop = NULL;
 static ev_timer* sttl_update_timer = NULL;
 
+// for jitter, per monitoring shard thread
+static __thread gdnsd_rstate32_t* jitter_rstate = NULL;
+
+// Runtime monitoring can be sharded across several threads, each with
+//   its own loop, by smgr index (see gdnsd_mon_get_loop()).  Shard zero
+//   is mon_loop itself, which also owns all of the state-table updates
+//   and admin_state processing.  The other shards queue up their state
+//   updates, which are applied in mon_loop via sttl_queue_async.
+typedef struct {
+    unsigned idx;
+    gdnsd_sttl_t sttl;
+} sttl_upd_t;
+
+typedef struct {
+    struct ev_loop* loop;
+    pthread_t threadid;
+    pthread_mutex_t lock; // protects the queue
+    sttl_upd_t* queue;
+    unsigned queue_len;
+    unsigned queue_alloc;
+    sttl_upd_t* spare; // swapped with queue when draining
+    unsigned spare_alloc;
+} mon_shard_t;
+
+static unsigned num_shards = 1;
+static mon_shard_t* shards = NULL;
+static ev_async* sttl_queue_async = NULL;
+static __thread unsigned this_shard = 0;
+static void sttl_queue_cb(struct ev_loop* loop, ev_async* w, int revents);
+
 #define DEF_UP_THRESH 20
 #define DEF_OK_THRESH 10
 #define DEF_DOWN_THRESH 10
 #define DEF_INTERVAL 10
+#define MAX_INTERVAL 3600U
 
 F_NONNULL
 static void sttl_table_update(struct ev_loop* loop V_UNUSED, ev_timer* w V_UNUSED, int revents V_UNUSED) {
     dmn_assert(w == sttl_update_timer);
     dmn_assert(revents == EV_TIMER);
 
-    // prcu-swap of the two tables
-    gdnsd_sttl_t* saved_old_consumer = smgr_sttl_consumer_;
-    gdnsd_prcu_upd_lock();
-    gdnsd_prcu_upd_assign(smgr_sttl_consumer_, smgr_sttl);
-    gdnsd_prcu_upd_unlock();
-    smgr_sttl = saved_old_consumer;
+    if(!sttl_num_dirty)
+        return;
 
-    // now copy the (new) consumer table back over the old one
-    //   that we're using for future offline updates until the next swap
-    memcpy(smgr_sttl, smgr_sttl_consumer_, sizeof(gdnsd_sttl_t) * num_smgrs);
+    // build a new page table sharing all of the clean pages,
+    //   with fresh copies of the dirty ones
+    gdnsd_sttl_tbl_t* old_tbl = smgr_sttl_consumer_;
+    const unsigned num_pages = old_tbl->num_pages;
+    gdnsd_sttl_tbl_t* new_tbl = xmalloc(sizeof(gdnsd_sttl_tbl_t) + (num_pages * sizeof(gdnsd_sttl_t*)));
+    new_tbl->num_pages = num_pages;
+    new_tbl->gen = old_tbl->gen + 1U;
+    memcpy(new_tbl->pages, old_tbl->pages, num_pages * sizeof(gdnsd_sttl_t*));
+
+    unsigned changes = 0;
+    for(unsigned i = 0; i < sttl_num_dirty; i++) {
+        const unsigned page = sttl_dirty_pages[i];
+        const unsigned base = page << GDNSD_STTL_PAGE_SHIFT;
+        const unsigned len = num_smgrs - base < GDNSD_STTL_PAGE_SIZE
+            ? num_smgrs - base : GDNSD_STTL_PAGE_SIZE;
+        const gdnsd_sttl_t* old_page = old_tbl->pages[page];
+        gdnsd_sttl_t* new_page = xcalloc(GDNSD_STTL_PAGE_SIZE, sizeof(gdnsd_sttl_t));
+        memcpy(new_page, &smgr_sttl[base], len * sizeof(gdnsd_sttl_t));
+        for(unsigned j = 0; j < len; j++)
+            if(new_page[j] != old_page[j])
+                changes++;
+        new_tbl->pages[page] = new_page;
+    }
+
+    // entries can change and change back between publications
+    if(changes) {
+        gdnsd_prcu_upd_lock();
+        gdnsd_prcu_upd_assign(smgr_sttl_consumer_, new_tbl);
+        gdnsd_prcu_upd_unlock();
+        stats_own_inc(&sttl_publications);
+        stats_own_set(&sttl_changes, stats_own_get(&sttl_changes) + changes);
+    }
+
+    // whichever table is not the consumer now, free its dirty pages
+    gdnsd_sttl_tbl_t* dead_tbl = changes ? old_tbl : new_tbl;
+    for(unsigned i = 0; i < sttl_num_dirty; i++) {
+        const unsigned page = sttl_dirty_pages[i];
+        free(dead_tbl->pages[page]);
+        sttl_page_dirty[page] = false;
+    }
+    free(dead_tbl);
+    sttl_num_dirty = 0;
+}
+
+// All changes to smgr_sttl[] after registration must go through here
+static void sttl_set(const unsigned idx, const gdnsd_sttl_t new_sttl) {
+    dmn_assert(idx < num_smgrs);
+    smgr_sttl[idx] = new_sttl;
+    const unsigned page = idx >> GDNSD_STTL_PAGE_SHIFT;
+    if(!sttl_page_dirty[page]) {
+        sttl_page_dirty[page] = true;
+        sttl_dirty_pages[sttl_num_dirty++] = page;
+    }
+}
+
+// Called when a new smgr is registered during configuration, before there
+//   are any consumers, so the consumer table can be grown in place.
+static void sttl_table_add(const unsigned idx, const gdnsd_sttl_t new_sttl) {
+    dmn_assert(idx == num_smgrs - 1U);
+    smgr_sttl = xrealloc(smgr_sttl, sizeof(gdnsd_sttl_t) * num_smgrs);
+    smgr_sttl[idx] = new_sttl;
+
+    const unsigned page = idx >> GDNSD_STTL_PAGE_SHIFT;
+    if(!(idx & GDNSD_STTL_PAGE_MASK)) { // first entry of a new page
+        const unsigned num_pages = page + 1U;
+        smgr_sttl_consumer_ = xrealloc(smgr_sttl_consumer_,
+            sizeof(gdnsd_sttl_tbl_t) + (num_pages * sizeof(gdnsd_sttl_t*)));
+        smgr_sttl_consumer_->num_pages = num_pages;
+        smgr_sttl_consumer_->gen = 0;
+        smgr_sttl_consumer_->pages[page] = xcalloc(GDNSD_STTL_PAGE_SIZE, sizeof(gdnsd_sttl_t));
+        sttl_page_dirty = xrealloc(sttl_page_dirty, num_pages * sizeof(bool));
+        sttl_page_dirty[page] = false;
+        sttl_dirty_pages = xrealloc(sttl_dirty_pages, num_pages * sizeof(unsigned));
+    }
+    smgr_sttl_consumer_->pages[page][idx & GDNSD_STTL_PAGE_MASK] = new_sttl;
 }
 
 // anything that ends up changing a value in smgr_sttl[] calls
@@ -196,28 +332,193 @@ bool gdnsd_mon_parse_sttl(const char* sttl_str, gdnsd_sttl_t* sttl_out, unsigned
     return failed;
 }
 
+// Index of the smgr descriptions for admin_state matching, which
+//   would otherwise have to fnmatch() every entry against every desc.
+// Entries without glob characters are looked up in a hash of the
+//   exact descs.  For globs, the candidates are narrowed down using a
+//   trie over the '/'-separated components of the descs: the complete
+//   literal components at the start of the glob select a subtree, and
+//   only the descs under it are fnmatch()'d.
+// The trie is built by inserting the descs in component-wise sorted
+//   order, which makes every subtree a contiguous range of admin_order[].
+
+typedef struct admin_trie_s admin_trie_t;
+struct admin_trie_s {
+    char* label; // one component, NULL at the root
+    admin_trie_t** children; // sorted by label
+    unsigned num_children;
+    unsigned first; // this subtree is admin_order[first ... last - 1]
+    unsigned last;
+};
+
+static unsigned admin_index_count = 0; // num_smgrs when built
+static unsigned* admin_order = NULL; // smgr indices, component-wise sorted
+static admin_trie_t* admin_trie = NULL;
+static unsigned* admin_exact = NULL; // smgr index + 1, zero is empty
+static unsigned admin_exact_mask = 0;
+
+F_CONST
+static unsigned count2mask(unsigned x) {
+    if(!x) return 1;
+    x |= x >> 1;
+    x |= x >> 2;
+    x |= x >> 4;
+    x |= x >> 8;
+    x |= x >> 16;
+    return x;
+}
+
+// strcmp(), but sorting '/' before all other characters, so that
+//   e.g. "a/b" < "a/b/c" < "a/b-c", keeping subtrees contiguous
+F_NONNULL F_PURE
+static int desc_cmp(const char* a, const char* b) {
+    while(*a && *a == *b) {
+        a++;
+        b++;
+    }
+    const unsigned ca = (*a == '/') ? 1U : (unsigned char)*a;
+    const unsigned cb = (*b == '/') ? 1U : (unsigned char)*b;
+    return (ca > cb) - (ca < cb);
+}
+
 F_NONNULL
-static bool admin_process_entry(const char* matchme, gdnsd_sttl_t* updates, gdnsd_sttl_t update_val) {
-    assert_valid_sttl(update_val);
-    dmn_assert(update_val & GDNSD_STTL_FORCED);
+static int admin_order_cmp(const void* a, const void* b) {
+    const unsigned* ia = a;
+    const unsigned* ib = b;
+    return desc_cmp(smgrs[*ia].desc, smgrs[*ib].desc);
+}
 
-    bool success = true;
-    bool matched = false;
+F_NONNULL
+static void admin_trie_destroy(admin_trie_t* node) {
+    for(unsigned i = 0; i < node->num_children; i++)
+        admin_trie_destroy(node->children[i]);
+    free(node->children);
+    free(node->label);
+    free(node);
+}
+
+// Finds the child with the given label of length len, or NULL
+F_NONNULL F_PURE
+static admin_trie_t* admin_trie_child(const admin_trie_t* node, const char* label, const unsigned len) {
+    unsigned lo = 0;
+    unsigned hi = node->num_children;
+    while(lo < hi) {
+        const unsigned mid = lo + ((hi - lo) >> 1);
+        const char* cl = node->children[mid]->label;
+        int cmp = strncmp(cl, label, len);
+        if(!cmp && cl[len])
+            cmp = 1;
+        if(!cmp)
+            return node->children[mid];
+        if(cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return NULL;
+}
+
+static void admin_index_build(void) {
+    if(admin_trie)
+        admin_trie_destroy(admin_trie);
+    free(admin_order);
+    free(admin_exact);
+
+    admin_index_count = num_smgrs;
+    admin_order = xmalloc((num_smgrs + 1) * sizeof(*admin_order));
+    for(unsigned i = 0; i < num_smgrs; i++)
+        admin_order[i] = i;
+    qsort(admin_order, num_smgrs, sizeof(*admin_order), admin_order_cmp);
 
+    admin_trie = xcalloc(1, sizeof(*admin_trie));
+    admin_trie->last = num_smgrs;
     for(unsigned i = 0; i < num_smgrs; i++) {
-        smgr_t* smgr = &smgrs[i];
-        int err = fnmatch(matchme, smgr->desc, 0);
+        const char* comp = smgrs[admin_order[i]].desc;
+        admin_trie_t* node = admin_trie;
+        while(1) {
+            const char* slash = strchr(comp, '/');
+            const unsigned len = slash ? (unsigned)(slash - comp) : (unsigned)strlen(comp);
+            // thanks to the sort order, a matching child is always the last one
+            admin_trie_t* child = node->num_children ? node->children[node->num_children - 1] : NULL;
+            if(!child || strncmp(child->label, comp, len) || child->label[len]) {
+                child = xcalloc(1, sizeof(*child));
+                child->label = strndup(comp, len);
+                child->first = i;
+                node->children = xrealloc(node->children, (node->num_children + 1) * sizeof(*node->children));
+                node->children[node->num_children++] = child;
+            }
+            child->last = i + 1;
+            node = child;
+            if(!slash)
+                break;
+            comp = slash + 1;
+        }
+    }
+
+    admin_exact_mask = count2mask(num_smgrs << 1);
+    admin_exact = xcalloc(admin_exact_mask + 1, sizeof(*admin_exact));
+    for(unsigned i = 0; i < num_smgrs; i++) {
+        unsigned slot = gdnsd_lookup2((const uint8_t*)smgrs[i].desc, strlen(smgrs[i].desc)) & admin_exact_mask;
+        while(admin_exact[slot])
+            slot = (slot + 1) & admin_exact_mask;
+        admin_exact[slot] = i + 1;
+    }
+}
+
+// Applies update_val to all smgrs matching matchme, returning
+//   false on glob error, and setting *matched if anything matched
+F_NONNULL
+static bool admin_match(const char* matchme, gdnsd_sttl_t* updates, gdnsd_sttl_t update_val, bool* matched) {
+    const char* glob_char = strpbrk(matchme, "*?[\\");
+
+    if(!glob_char) {
+        unsigned slot = gdnsd_lookup2((const uint8_t*)matchme, strlen(matchme)) & admin_exact_mask;
+        while(admin_exact[slot]) {
+            const unsigned i = admin_exact[slot] - 1;
+            if(!strcmp(matchme, smgrs[i].desc)) {
+                *matched = true;
+                updates[i] = update_val;
+            }
+            slot = (slot + 1) & admin_exact_mask;
+        }
+        return true;
+    }
+
+    // Descend through the complete literal components before glob_char
+    const admin_trie_t* node = admin_trie;
+    const char* comp = matchme;
+    const char* slash;
+    while((slash = strchr(comp, '/')) && slash < glob_char) {
+        node = admin_trie_child(node, comp, (unsigned)(slash - comp));
+        if(!node)
+            return true;
+        comp = slash + 1;
+    }
+
+    for(unsigned j = node->first; j < node->last; j++) {
+        const unsigned i = admin_order[j];
+        int err = fnmatch(matchme, smgrs[i].desc, 0);
         if(err && err != FNM_NOMATCH) {
             log_err("admin_state: fnmatch() failed with error code %i: probably glob-parsing error on '%s'", err, matchme);
-            success = false;
-            break;
+            return false;
         }
         if(!err) { // matched!
-            matched = true;
+            *matched = true;
             updates[i] = update_val;
         }
     }
 
+    return true;
+}
+
+F_NONNULL
+static bool admin_process_entry(const char* matchme, gdnsd_sttl_t* updates, gdnsd_sttl_t update_val) {
+    assert_valid_sttl(update_val);
+    dmn_assert(update_val & GDNSD_STTL_FORCED);
+
+    bool matched = false;
+    const bool success = admin_match(matchme, updates, update_val, &matched);
+
     if(success && !matched)
         log_warn("admin_state: glob '%s' did not match anything!", matchme);
 
@@ -230,6 +531,10 @@ static bool admin_process_hash(vscf_data_t* raw, const bool check_only) {
 
     bool success = true;
 
+    const ev_tstamp t_start = ev_time();
+    if(!admin_trie || admin_index_count != num_smgrs)
+        admin_index_build();
+
     gdnsd_sttl_t updates[num_smgrs];
     memset(updates, 0, sizeof(updates));
 
@@ -259,6 +564,9 @@ static bool admin_process_hash(vscf_data_t* raw, const bool check_only) {
         }
     }
 
+    log_info("admin_state: matched %u entries against %u resources in %.3f ms",
+        num_raw, num_smgrs, (ev_time() - t_start) * 1000.0);
+
     if(success && !check_only) {
         bool affected = false;
 
@@ -269,13 +577,13 @@ static bool admin_process_hash(vscf_data_t* raw, const bool check_only) {
                         log_info("admin_state: state of '%s' re-forced from %s to %s, real state is %s", smgrs[i].desc, logf_sttl(smgr_sttl[i]), logf_sttl(updates[i]), smgrs[i].type ? logf_sttl(smgrs[i].real_sttl) : "NA");
                     else
                         log_info("admin_state: state of '%s' forced to %s, real state is %s", smgrs[i].desc, logf_sttl(updates[i]), smgrs[i].type ? logf_sttl(smgrs[i].real_sttl) : "NA");
-                    smgr_sttl[i] = updates[i];
+                    sttl_set(i, updates[i]);
                     affected = true;
                 }
             }
             else if(smgr_sttl[i] & GDNSD_STTL_FORCED) { // was forced before, isn't now
                 log_info("admin_state: state of '%s' no longer forced (was forced to %s), real and current state is %s", smgrs[i].desc, logf_sttl(smgr_sttl[i]), smgrs[i].type ? logf_sttl(smgrs[i].real_sttl) : "NA");
-                smgr_sttl[i] = smgrs[i].real_sttl;
+                sttl_set(i, smgrs[i].real_sttl);
                 dmn_assert(!(smgr_sttl[i] & GDNSD_STTL_FORCED));
                 affected = true;
             }
@@ -328,7 +636,7 @@ static void admin_deleted_file(const char* pathname) {
     for(unsigned i = 0; i < num_smgrs; i++) {
         if(smgr_sttl[i] & GDNSD_STTL_FORCED) {
             log_info("admin_state: state of '%s' no longer forced (was forced to %s), real and current state is %s", smgrs[i].desc, logf_sttl(smgr_sttl[i]), smgrs[i].type ? logf_sttl(smgrs[i].real_sttl) : "NA");
-            smgr_sttl[i] = smgrs[i].real_sttl;
+            sttl_set(i, smgrs[i].real_sttl);
             dmn_assert(!(smgr_sttl[i] & GDNSD_STTL_FORCED));
             affected = true;
         }
@@ -404,7 +712,7 @@ void gdnsd_mon_check_admin_file(void) {
 //  to be the default loop currently, and should be empty of
 //  events at this point so that we can fall out after the
 //  initial round of monitoring.
-void gdnsd_mon_start(struct ev_loop* mloop) {
+void gdnsd_mon_start(struct ev_loop* mloop, const unsigned mon_threads) {
     // Fall out quickly if nothing to monitor
     if(!num_smgrs) return;
 
@@ -414,6 +722,12 @@ void gdnsd_mon_start(struct ev_loop* mloop) {
     // saved for timer usage later
     mon_loop = mloop;
 
+    // check history, which starts with the initial round
+    mon_hist = xmalloc(num_smgrs * MON_HIST_SIZE * sizeof(*mon_hist));
+    mon_hist_count = xcalloc(num_smgrs, sizeof(*mon_hist_count));
+    for(unsigned i = 0; i < MON_HIST_LOCKS; i++)
+        pthread_mutex_init(&mon_hist_locks[i], NULL);
+
     // Run the loop once until all events drain, which will
     // be one full monitoring cycle of each resource (without
     // any artificial delays).
@@ -438,11 +752,53 @@ void gdnsd_mon_start(struct ev_loop* mloop) {
     //   no confusion.
     sttl_table_update(mloop, sttl_update_timer, EV_TIMER);
 
-    // add real watchers to the monitor loop for runtime
-    //   (the loop itself begins execution later back in main.c)
+    // set up the runtime monitoring shards, whose threads
+    //   are started later via gdnsd_mon_start_threads()
+    dmn_assert(mon_threads);
+    num_shards = mon_threads;
+    shards = xcalloc(num_shards, sizeof(mon_shard_t));
+    shards[0].loop = mloop;
+    for(unsigned i = 1; i < num_shards; i++) {
+        shards[i].loop = ev_loop_new(EVFLAG_AUTO);
+        if(!shards[i].loop)
+            log_fatal("Could not initialize the libev loop for monitoring thread %u", i);
+        pthread_mutex_init(&shards[i].lock, NULL);
+    }
+    sttl_queue_async = xmalloc(sizeof(ev_async));
+    ev_async_init(sttl_queue_async, sttl_queue_cb);
+    ev_async_start(mloop, sttl_queue_async);
+
+    // add real watchers to the monitor loops for runtime
+    //   (the loops themselves begin execution later back in main.c)
     gdnsd_plugins_action_start_monitors(mloop);
 }
 
+F_NONNULL
+static void* mon_shard_runtime(void* shard_asvoid) {
+    mon_shard_t* shard = shard_asvoid;
+    this_shard = (unsigned)(shard - shards);
+
+    char name[16];
+    snprintf(name, sizeof(name), "gdnsd-mon%u", this_shard);
+    gdnsd_thread_setname(name);
+
+    ev_run(shard->loop, 0);
+    return NULL;
+}
+
+void gdnsd_mon_start_threads(void) {
+    for(unsigned i = 1; i < num_shards; i++) {
+        pthread_attr_t attribs;
+        pthread_attr_init(&attribs);
+        pthread_attr_setdetachstate(&attribs, PTHREAD_CREATE_DETACHED);
+        pthread_attr_setscope(&attribs, PTHREAD_SCOPE_SYSTEM);
+        const int pthread_err = pthread_create(&shards[i].threadid, &attribs, &mon_shard_runtime, &shards[i]);
+        if(pthread_err)
+            log_fatal("pthread_create() of monitoring thread %u failed: %s", i, dmn_logf_strerror(pthread_err));
+        pthread_attr_destroy(&attribs);
+    }
+}
+
 // We only have to check the address, because the port
 //  is determined by service type.
 F_NONNULL
@@ -543,9 +899,9 @@ static unsigned mon_thing(const char* svctype_name, const dmn_anysin_t* addr, co
     if(!strcmp(svctype_name, "down"))
         this_smgr->real_sttl |= GDNSD_STTL_DOWN;
 
-    smgr_sttl = xrealloc(smgr_sttl, sizeof(gdnsd_sttl_t) * num_smgrs);
-    smgr_sttl_consumer_ = xrealloc(smgr_sttl_consumer_, sizeof(gdnsd_sttl_t) * num_smgrs);
-    smgr_sttl_consumer_[idx] = smgr_sttl[idx] = this_smgr->real_sttl;
+    this_smgr->mon_sttl = this_smgr->real_sttl;
+
+    sttl_table_add(idx, this_smgr->real_sttl);
 
     return idx;
 }
@@ -565,13 +921,12 @@ unsigned gdnsd_mon_cname(const char* svctype_name, const char* cname, const uint
 unsigned gdnsd_mon_admin(const char* desc) {
     const unsigned idx = num_smgrs++;
     smgrs = xrealloc(smgrs, sizeof(smgr_t) * num_smgrs);
-    smgr_sttl = xrealloc(smgr_sttl, sizeof(gdnsd_sttl_t) * num_smgrs);
-    smgr_sttl_consumer_ = xrealloc(smgr_sttl_consumer_, sizeof(gdnsd_sttl_t) * num_smgrs);
     smgr_t* this_smgr = &smgrs[idx];
     memset(this_smgr, 0, sizeof(smgr_t));
     this_smgr->desc = strdup(desc);
     this_smgr->real_sttl = GDNSD_STTL_TTL_MAX;
-    smgr_sttl_consumer_[idx] = smgr_sttl[idx] = this_smgr->real_sttl;
+    this_smgr->mon_sttl = this_smgr->real_sttl;
+    sttl_table_add(idx, this_smgr->real_sttl);
     return idx;
 }
 
@@ -589,6 +944,29 @@ unsigned gdnsd_mon_admin(const char* desc) {
         } \
     } while(0)
 
+// Spreads the first regular checks of all plugin-monitored resources
+//   with the same interval evenly across that interval, regardless of
+//   service type or plugin, so that they don't all fire in one burst.
+static void mon_spread_start_delays(void) {
+    unsigned* ival_count = xcalloc(MAX_INTERVAL + 1U, sizeof(unsigned));
+    unsigned* ival_rank = xcalloc(MAX_INTERVAL + 1U, sizeof(unsigned));
+
+    for(unsigned i = 0; i < num_smgrs; i++)
+        if(smgrs[i].type && smgrs[i].type->plugin)
+            ival_count[smgrs[i].type->interval]++;
+
+    for(unsigned i = 0; i < num_smgrs; i++) {
+        smgr_t* smgr = &smgrs[i];
+        if(smgr->type && smgr->type->plugin) {
+            const unsigned ival = smgr->type->interval;
+            smgr->start_delay = (double)ival_rank[ival]++ / (double)ival_count[ival] * (double)ival;
+        }
+    }
+
+    free(ival_rank);
+    free(ival_count);
+}
+
 F_NONNULL
 static bool bad_svc_opt(const char* key, unsigned klen V_UNUSED, vscf_data_t* d V_UNUSED, const void* svcname_asvoid) {
     const char* svcname = svcname_asvoid;
@@ -668,11 +1046,21 @@ void gdnsd_mon_cfg_stypes_p2(vscf_data_t* svctypes_cfg) {
         SVC_OPT_UINT(svctype_cfg, this_svc->name, up_thresh, 1LU, 65535LU);
         SVC_OPT_UINT(svctype_cfg, this_svc->name, ok_thresh, 1LU, 65535LU);
         SVC_OPT_UINT(svctype_cfg, this_svc->name, down_thresh, 1LU, 65535LU);
-        SVC_OPT_UINT(svctype_cfg, this_svc->name, interval, 2LU, 3600LU);
+        SVC_OPT_UINT(svctype_cfg, this_svc->name, interval, 2LU, (unsigned long)MAX_INTERVAL);
         this_svc->timeout = this_svc->interval >> 1U; // default timeout is half of interval
         SVC_OPT_UINT(svctype_cfg, this_svc->name, timeout, 1LU, 300LU);
         if(this_svc->timeout >= this_svc->interval)
             log_fatal("Service type '%s': timeout must be less than interval)", this_svc->name);
+        this_svc->jitter = 0.0;
+        vscf_data_t* jitter_cfg = vscf_hash_get_data_byconstkey(svctype_cfg, "jitter", true);
+        if(jitter_cfg) {
+            if(!vscf_is_simple(jitter_cfg) || !vscf_simple_get_as_double(jitter_cfg, &this_svc->jitter)
+                || this_svc->jitter < 0.0)
+                log_fatal("Service type '%s': option 'jitter': Value must be a non-negative number of seconds", this_svc->name);
+            // so that a check never starts before the previous one timed out
+            if(this_svc->timeout + this_svc->jitter >= this_svc->interval)
+                log_fatal("Service type '%s': timeout + jitter must be less than interval", this_svc->name);
+        }
 
         this_svc->plugin->add_svctype(this_svc->name, svctype_cfg, this_svc->interval, this_svc->timeout);
         vscf_hash_iterate_const(svctype_cfg, true, bad_svc_opt, this_svc->name);
@@ -687,8 +1075,11 @@ void gdnsd_mon_cfg_stypes_p2(vscf_data_t* svctypes_cfg) {
         this_svc->down_thresh = DEF_DOWN_THRESH;
         this_svc->interval = DEF_INTERVAL;
         this_svc->timeout = 1;
+        this_svc->jitter = 0.0;
     }
 
+    mon_spread_start_delays();
+
     // now that we've solved the chicken-and-egg, finish processing
     //   the monitoring requests resolver plugins asked about earlier
     for(unsigned i = 0; i < num_smgrs; i++) {
@@ -719,7 +1110,8 @@ static void raw_sttl_update(smgr_t* smgr, unsigned idx, gdnsd_sttl_t new_sttl) {
 
     if(initial_round) {
         log_info("state of '%s' initialized to %s", smgr->desc, logf_sttl(new_sttl));
-        smgr_sttl[idx] = smgr->real_sttl = new_sttl;
+        smgr->real_sttl = new_sttl;
+        sttl_set(idx, new_sttl);
         // table update taken care of in gdnsd_mon_start()
         //  after all initial monitors complete
     }
@@ -736,21 +1128,124 @@ static void raw_sttl_update(smgr_t* smgr, unsigned idx, gdnsd_sttl_t new_sttl) {
         }
         smgr->real_sttl = new_sttl;
         if(new_sttl != smgr_sttl[idx] && !(smgr_sttl[idx] & GDNSD_STTL_FORCED)) {
-            smgr_sttl[idx] = new_sttl;
+            sttl_set(idx, new_sttl);
             kick_sttl_update_timer();
         }
     }
 }
 
+// Entry point for all monitoring updates, which are applied directly
+//   when called from mon_loop's own thread and queued otherwise.
+F_NONNULL
+static void mon_sttl_submit(smgr_t* smgr, unsigned idx, gdnsd_sttl_t new_sttl) {
+    smgr->mon_sttl = new_sttl;
+    if(!this_shard) {
+        raw_sttl_update(smgr, idx, new_sttl);
+        return;
+    }
+
+    mon_shard_t* shard = &shards[this_shard];
+    pthread_mutex_lock(&shard->lock);
+    if(shard->queue_len == shard->queue_alloc) {
+        shard->queue_alloc = shard->queue_alloc ? shard->queue_alloc << 1 : 64U;
+        shard->queue = xrealloc(shard->queue, shard->queue_alloc * sizeof(*shard->queue));
+    }
+    shard->queue[shard->queue_len].idx = idx;
+    shard->queue[shard->queue_len].sttl = new_sttl;
+    const bool was_empty = !shard->queue_len++;
+    pthread_mutex_unlock(&shard->lock);
+
+    if(was_empty)
+        ev_async_send(mon_loop, sttl_queue_async);
+}
+
+// Applies all queued updates from the other shards, in mon_loop
+F_NONNULL
+static void sttl_queue_cb(struct ev_loop* loop V_UNUSED, ev_async* w V_UNUSED, int revents V_UNUSED) {
+    dmn_assert(w == sttl_queue_async);
+    dmn_assert(revents == EV_ASYNC);
+
+    for(unsigned i = 1; i < num_shards; i++) {
+        mon_shard_t* shard = &shards[i];
+        pthread_mutex_lock(&shard->lock);
+        sttl_upd_t* updates = shard->queue;
+        const unsigned updates_len = shard->queue_len;
+        const unsigned updates_alloc = shard->queue_alloc;
+        shard->queue = shard->spare;
+        shard->queue_alloc = shard->spare_alloc;
+        shard->queue_len = 0;
+        pthread_mutex_unlock(&shard->lock);
+
+        // updates for any one smgr all come from the same shard, in order
+        for(unsigned j = 0; j < updates_len; j++)
+            raw_sttl_update(&smgrs[updates[j].idx], updates[j].idx, updates[j].sttl);
+
+        shard->spare = updates;
+        shard->spare_alloc = updates_alloc;
+    }
+}
+
+struct ev_loop* gdnsd_mon_get_loop(unsigned idx) {
+    dmn_assert(idx < num_smgrs);
+    dmn_assert(mon_loop);
+    return shards ? shards[idx % num_shards].loop : mon_loop;
+}
+
+double gdnsd_mon_get_start_delay(unsigned idx) {
+    dmn_assert(idx < num_smgrs);
+    return smgrs[idx].start_delay;
+}
+
+double gdnsd_mon_get_next_delay(unsigned idx) {
+    dmn_assert(idx < num_smgrs);
+    const service_type_t* type = smgrs[idx].type;
+    dmn_assert(type);
+    if(!(type->jitter > 0.0))
+        return 0.0;
+    if(!jitter_rstate)
+        jitter_rstate = gdnsd_rand32_init();
+    // uniform in [-jitter, +jitter)
+    const uint32_t rval = gdnsd_rand32_get(jitter_rstate);
+    const double r = rval / 4294967296.0;
+    return (double)type->interval + type->jitter * (r * 2.0 - 1.0);
+}
+
+// latency < 0 means unknown
+static void mon_hist_add(const unsigned idx, const bool ok, const double latency) {
+    dmn_assert(idx < num_smgrs);
+    dmn_assert(mon_hist);
+
+    uint32_t lat_us = MON_HIST_LAT_NONE;
+    if(latency >= 0.0)
+        lat_us = latency < (MON_HIST_LAT_NONE - 1U) / 1000000.0
+            ? (uint32_t)(latency * 1000000.0)
+            : MON_HIST_LAT_NONE - 1U;
+
+    pthread_mutex_t* lock = &mon_hist_locks[idx % MON_HIST_LOCKS];
+    pthread_mutex_lock(lock);
+    mon_hist_ent_t* ent = &mon_hist[idx * MON_HIST_SIZE + (mon_hist_count[idx]++ % MON_HIST_SIZE)];
+    ent->when = (uint32_t)time(NULL);
+    ent->lat_us = lat_us;
+    ent->ok = ok;
+    pthread_mutex_unlock(lock);
+}
+
 void gdnsd_mon_sttl_updater(unsigned idx, gdnsd_sttl_t new_sttl) {
     dmn_assert(idx < num_smgrs);
-    raw_sttl_update(&smgrs[idx], idx, new_sttl);
+    // not a check result, so this isn't recorded in the check history
+    mon_sttl_submit(&smgrs[idx], idx, new_sttl);
 }
 
 void gdnsd_mon_state_updater(unsigned idx, const bool latest) {
+    gdnsd_mon_state_updater_timed(idx, latest, -1.0);
+}
+
+void gdnsd_mon_state_updater_timed(unsigned idx, const bool latest, const double latency) {
     dmn_assert(idx < num_smgrs);
     smgr_t* smgr = &smgrs[idx];
 
+    mon_hist_add(idx, latest, latency);
+
     // a bit spammy to leave in all debug builds, but handy at times...
     //log_debug("'%s' new monitor result: %s", smgr->desc, latest ? "OK" : "FAIL");
 
@@ -769,7 +1264,7 @@ void gdnsd_mon_state_updater(unsigned idx, const bool latest) {
     }
     else {
         // First handle basic up/down state and the counters
-        down = smgr->real_sttl & GDNSD_STTL_DOWN;
+        down = smgr->mon_sttl & GDNSD_STTL_DOWN;
         if(down) { // Currently DOWN
             if(latest) { // New Success
                 if(++smgr->n_success == smgr->type->up_thresh) {
@@ -810,16 +1305,16 @@ void gdnsd_mon_state_updater(unsigned idx, const bool latest) {
     if(down)
         new_sttl |= GDNSD_STTL_DOWN;
 
-    raw_sttl_update(smgr, idx, new_sttl);
+    mon_sttl_submit(smgr, idx, new_sttl);
 }
 
 //--------------------------------------------------
 // stats code from here to the end
 //--------------------------------------------------
 
-static const char http_head[] = "<p><span class='bold big'>Monitored Service States:</span></p><table>\r\n"
+static const char http_head[] = "<p><span class='bold big'>Monitored Service States:</span>"
+    " (%" PRIuPTR " changes in %" PRIuPTR " table updates)</p><table>\r\n"
     "<tr><th>Service</th><th>State</th><th>Real State</th></tr>\r\n";
-static const unsigned http_head_len = sizeof(http_head) - 1;
 
 static const char http_tmpl[] = "<tr><td>%s</td><td class='%s'>%s</td><td class='%s'>%s</td></tr>\r\n";
 static const unsigned http_tmpl_len = sizeof(http_tmpl) - 11; // 5x%s
@@ -827,13 +1322,15 @@ static const unsigned http_tmpl_len = sizeof(http_tmpl) - 11; // 5x%s
 static const char http_foot[] = "</table>\r\n";
 static const unsigned http_foot_len = sizeof(http_foot) - 1;
 
-static const char csv_head[] = "Service,State,RealState\r\n";
-static const unsigned csv_head_len = sizeof(csv_head) - 1;
+static const char csv_head[] = "state_changes,state_updates\r\n"
+    "%" PRIuPTR ",%" PRIuPTR "\r\n"
+    "Service,State,RealState\r\n";
 
 static const char csv_tmpl[] = "%s,%s,%s\r\n";
 
-static const char json_head[] = "\t\"services\": [\r\n";
-static const unsigned json_head_len = sizeof(json_head) - 1;
+static const char json_head[] = "\t\"state_changes\": %" PRIuPTR ",\r\n"
+    "\t\"state_updates\": %" PRIuPTR ",\r\n"
+    "\t\"services\": [\r\n";
 static const char json_tmpl[] = "\t\t{\r\n\t\t\t\"service\": \"%s\",\r\n\t\t\t\"state\": \"%s\",\r\n\t\t\t\"real_state\": \"%s\"\r\n\t\t}";
 static const unsigned json_tmpl_len = sizeof(json_tmpl) - 7; // 3x%s
 static const char json_sep[] = ",\r\n";
@@ -853,12 +1350,16 @@ unsigned gdnsd_mon_stats_get_max_len(void) {
     //     and that 5 is the longest state_txt string "DOWN!"
     //   CSV is not included because it is very obviously shorter than
     //     either of these in all possible cases
+    //   The head templates' format specifiers are counted as output
+    //     characters here, which is close enough for an upper bound
+    //     when combined with the maximum digits of both counters.
+    const unsigned head_counters_len = 2 * 20;
 
-    const unsigned html_fixed_len = http_head_len + http_foot_len;
+    const unsigned html_fixed_len = (sizeof(http_head) - 1) + head_counters_len + http_foot_len;
     const unsigned html_var_len = http_tmpl_len + (5 * 4);
     const unsigned html_len = html_fixed_len + (num_smgrs * html_var_len);
 
-    const unsigned json_fixed_len = json_head_len + json_sep_len + json_foot_len;
+    const unsigned json_fixed_len = (sizeof(json_head) - 1) + head_counters_len + json_sep_len + json_foot_len;
     const unsigned json_var_len = json_tmpl_len + (5 * 2) + json_sep_len;
     const unsigned json_len = json_fixed_len + (num_smgrs * json_var_len);
 
@@ -920,32 +1421,164 @@ static const char* class_str_map[2][2][2] = {
     },
 };
 
+// The texts only depend on the FORCED and DOWN bits of the
+//   current and real sttls, which the callers read just once.
 F_NONNULL
-static void get_state_texts(const unsigned i, const char** cur_state_out, const char** real_state_out) {
+static void get_state_texts(const unsigned i, const gdnsd_sttl_t cur, const gdnsd_sttl_t real, const char** cur_state_out, const char** real_state_out) {
     dmn_assert(i < num_smgrs);
 
     *cur_state_out = state_str_map
         [!!smgrs[i].type]
-        [!!(smgr_sttl[i] & GDNSD_STTL_FORCED)]
-        [!!(smgr_sttl[i] & GDNSD_STTL_DOWN)];
+        [!!(cur & GDNSD_STTL_FORCED)]
+        [!!(cur & GDNSD_STTL_DOWN)];
     *real_state_out = state_str_map
         [!!smgrs[i].type]
-        [!!(smgrs[i].real_sttl & GDNSD_STTL_FORCED)]
-        [!!(smgrs[i].real_sttl & GDNSD_STTL_DOWN)];
+        [!!(real & GDNSD_STTL_FORCED)]
+        [!!(real & GDNSD_STTL_DOWN)];
 }
 
 F_NONNULL
-static void get_class_texts(const unsigned i, const char** cur_class_out, const char** real_class_out) {
+static void get_class_texts(const unsigned i, const gdnsd_sttl_t cur, const gdnsd_sttl_t real, const char** cur_class_out, const char** real_class_out) {
     dmn_assert(i < num_smgrs);
 
     *cur_class_out = class_str_map
         [!!smgrs[i].type]
-        [!!(smgr_sttl[i] & GDNSD_STTL_FORCED)]
-        [!!(smgr_sttl[i] & GDNSD_STTL_DOWN)];
+        [!!(cur & GDNSD_STTL_FORCED)]
+        [!!(cur & GDNSD_STTL_DOWN)];
     *real_class_out = class_str_map
         [!!smgrs[i].type]
-        [!!(smgrs[i].real_sttl & GDNSD_STTL_FORCED)]
-        [!!(smgrs[i].real_sttl & GDNSD_STTL_DOWN)];
+        [!!(real & GDNSD_STTL_FORCED)]
+        [!!(real & GDNSD_STTL_DOWN)];
+}
+
+// Row renderers for the stats cache below, which return the length
+//   of the row written to buf.  "avail" is always sufficient.
+typedef unsigned (*stats_row_render_t)(char* buf, const unsigned avail, const unsigned i, const gdnsd_sttl_t cur, const gdnsd_sttl_t real);
+
+F_NONNULL
+static unsigned stats_row_html(char* buf, const unsigned avail, const unsigned i, const gdnsd_sttl_t cur, const gdnsd_sttl_t real) {
+    const char* cur_st;
+    const char* real_st;
+    const char* cur_class;
+    const char* real_class;
+    get_state_texts(i, cur, real, &cur_st, &real_st);
+    get_class_texts(i, cur, real, &cur_class, &real_class);
+    const int snp_rv = snprintf(buf, avail, http_tmpl, smgrs[i].desc, cur_class, cur_st, real_class, real_st);
+    dmn_assert(snp_rv > 0);
+    if((unsigned)snp_rv >= avail)
+        log_fatal("BUG: monio stats buf miscalculated (html mon data)");
+    return (unsigned)snp_rv;
+}
+
+F_NONNULL
+static unsigned stats_row_csv(char* buf, const unsigned avail, const unsigned i, const gdnsd_sttl_t cur, const gdnsd_sttl_t real) {
+    const char* cur_st;
+    const char* real_st;
+    get_state_texts(i, cur, real, &cur_st, &real_st);
+    const int snp_rv = snprintf(buf, avail, csv_tmpl, smgrs[i].desc, cur_st, real_st);
+    dmn_assert(snp_rv > 0);
+    if((unsigned)snp_rv >= avail)
+        log_fatal("BUG: monio stats buf miscalculated (csv data)");
+    return (unsigned)snp_rv;
+}
+
+// JSON rows after the first carry their leading separator
+F_NONNULL
+static unsigned stats_row_json(char* buf, const unsigned avail, const unsigned i, const gdnsd_sttl_t cur, const gdnsd_sttl_t real) {
+    const char* cur_st;
+    const char* real_st;
+    get_state_texts(i, cur, real, &cur_st, &real_st);
+    unsigned sep_len = 0;
+    if(i) {
+        memcpy(buf, json_sep, json_sep_len);
+        sep_len = json_sep_len;
+    }
+    const int snp_rv = snprintf(buf + sep_len, avail - sep_len, json_tmpl, smgrs[i].desc, cur_st, real_st);
+    dmn_assert(snp_rv > 0);
+    if((unsigned)snp_rv >= avail - sep_len)
+        log_fatal("BUG: monio stats buf miscalculated (json mon data)");
+    return sep_len + (unsigned)snp_rv;
+}
+
+// Cache of the rendered rows of one stats output format.  Each row is
+//   only re-rendered when the states it shows differ from the ones it
+//   was last rendered with, and the concatenation of all rows is only
+//   rebuilt when some row was.  Scrapers polling large numbers of
+//   services thus mostly cost a single copy of the cached rows.
+// Only the statio thread renders stats, so this needs no locking.
+typedef struct {
+    stats_row_render_t render;
+    unsigned row_fixed_len; // max row length, excluding the desc
+    char* rows; // row i has space at rows[row_offs[i] ... row_offs[i + 1] - 1]
+    unsigned* row_offs;
+    unsigned* row_lens;
+    uint8_t* row_keys; // the state bits each row was rendered with
+    char* all; // concatenation of all rows
+    unsigned all_len;
+} stats_cache_t;
+
+// The max row lengths allow 5 chars for each state or class text,
+//   and the trailing NUL of snprintf()
+static stats_cache_t stats_cache_html = {
+    .render = stats_row_html,
+    .row_fixed_len = (sizeof(http_tmpl) - 11) + (5 * 4) + 1,
+};
+static stats_cache_t stats_cache_csv = {
+    .render = stats_row_csv,
+    .row_fixed_len = (sizeof(csv_tmpl) - 7) + (5 * 2) + 1,
+};
+static stats_cache_t stats_cache_json = {
+    .render = stats_row_json,
+    .row_fixed_len = (sizeof(json_sep) - 1) + (sizeof(json_tmpl) - 7) + (5 * 2) + 1,
+};
+
+// The FORCED and DOWN bits of both states
+#define STATS_ROW_KEY(_cur, _real) ((uint8_t)( \
+    (((_cur) & GDNSD_STTL_FORCED) ? 8U : 0U) | (((_cur) & GDNSD_STTL_DOWN) ? 4U : 0U) \
+  | (((_real) & GDNSD_STTL_FORCED) ? 2U : 0U) | (((_real) & GDNSD_STTL_DOWN) ? 1U : 0U)))
+
+// Brings the cache up to date, returning the length of c->all
+F_NONNULL
+static unsigned stats_cache_update(stats_cache_t* c) {
+    dmn_assert(num_smgrs);
+
+    if(!c->rows) {
+        c->row_offs = xmalloc((num_smgrs + 1) * sizeof(*c->row_offs));
+        unsigned total = 0;
+        for(unsigned i = 0; i < num_smgrs; i++) {
+            c->row_offs[i] = total;
+            total += c->row_fixed_len + strlen(smgrs[i].desc);
+        }
+        c->row_offs[num_smgrs] = total;
+        c->rows = xmalloc(total);
+        c->all = xmalloc(total);
+        c->row_lens = xmalloc(num_smgrs * sizeof(*c->row_lens));
+        c->row_keys = xmalloc(num_smgrs * sizeof(*c->row_keys));
+        memset(c->row_keys, 0xFF, num_smgrs * sizeof(*c->row_keys)); // never a valid key
+    }
+
+    bool changed = false;
+    for(unsigned i = 0; i < num_smgrs; i++) {
+        const gdnsd_sttl_t cur = smgr_sttl[i];
+        const gdnsd_sttl_t real = smgrs[i].real_sttl;
+        const uint8_t key = STATS_ROW_KEY(cur, real);
+        if(key != c->row_keys[i]) {
+            c->row_keys[i] = key;
+            c->row_lens[i] = c->render(&c->rows[c->row_offs[i]], c->row_offs[i + 1] - c->row_offs[i], i, cur, real);
+            changed = true;
+        }
+    }
+
+    if(changed) {
+        char* all = c->all;
+        for(unsigned i = 0; i < num_smgrs; i++) {
+            memcpy(all, &c->rows[c->row_offs[i]], c->row_lens[i]);
+            all += c->row_lens[i];
+        }
+        c->all_len = (unsigned)(all - c->all);
+    }
+
+    return c->all_len;
 }
 
 // Output our stats in html form to buf, returning
@@ -957,27 +1590,20 @@ unsigned gdnsd_mon_stats_out_html(char* buf) {
     const char* const buf_start = buf;
     unsigned avail = max_stats_len;
 
-    if(avail <= http_head_len)
+    const int head_rv = snprintf(buf, avail, http_head, stats_get(&sttl_changes), stats_get(&sttl_publications));
+    dmn_assert(head_rv > 0);
+    const unsigned head_written = (unsigned)head_rv;
+    if(head_written >= avail)
         log_fatal("BUG: monio stats buf miscalculated (html mon head)");
-    memcpy(buf, http_head, http_head_len);
-    buf += http_head_len;
-    avail -= http_head_len;
+    buf += head_written;
+    avail -= head_written;
 
-    for(unsigned i = 0; i < num_smgrs; i++) {
-        const char* cur_st;
-        const char* real_st;
-        const char* cur_class;
-        const char* real_class;
-        get_state_texts(i, &cur_st, &real_st);
-        get_class_texts(i, &cur_class, &real_class);
-        const int snp_rv = snprintf(buf, avail, http_tmpl, smgrs[i].desc, cur_class, cur_st, real_class, real_st);
-        dmn_assert(snp_rv > 0);
-        const unsigned written = (unsigned)snp_rv;
-        if(written >= avail)
-            log_fatal("BUG: monio stats buf miscalculated (html mon data)");
-        buf += written;
-        avail -= written;
-    }
+    const unsigned rows_len = stats_cache_update(&stats_cache_html);
+    if(rows_len >= avail)
+        log_fatal("BUG: monio stats buf miscalculated (html mon data)");
+    memcpy(buf, stats_cache_html.all, rows_len);
+    buf += rows_len;
+    avail -= rows_len;
 
     if(avail <= http_foot_len)
         log_fatal("BUG: monio stats buf miscalculated (html mon foot)");
@@ -997,24 +1623,19 @@ unsigned gdnsd_mon_stats_out_csv(char* buf) {
     const char* const buf_start = buf;
     unsigned avail = max_stats_len;
 
-    if(avail <= csv_head_len)
+    const int head_rv = snprintf(buf, avail, csv_head, stats_get(&sttl_changes), stats_get(&sttl_publications));
+    dmn_assert(head_rv > 0);
+    const unsigned head_written = (unsigned)head_rv;
+    if(head_written >= avail)
         log_fatal("BUG: monio stats buf miscalculated (csv mon head)");
-    memcpy(buf, csv_head, csv_head_len);
-    buf += csv_head_len;
-    avail -= csv_head_len;
+    buf += head_written;
+    avail -= head_written;
 
-    for(unsigned i = 0; i < num_smgrs; i++) {
-        const char* cur_st;
-        const char* real_st;
-        get_state_texts(i, &cur_st, &real_st);
-        const int snp_rv = snprintf(buf, avail, csv_tmpl, smgrs[i].desc, cur_st, real_st);
-        dmn_assert(snp_rv > 0);
-        const unsigned written = (unsigned)snp_rv;
-        if(written >= avail)
-            log_fatal("BUG: monio stats buf miscalculated (csv data)");
-        buf += written;
-        avail -= written;
-    }
+    const unsigned rows_len = stats_cache_update(&stats_cache_csv);
+    if(rows_len >= avail)
+        log_fatal("BUG: monio stats buf miscalculated (csv data)");
+    memcpy(buf, stats_cache_csv.all, rows_len);
+    buf += rows_len;
 
     return (buf - buf_start);
 }
@@ -1025,7 +1646,7 @@ unsigned gdnsd_mon_stats_out_json(char* buf) {
 
     const char* const buf_start = buf;
 
-    if(avail <= json_sep_len + json_head_len)
+    if(avail <= json_sep_len)
         log_fatal("BUG: monio stats buf miscalculated (json mon head)");
 
     if(num_smgrs == 0) {
@@ -1038,29 +1659,20 @@ unsigned gdnsd_mon_stats_out_json(char* buf) {
         avail -= json_sep_len;
     }
 
-    memcpy(buf, json_head, json_head_len);
-    buf += json_head_len;
-    avail -= json_head_len;
+    const int head_rv = snprintf(buf, avail, json_head, stats_get(&sttl_changes), stats_get(&sttl_publications));
+    dmn_assert(head_rv > 0);
+    const unsigned head_written = (unsigned)head_rv;
+    if(head_written >= avail)
+        log_fatal("BUG: monio stats buf miscalculated (json mon head)");
+    buf += head_written;
+    avail -= head_written;
 
-    for(unsigned i = 0; i < num_smgrs; i++) {
-        const char* cur_st;
-        const char* real_st;
-        get_state_texts(i, &cur_st, &real_st);
-        const int snp_rv = snprintf(buf, avail, json_tmpl, smgrs[i].desc, cur_st, real_st);
-        dmn_assert(snp_rv > 0);
-        const unsigned written = (unsigned)snp_rv;
-        if(written >= avail)
-            log_fatal("BUG: monio stats buf miscalculated (json mon data)");
-        buf += written;
-        avail -= written;
-        if( i < num_smgrs -1 ) {
-            if(avail <= json_sep_len)
-                log_fatal("BUG: monio stats buf miscalculated (json mon data-sep)");
-            memcpy(buf, json_sep, json_sep_len);
-            buf += json_sep_len;
-            avail -= json_sep_len;
-        }
-    }
+    const unsigned rows_len = stats_cache_update(&stats_cache_json);
+    if(rows_len >= avail)
+        log_fatal("BUG: monio stats buf miscalculated (json mon data)");
+    memcpy(buf, stats_cache_json.all, rows_len);
+    buf += rows_len;
+    avail -= rows_len;
 
     if(avail <= json_foot_len)
         log_fatal("BUG: monio stats buf miscalculated (json mon footer)");
@@ -1070,3 +1682,79 @@ unsigned gdnsd_mon_stats_out_json(char* buf) {
 
     return (buf - buf_start);
 }
+
+// Check history output, see mon_hist above.  The format is one
+//   compact line per monitored service, with each check given as
+//   [ unix_time, ok, latency_seconds ], oldest first, with a null
+//   latency if the plugin doesn't report it.
+
+static const char hist_head[] = "{\r\n\t\"history\": [";
+static const char hist_tmpl[] = "%s\r\n\t\t{\"service\": \"%s\", \"checks\": [";
+static const char hist_ent_tmpl[] = "%s[%" PRIu32 ", %s, %s]";
+static const char hist_foot[] = "\r\n\t]\r\n}\r\n";
+
+// statio calls this for the size of the buffer needed for
+//   gdnsd_mon_hist_out_json()
+unsigned gdnsd_mon_hist_get_max_len(void) {
+    if(!max_hist_len) {
+        // per entry: 10 digits of time, "false", and "4294.967295"
+        const unsigned ent_len = (sizeof(hist_ent_tmpl) - 1) + 10 + 5 + 11;
+        const unsigned svc_len = (sizeof(hist_tmpl) - 1) + 1 + (MON_HIST_SIZE * ent_len) + 2;
+        max_hist_len = (sizeof(hist_head) - 1) + (sizeof(hist_foot) - 1) + 1;
+        for(unsigned i = 0; i < num_smgrs; i++)
+            if(smgrs[i].type)
+                max_hist_len += svc_len + strlen(smgrs[i].desc);
+    }
+    return max_hist_len;
+}
+
+unsigned gdnsd_mon_hist_out_json(char* buf, const char* glob) {
+    char* const buf_start = buf;
+    unsigned avail = gdnsd_mon_hist_get_max_len();
+
+#define HIST_OUT(...) do { \
+        const int _snp_rv = snprintf(buf, avail, __VA_ARGS__); \
+        dmn_assert(_snp_rv >= 0); \
+        if((unsigned)_snp_rv >= avail) \
+            log_fatal("BUG: monio history buf miscalculated"); \
+        buf += _snp_rv; \
+        avail -= (unsigned)_snp_rv; \
+    } while(0)
+
+    HIST_OUT("%s", hist_head);
+
+    const char* sep = "";
+    for(unsigned i = 0; mon_hist && i < num_smgrs; i++) {
+        if(!smgrs[i].type)
+            continue;
+        if(glob && fnmatch(glob, smgrs[i].desc, 0))
+            continue;
+
+        // copy out under the lock, format without it
+        mon_hist_ent_t ents[MON_HIST_SIZE];
+        pthread_mutex_t* lock = &mon_hist_locks[i % MON_HIST_LOCKS];
+        pthread_mutex_lock(lock);
+        const unsigned count = mon_hist_count[i];
+        memcpy(ents, &mon_hist[i * MON_HIST_SIZE], sizeof(ents));
+        pthread_mutex_unlock(lock);
+
+        HIST_OUT(hist_tmpl, sep, smgrs[i].desc);
+        sep = ",";
+
+        const unsigned num_ents = count < MON_HIST_SIZE ? count : MON_HIST_SIZE;
+        for(unsigned j = 0; j < num_ents; j++) {
+            const mon_hist_ent_t* ent = &ents[(count - num_ents + j) % MON_HIST_SIZE];
+            char lat[16] = "null";
+            if(ent->lat_us != MON_HIST_LAT_NONE)
+                snprintf(lat, sizeof(lat), "%u.%06u", (unsigned)ent->lat_us / 1000000U, (unsigned)ent->lat_us % 1000000U);
+            HIST_OUT(hist_ent_tmpl, j ? ", " : "", ent->when, ent->ok ? "true" : "false", lat);
+        }
+        HIST_OUT("]}");
+    }
+
+    HIST_OUT("%s", hist_foot);
+
+#undef HIST_OUT
+
+    return (unsigned)(buf - buf_start);
+}
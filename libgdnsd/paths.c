@@ -19,8 +19,9 @@
 
 #include <config.h>
 #include <gdnsd/paths.h>
+#include <gdnsd-prot/paths.h>
+#include <gdnsd-prot/misc.h>
 
-#include "misc.h"
 #include "net.h"
 
 #include <gdnsd/vscf.h>
@@ -173,6 +174,19 @@ vscf_data_t* gdnsd_initialize(const char* config_dir, const bool check_create_di
     return cfg_root;
 }
 
+vscf_data_t* gdnsd_reinit_cfg_dir(const char* config_dir) {
+    dmn_assert(gdnsd_dirs[CFG]);
+
+    // like the originals, the old path string is simply never freed
+    gdnsd_dirs[CFG] = gdnsd_realdir(config_dir, "config", false, 0);
+
+    char* cfg_file = gdnsd_resolve_path_cfg("config", NULL);
+    vscf_data_t* cfg_root = conf_load_vscf(cfg_file);
+    free(cfg_file);
+
+    return cfg_root;
+}
+
 // ---------------------------
 // Runtime stuff
 
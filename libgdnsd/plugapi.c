@@ -30,6 +30,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <dlfcn.h>
+#include <pthread.h>
 
 // The default (minimum) values here amount to 240 bytes of address
 //   storage (12*4+12*16), which is less than the minimum allocation
@@ -116,9 +117,223 @@ void gdnsd_result_reset_scope_mask(dyn_result_t* result) {
     result->edns_scope_mask = 0;
 }
 
+unsigned gdnsd_result_get_scope_mask(const dyn_result_t* result) {
+    return result->edns_scope_mask;
+}
+
+typedef enum {
+    MEMO_EMPTY = 0,
+    MEMO_PENDING, // _get() missed with an empty result, _put() may store
+    MEMO_VALID,
+} memo_state_t;
+
+typedef struct {
+    uint8_t* storage; // allocated on first _put()
+    unsigned gen;
+    gdnsd_sttl_t sttl;
+    unsigned count_v4;
+    unsigned count_v6;
+    bool is_cname;
+    memo_state_t state;
+} memo_slot_t;
+
+struct gdnsd_result_memo {
+    memo_slot_t* slots;
+    unsigned num_slots;
+};
+
+gdnsd_result_memo_t* gdnsd_result_memo_new(const unsigned num_slots) {
+    gdnsd_result_memo_t* memo = xmalloc(sizeof(gdnsd_result_memo_t));
+    memo->slots = num_slots ? xcalloc(num_slots, sizeof(memo_slot_t)) : NULL;
+    memo->num_slots = num_slots;
+    return memo;
+}
+
+bool gdnsd_result_memo_get(gdnsd_result_memo_t* memo, const unsigned slot, const unsigned gen, dyn_result_t* result, gdnsd_sttl_t* sttl_out) {
+    dmn_assert(slot < memo->num_slots);
+    memo_slot_t* ms = &memo->slots[slot];
+
+    if(result->is_cname || result->count_v4 || result->count_v6)
+        return false;
+
+    if(ms->state == MEMO_VALID && ms->gen == gen) {
+        result->is_cname = ms->is_cname;
+        if(ms->is_cname) {
+            dname_copy(result->storage, ms->storage);
+        }
+        else {
+            result->count_v4 = ms->count_v4;
+            result->count_v6 = ms->count_v6;
+            memcpy(result->storage, ms->storage, ms->count_v4 * 4U);
+            memcpy(&result->storage[v6_offset], &ms->storage[v6_offset], ms->count_v6 * 16U);
+        }
+        *sttl_out = ms->sttl;
+        return true;
+    }
+
+    ms->state = MEMO_PENDING;
+    ms->gen = gen;
+    return false;
+}
+
+void gdnsd_result_memo_put(gdnsd_result_memo_t* memo, const unsigned slot, const dyn_result_t* result, const gdnsd_sttl_t sttl) {
+    dmn_assert(slot < memo->num_slots);
+    memo_slot_t* ms = &memo->slots[slot];
+
+    if(ms->state != MEMO_PENDING)
+        return;
+
+    if(!ms->storage)
+        ms->storage = xmalloc(gdnsd_result_get_alloc() - sizeof(dyn_result_t));
+
+    ms->is_cname = result->is_cname;
+    if(result->is_cname) {
+        dname_copy(ms->storage, result->storage);
+    }
+    else {
+        ms->count_v4 = result->count_v4;
+        ms->count_v6 = result->count_v6;
+        memcpy(ms->storage, result->storage, result->count_v4 * 4U);
+        memcpy(&ms->storage[v6_offset], &result->storage[v6_offset], result->count_v6 * 16U);
+    }
+    ms->sttl = sttl;
+    ms->state = MEMO_VALID;
+}
+
+typedef struct {
+    uint64_t query_id;
+    const void* data;
+    unsigned scope;
+} qcache_slot_t;
+
+struct gdnsd_query_cache {
+    qcache_slot_t* slots;
+    unsigned num_slots;
+};
+
+gdnsd_query_cache_t* gdnsd_query_cache_new(const unsigned num_slots) {
+    gdnsd_query_cache_t* qcache = xmalloc(sizeof(gdnsd_query_cache_t));
+    qcache->slots = num_slots ? xcalloc(num_slots, sizeof(qcache_slot_t)) : NULL;
+    qcache->num_slots = num_slots;
+    return qcache;
+}
+
+const void* gdnsd_query_cache_get(const gdnsd_query_cache_t* qcache, const client_info_t* cinfo, const unsigned slot, unsigned* scope_out) {
+    dmn_assert(slot < qcache->num_slots);
+    const qcache_slot_t* qs = &qcache->slots[slot];
+
+    if(cinfo->query_id && qs->query_id == cinfo->query_id) {
+        *scope_out = qs->scope;
+        return qs->data;
+    }
+
+    return NULL;
+}
+
+void gdnsd_query_cache_put(gdnsd_query_cache_t* qcache, const client_info_t* cinfo, const unsigned slot, const void* data, const unsigned scope) {
+    dmn_assert(slot < qcache->num_slots);
+    qcache_slot_t* qs = &qcache->slots[slot];
+
+    qs->query_id = cinfo->query_id;
+    qs->data = data;
+    qs->scope = scope;
+}
+
+// Scratch allocations are rounded up to this, which is enough
+//   alignment for any type a plugin would use
+#define SCRATCH_ALIGN 16U
+#define SCRATCH_ROUND(_x) (((_x) + (SCRATCH_ALIGN - 1U)) & ~((size_t)SCRATCH_ALIGN - 1U))
+
+typedef struct {
+    uint8_t* buf;
+    size_t size;
+    size_t used;
+    size_t overflow_size; // total of the overflow allocations below
+    void** overflow;      // allocations which didn't fit in buf
+    unsigned overflow_count;
+    unsigned overflow_alloc;
+} scratch_t;
+
+// the largest reservation so far, which new arenas are sized to.
+//   Reservations may come from concurrent iothread_init callbacks.
+static size_t scratch_reserved = 4096U;
+static pthread_mutex_t scratch_reserved_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread scratch_t* scratch = NULL;
+
+F_NONNULL
+static void scratch_resize(scratch_t* sc, const size_t size) {
+    dmn_assert(!sc->used);
+    free(sc->buf);
+    sc->buf = xmalloc(size);
+    sc->size = size;
+}
+
+F_RETNN
+static scratch_t* scratch_get(void) {
+    if(!scratch) {
+        pthread_mutex_lock(&scratch_reserved_lock);
+        const size_t reserved = scratch_reserved;
+        pthread_mutex_unlock(&scratch_reserved_lock);
+        scratch = xcalloc(1, sizeof(scratch_t));
+        scratch_resize(scratch, reserved);
+    }
+    return scratch;
+}
+
+void gdnsd_scratch_reserve(const size_t size) {
+    const size_t rsize = SCRATCH_ROUND(size);
+    pthread_mutex_lock(&scratch_reserved_lock);
+    if(rsize > scratch_reserved)
+        scratch_reserved = rsize;
+    const size_t reserved = scratch_reserved;
+    pthread_mutex_unlock(&scratch_reserved_lock);
+    // called from iothread_init, after the arena was created
+    if(scratch && scratch->size < reserved)
+        scratch_resize(scratch, reserved);
+}
+
+void* gdnsd_scratch_alloc(const size_t size) {
+    scratch_t* sc = scratch_get();
+    const size_t rsize = SCRATCH_ROUND(size ? size : 1U);
+
+    if(likely(rsize <= sc->size - sc->used)) {
+        void* rv = &sc->buf[sc->used];
+        sc->used += rsize;
+        return rv;
+    }
+
+    if(sc->overflow_count == sc->overflow_alloc) {
+        sc->overflow_alloc = sc->overflow_alloc ? sc->overflow_alloc << 1U : 4U;
+        sc->overflow = xrealloc(sc->overflow, sc->overflow_alloc * sizeof(void*));
+    }
+    void* rv = xmalloc(rsize);
+    sc->overflow[sc->overflow_count++] = rv;
+    sc->overflow_size += rsize;
+    return rv;
+}
+
+void gdnsd_scratch_reset(void) {
+    scratch_t* sc = scratch_get();
+    const size_t peak = sc->used + sc->overflow_size;
+    sc->used = 0;
+    if(unlikely(sc->overflow_count)) {
+        for(unsigned i = 0; i < sc->overflow_count; i++)
+            free(sc->overflow[i]);
+        sc->overflow_count = 0;
+        sc->overflow_size = 0;
+        scratch_resize(sc, peak);
+    }
+}
+
 static unsigned num_plugins = 0;
 static plugin_t** plugins = NULL;
 static const char** psearch = NULL;
+static const gdnsd_plugin_builtin_t* builtins = NULL;
+
+void gdnsd_plugins_set_builtins(const gdnsd_plugin_builtin_t* builtin_table) {
+    dmn_assert(!builtins); // only called once
+    builtins = builtin_table;
+}
 
 void gdnsd_plugins_set_search_path(vscf_data_t* psearch_array) {
     dmn_assert(!psearch); // only called once
@@ -200,9 +415,47 @@ static gen_func_ptr plugin_dlsym(void* handle, const char* pname, const char* sy
     return rval;
 }
 
+F_NONNULL F_PURE
+static const gdnsd_plugin_builtin_t* plugin_find_builtin(const char* pname) {
+    if(builtins)
+        for(const gdnsd_plugin_builtin_t* bi = builtins; bi->name; bi++)
+            if(!strcmp(pname, bi->name))
+                return bi;
+    return NULL;
+}
+
+F_NONNULL
+static plugin_t* plugin_load_builtin(const char* pname, const gdnsd_plugin_builtin_t* bi) {
+    dmn_assert(bi->get_api_version);
+    dmn_assert(bi->get_api_version() == GDNSD_PLUGIN_API_VERSION);
+
+    log_debug("Using built-in plugin '%s'", pname);
+    plugin_t* plug = plugin_allocate(pname);
+
+#   define PSETFUNC(x) plug->x = bi->x;
+    PSETFUNC(load_config)
+    PSETFUNC(map_res)
+    PSETFUNC(pre_run)
+    PSETFUNC(iothread_init)
+    PSETFUNC(resolve)
+    PSETFUNC(exit)
+    PSETFUNC(add_svctype)
+    PSETFUNC(add_mon_addr)
+    PSETFUNC(add_mon_cname)
+    PSETFUNC(init_monitors)
+    PSETFUNC(start_monitors)
+#   undef PSETFUNC
+
+    return plug;
+}
+
 static plugin_t* gdnsd_plugin_load(const char* pname) {
     dmn_assert(psearch);
 
+    const gdnsd_plugin_builtin_t* bi = plugin_find_builtin(pname);
+    if(bi)
+        return plugin_load_builtin(pname, bi);
+
     plugin_t* plug = plugin_allocate(pname);
     void* pptr = plugin_dlopen(pname);
     const gdnsd_apiv_cb_t apiv = (gdnsd_apiv_cb_t)plugin_dlsym(pptr, pname, "get_api_version");
@@ -281,6 +534,8 @@ void gdnsd_plugins_action_pre_run(void) {
 }
 
 void gdnsd_plugins_action_iothread_init(const unsigned threadnum) {
+    // so that reservations made by iothread_init apply to this arena
+    scratch_get();
     for(unsigned i = 0; i < num_plugins; i++)
         if(plugins[i]->iothread_init)
             plugins[i]->iothread_init(threadnum);
@@ -0,0 +1,613 @@
+/* Copyright © 2012 Brandon L Black <blblack@gmail.com>
+ *
+ * This file is part of gdnsd.
+ *
+ * gdnsd is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gdnsd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gdnsd.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#define GDNSD_PLUGIN_NAME chash
+#include <gdnsd/plugin.h>
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+
+// chash maps each client subnet to exactly one address per family via
+//   a Maglev lookup table (Eisenbud et al, NSDI 2016).  Every backend
+//   has a fixed pseudo-random permutation of the table slots derived
+//   from its label (or its address, for array-form configs), and the table is filled by letting the available
+//   backends take turns claiming their next preferred free slot.  The
+//   result is a near-equal split of the table between backends, and
+//   when the set of available backends changes, only a small fraction
+//   of slots beyond those of the backends that came or went are
+//   reassigned.
+
+static const char DEFAULT_SVCNAME[] = "up";
+static const double DEF_UP_THRESH = 0.5;
+static const unsigned DEF_TABLE_SIZE = 65537U;
+static const unsigned DEF_V4_PREFIX = 24U;
+static const unsigned DEF_V6_PREFIX = 56U;
+
+// Table entries are uint16_t backend indices, with this as the
+//   "unclaimed" marker during the build
+#define SLOT_FREE UINT16_MAX
+
+static bool have_v4 = false;
+static bool have_v6 = false;
+
+typedef struct {
+    dmn_anysin_t addr;
+    unsigned* indices;
+    unsigned offset; // first slot of this backend's permutation
+    unsigned skip;   // stride of this backend's permutation
+} backend_t;
+
+typedef struct {
+    backend_t* backends;
+    unsigned num_svcs;
+    unsigned count;
+    unsigned up_thresh;
+} addrset_t;
+
+typedef struct {
+    const char* name;
+    addrset_t* aset_v4;
+    addrset_t* aset_v6;
+    unsigned table_size;
+    unsigned v4_prefix;
+    unsigned v6_prefix;
+} res_t;
+
+static res_t* resources = NULL;
+static unsigned num_resources = 0;
+
+/*********************************/
+/* Local, static functions       */
+/*********************************/
+
+F_CONST
+static bool is_prime(const unsigned n) {
+    if(n < 2U)
+        return false;
+    for(unsigned d = 2U; d <= n / d; d++)
+        if(!(n % d))
+            return false;
+    return true;
+}
+
+F_NONNULL
+static bool bad_res_opt(const char* key, unsigned klen V_UNUSED, vscf_data_t* d V_UNUSED, const void* resname_asvoid) {
+    const char* resname = resname_asvoid;
+    log_fatal("plugin_chash: resource '%s': bad option '%s'", resname, key);
+}
+
+// given an array (or actually, even a single value), construct
+//  an addrs_vN hash inheriting params from the parent as usual.
+F_NONNULL
+static vscf_data_t* addrs_hash_from_array(vscf_data_t* ary, const char* resname, const char* stanza) {
+    dmn_assert(!vscf_is_hash(ary));
+
+    vscf_data_t* parent = vscf_get_parent(ary);
+    dmn_assert(vscf_is_hash(parent));
+
+    vscf_data_t* newhash = vscf_hash_new();
+    const unsigned alen = vscf_array_get_len(ary);
+    for(unsigned i = 0; i < alen; i++) {
+        vscf_data_t* this_addr_cfg = vscf_array_get_data(ary, i);
+        if(!vscf_is_simple(this_addr_cfg))
+            log_fatal("plugin_chash: resource '%s' (%s): if defined as an array, array values must all be address strings", resname, stanza);
+        const unsigned lnum = i + 1;
+        char lbuf[12];
+        snprintf(lbuf, 12, "%u", lnum);
+        vscf_hash_add_val(lbuf, strlen(lbuf), newhash, vscf_clone(this_addr_cfg, false));
+    }
+
+    vscf_hash_inherit(parent, newhash, "up_thresh", false);
+    vscf_hash_inherit(parent, newhash, "service_types", false);
+    return newhash;
+}
+
+// Reads an unsigned parameter in the range [min, max], if present
+F_NONNULL
+static void get_unsigned_param(vscf_data_t* cfg, const char* key, unsigned* out, const unsigned min, const unsigned max, const char* resname) {
+    vscf_data_t* d = vscf_hash_get_data_bystringkey(cfg, key, true);
+    if(d) {
+        unsigned long val;
+        if(!vscf_is_simple(d) || !vscf_simple_get_as_ulong(d, &val) || val < min || val > max)
+            log_fatal("plugin_chash: resource '%s': '%s' must be an integer in the range %u - %u", resname, key, min, max);
+        *out = (unsigned)val;
+    }
+}
+
+typedef struct {
+    const char* resname;
+    const char* stanza;
+    const char** svc_names;
+    addrset_t* aset;
+    unsigned table_size;
+    unsigned idx;
+    bool ipv6;
+    bool seed_addr; // seed permutations from the address, not the label
+} addrs_iter_data_t;
+
+F_NONNULL
+static bool addr_setup(const char* addr_desc, unsigned klen, vscf_data_t* addr_data, void* aid_asvoid) {
+    addrs_iter_data_t* aid = aid_asvoid;
+
+    const char* resname = aid->resname;
+    const char* stanza = aid->stanza;
+    const char** svc_names = aid->svc_names;
+    addrset_t* aset = aid->aset;
+    const unsigned idx = aid->idx++;
+    const bool ipv6 = aid->ipv6;
+    backend_t* be = &aset->backends[idx];
+
+    if(!vscf_is_simple(addr_data))
+        log_fatal("plugin_chash: resource %s (%s): address %s: all addresses must be string values", resname, stanza, addr_desc);
+    const char* addr_txt = vscf_simple_get_data(addr_data);
+
+    const int addr_err = gdnsd_anysin_getaddrinfo(addr_txt, NULL, &be->addr);
+    if(addr_err)
+        log_fatal("plugin_chash: resource %s (%s): failed to parse address '%s' for '%s': %s", resname, stanza, addr_txt, addr_desc, gai_strerror(addr_err));
+    if(ipv6 && be->addr.sa.sa_family != AF_INET6)
+        log_fatal("plugin_chash: resource %s (%s): address '%s' for '%s' is not IPv6", resname, stanza, addr_txt, addr_desc);
+    else if(!ipv6 && be->addr.sa.sa_family != AF_INET)
+        log_fatal("plugin_chash: resource %s (%s): address '%s' for '%s' is not IPv4", resname, stanza, addr_txt, addr_desc);
+
+    // The permutation is seeded from the backend's label rather than its
+    //   address, so that re-numbering a backend doesn't reshuffle clients.
+    //   Array-form labels are just positions, though, which would all
+    //   shift when an earlier entry is removed, so the address it is.
+    const uint32_t h1 = aid->seed_addr
+        ? gdnsd_lookup2((const uint8_t*)addr_txt, strlen(addr_txt))
+        : gdnsd_lookup2((const uint8_t*)addr_desc, klen);
+    const uint32_t h2 = gdnsd_lookup2((const uint8_t*)&h1, sizeof(h1));
+    be->offset = h1 % aid->table_size;
+    be->skip = (h2 % (aid->table_size - 1U)) + 1U;
+
+    if(aset->num_svcs) {
+        be->indices = xmalloc(sizeof(unsigned) * aset->num_svcs);
+        for(unsigned i = 0; i < aset->num_svcs; i++)
+            be->indices[i] = gdnsd_mon_addr(svc_names[i], &be->addr);
+    }
+
+    return true;
+}
+
+F_NONNULL
+static void config_addrs(const res_t* res, const char* stanza, addrset_t* aset, const bool ipv6, vscf_data_t* cfg, bool from_array) {
+    const char* resname = res->name;
+
+    bool destroy_cfg = false;
+    if(!vscf_is_hash(cfg)) {
+        cfg = addrs_hash_from_array(cfg, resname, stanza);
+        destroy_cfg = true;
+        from_array = true;
+    }
+
+    aset->num_svcs = 0;
+    const char** svc_names = NULL;
+    vscf_data_t* svctypes_data = vscf_hash_get_data_byconstkey(cfg, "service_types", true);
+    if(svctypes_data) {
+        aset->num_svcs = vscf_array_get_len(svctypes_data);
+        if(aset->num_svcs) {
+            svc_names = xmalloc(sizeof(char*) * aset->num_svcs);
+            for(unsigned i = 0; i < aset->num_svcs; i++) {
+                vscf_data_t* svctype_cfg = vscf_array_get_data(svctypes_data, i);
+                if(!vscf_is_simple(svctype_cfg))
+                    log_fatal("plugin_chash: resource %s (%s): 'service_types' values must be strings", resname, stanza);
+                svc_names[i] = vscf_simple_get_data(svctype_cfg);
+            }
+        }
+    }
+    else {
+        aset->num_svcs = 1;
+        svc_names = xmalloc(sizeof(char*));
+        svc_names[0] = DEFAULT_SVCNAME;
+    }
+
+    double up_thresh = DEF_UP_THRESH;
+    vscf_data_t* up_thresh_cfg = vscf_hash_get_data_byconstkey(cfg, "up_thresh", true);
+    if(up_thresh_cfg) {
+        if(!vscf_is_simple(up_thresh_cfg) || !vscf_simple_get_as_double(up_thresh_cfg, &up_thresh)
+           || up_thresh <= 0.0 || up_thresh > 1.0)
+            log_fatal("plugin_chash: resource %s (%s): 'up_thresh' must be a floating point value in the range (0.0 - 1.0]", resname, stanza);
+    }
+
+    // everything not marked by now (here, or as resource-level
+    //   parameters in the "direct" case) is an address
+    vscf_data_t* addrs_cfg = vscf_clone(cfg, true);
+    const unsigned num_addrs = vscf_hash_get_len(addrs_cfg);
+    if(!num_addrs)
+        log_fatal("plugin_chash: resource '%s' (%s): must define one or more 'desc => IP' mappings, either directly or inside a subhash named 'addrs_v4' or 'addrs_v6'", resname, stanza);
+    if(num_addrs > res->table_size || num_addrs >= SLOT_FREE)
+        log_fatal("plugin_chash: resource '%s' (%s): %u addresses is too many for a 'table_size' of %u", resname, stanza, num_addrs, res->table_size);
+
+    aset->count = num_addrs;
+    aset->backends = xcalloc(num_addrs, sizeof(backend_t));
+    aset->up_thresh = gdnsd_uscale_ceil(aset->count, up_thresh);
+
+    addrs_iter_data_t aid = {
+        .resname = resname,
+        .stanza = stanza,
+        .svc_names = svc_names,
+        .aset = aset,
+        .table_size = res->table_size,
+        .idx = 0,
+        .ipv6 = ipv6,
+        .seed_addr = from_array,
+    };
+    vscf_hash_iterate(addrs_cfg, true, addr_setup, &aid);
+
+    free(svc_names);
+    vscf_destroy(addrs_cfg);
+
+    if(destroy_cfg)
+        vscf_destroy(cfg);
+
+    if(ipv6)
+        have_v6 = true;
+    else
+        have_v4 = true;
+}
+
+F_NONNULL
+static void config_auto(res_t* res, const char* stanza, vscf_data_t* auto_cfg) {
+    bool destroy_cfg = false;
+    if(!vscf_is_hash(auto_cfg)) {
+        auto_cfg = addrs_hash_from_array(auto_cfg, res->name, stanza);
+        destroy_cfg = true;
+    }
+
+    // mark parameters
+    vscf_hash_get_data_byconstkey(auto_cfg, "up_thresh", true);
+    vscf_hash_get_data_byconstkey(auto_cfg, "service_types", true);
+
+    // clone down to just address-label keys
+    vscf_data_t* auto_cfg_noparams = vscf_clone(auto_cfg, true);
+
+    if(!vscf_hash_get_len(auto_cfg_noparams))
+        log_fatal("plugin_chash: resource '%s' (%s): no addresses defined!", res->name, stanza);
+
+    const char* first_name = vscf_hash_get_key_byindex(auto_cfg_noparams, 0, NULL);
+    vscf_data_t* first_cfg = vscf_hash_get_data_byindex(auto_cfg_noparams, 0);
+    if(!vscf_is_simple(first_cfg))
+        log_fatal("plugin_chash: resource '%s' (%s): The value of '%s' must be an IP address in string form", res->name, stanza, first_name);
+    const char* addr_txt = vscf_simple_get_data(first_cfg);
+    dmn_anysin_t temp_asin;
+    const int addr_err = gdnsd_anysin_getaddrinfo(addr_txt, NULL, &temp_asin);
+    if(addr_err)
+        log_fatal("plugin_chash: resource %s (%s): failed to parse address '%s' for '%s': %s", res->name, stanza, addr_txt, first_name, gai_strerror(addr_err));
+
+    if(temp_asin.sa.sa_family == AF_INET6) {
+        res->aset_v6 = xcalloc(1, sizeof(addrset_t));
+        config_addrs(res, stanza, res->aset_v6, true, auto_cfg, destroy_cfg);
+    }
+    else {
+        dmn_assert(temp_asin.sa.sa_family == AF_INET);
+        res->aset_v4 = xcalloc(1, sizeof(addrset_t));
+        config_addrs(res, stanza, res->aset_v4, false, auto_cfg, destroy_cfg);
+    }
+
+    vscf_destroy(auto_cfg_noparams);
+    if(destroy_cfg)
+        vscf_destroy(auto_cfg);
+}
+
+F_NONNULL
+static bool config_res(const char* resname, unsigned resname_len V_UNUSED, vscf_data_t* opts, void* data) {
+    unsigned* residx_ptr = data;
+    unsigned rnum = (*residx_ptr)++;
+    res_t* res = &resources[rnum];
+    res->name = strdup(resname);
+
+    // resource-level parameters live in the resource's own hash, or
+    //   at the top level of the plugin config for array resources
+    vscf_data_t* res_params = vscf_is_hash(opts) ? opts : vscf_get_parent(opts);
+    res->table_size = DEF_TABLE_SIZE;
+    res->v4_prefix = DEF_V4_PREFIX;
+    res->v6_prefix = DEF_V6_PREFIX;
+    get_unsigned_param(res_params, "table_size", &res->table_size, 3U, 1000003U, resname);
+    get_unsigned_param(res_params, "v4_prefix", &res->v4_prefix, 0U, 32U, resname);
+    get_unsigned_param(res_params, "v6_prefix", &res->v6_prefix, 0U, 128U, resname);
+    if(!is_prime(res->table_size))
+        log_fatal("plugin_chash: resource '%s': 'table_size' must be a prime number", resname);
+
+    vscf_data_t* addrs_v4_cfg = NULL;
+    vscf_data_t* addrs_v6_cfg = NULL;
+
+    if(vscf_is_hash(opts)) {
+        // inherit params downhill if applicable
+        vscf_hash_bequeath_all(opts, "up_thresh", true, false);
+        vscf_hash_bequeath_all(opts, "service_types", true, false);
+
+        addrs_v4_cfg = vscf_hash_get_data_byconstkey(opts, "addrs_v4", true);
+        addrs_v6_cfg = vscf_hash_get_data_byconstkey(opts, "addrs_v6", true);
+
+        if(addrs_v4_cfg) {
+            res->aset_v4 = xcalloc(1, sizeof(addrset_t));
+            config_addrs(res, "addrs_v4", res->aset_v4, false, addrs_v4_cfg, false);
+        }
+
+        if(addrs_v6_cfg) {
+            res->aset_v6 = xcalloc(1, sizeof(addrset_t));
+            config_addrs(res, "addrs_v6", res->aset_v6, true, addrs_v6_cfg, false);
+        }
+    }
+
+    if(!addrs_v4_cfg && !addrs_v6_cfg)
+        config_auto(res, "direct", opts);
+    else if(vscf_is_hash(opts))
+        vscf_hash_iterate_const(opts, true, bad_res_opt, resname);
+    else
+        log_fatal("plugin_chash: resource '%s': an empty array is not a valid resource config", resname);
+
+    return true;
+}
+
+/*********************************/
+/* Per-thread lookup tables      */
+/*********************************/
+
+// Per-thread Maglev table for one addrset.  Whenever the sttl table
+//   generation changes (see dyn_res_get()), the set's own candidates
+//   are re-evaluated, but the table is only refilled if they changed,
+//   as the generation moves on with any state change anywhere.
+typedef struct {
+    uint16_t* table; // table_size backend indices
+    unsigned* cand;  // candidate backend indices the table was filled from
+    unsigned* next;  // build scratch: re-evaluated candidates
+    unsigned* pos;   // build scratch: next permutation slot per candidate
+    unsigned ncand;  // 0 until first filled
+    gdnsd_sttl_t rv;
+} dyn_aset_t;
+
+typedef struct {
+    dyn_aset_t* v4;
+    dyn_aset_t* v6;
+    unsigned gen;
+} dyn_res_t;
+
+// indexed by resource number, each allocated on first use by a thread
+static __thread dyn_res_t** dyn_res = NULL;
+
+F_NONNULL F_MALLOC
+static dyn_aset_t* dyn_aset_new(const addrset_t* aset, const unsigned table_size) {
+    dyn_aset_t* daset = xmalloc(sizeof(dyn_aset_t));
+    daset->table = xmalloc(table_size * sizeof(uint16_t));
+    daset->cand = xmalloc(aset->count * sizeof(unsigned));
+    daset->next = xmalloc(aset->count * sizeof(unsigned));
+    daset->pos = xmalloc(aset->count * sizeof(unsigned));
+    daset->ncand = 0;
+    daset->rv = GDNSD_STTL_TTL_MAX;
+    return daset;
+}
+
+// The candidates take turns claiming the next unclaimed slot in their
+//   own permutation until the table is full.  Because table_size is
+//   prime and skip is non-zero, each permutation visits every slot.
+F_NONNULL
+static void maglev_fill(const addrset_t* aset, dyn_aset_t* daset, const unsigned table_size) {
+    const unsigned ncand = daset->ncand;
+    dmn_assert(ncand);
+
+    uint16_t* table = daset->table;
+    for(unsigned i = 0; i < table_size; i++)
+        table[i] = SLOT_FREE;
+    for(unsigned k = 0; k < ncand; k++)
+        daset->pos[k] = aset->backends[daset->cand[k]].offset;
+
+    unsigned filled = 0;
+    while(1) {
+        for(unsigned k = 0; k < ncand; k++) {
+            const unsigned skip = aset->backends[daset->cand[k]].skip;
+            unsigned slot = daset->pos[k];
+            while(table[slot] != SLOT_FREE) {
+                slot += skip;
+                if(slot >= table_size)
+                    slot -= table_size;
+            }
+            table[slot] = (uint16_t)daset->cand[k];
+            slot += skip;
+            if(slot >= table_size)
+                slot -= table_size;
+            daset->pos[k] = slot;
+            if(++filled == table_size)
+                return;
+        }
+    }
+}
+
+F_NONNULL
+static void dyn_aset_build(const gdnsd_sttl_tbl_t* sttl_tbl, const addrset_t* aset, dyn_aset_t* daset, const unsigned table_size) {
+    gdnsd_sttl_t rv = GDNSD_STTL_TTL_MAX;
+    unsigned* next = daset->next;
+    unsigned ncand = 0;
+    for(unsigned i = 0; i < aset->count; i++) {
+        const backend_t* be = &aset->backends[i];
+        const gdnsd_sttl_t be_sttl = gdnsd_sttl_min(sttl_tbl, be->indices, aset->num_svcs);
+        rv = gdnsd_sttl_min2(rv, be_sttl);
+        if(!(be_sttl & GDNSD_STTL_DOWN))
+            next[ncand++] = i;
+    }
+
+    // if up_thresh was not met, signal upstream failure through rv and
+    //   hash over all backends
+    if(ncand < aset->up_thresh) {
+        rv |= GDNSD_STTL_DOWN;
+        for(unsigned i = 0; i < aset->count; i++)
+            next[i] = i;
+        ncand = aset->count;
+    }
+    // else force non-down response in retval, even if "rv" currently has the down flag from
+    //   the min/min2 operations on the individual addrs
+    else {
+        rv &= ~GDNSD_STTL_DOWN;
+    }
+
+    // both lists are in backend order, so equal sets compare equal
+    if(ncand != daset->ncand || memcmp(next, daset->cand, ncand * sizeof(unsigned))) {
+        daset->next = daset->cand;
+        daset->cand = next;
+        daset->ncand = ncand;
+        maglev_fill(aset, daset, table_size);
+    }
+
+    assert_valid_sttl(rv);
+    daset->rv = rv;
+}
+
+// Fetches this thread's tables for a resource, (re-)building them
+//   if they're missing or out of date with respect to the sttl table
+static const dyn_res_t* dyn_res_get(const gdnsd_sttl_tbl_t* sttl_tbl, const unsigned resnum) {
+    dmn_assert(dyn_res); // iothread_init
+    const res_t* res = &resources[resnum];
+    const unsigned gen = gdnsd_sttl_tbl_gen(sttl_tbl);
+
+    dyn_res_t* dres = dyn_res[resnum];
+    if(!dres) {
+        dres = xcalloc(1, sizeof(dyn_res_t));
+        if(res->aset_v4)
+            dres->v4 = dyn_aset_new(res->aset_v4, res->table_size);
+        if(res->aset_v6)
+            dres->v6 = dyn_aset_new(res->aset_v6, res->table_size);
+        dyn_res[resnum] = dres;
+    }
+    else if(dres->gen == gen) {
+        return dres;
+    }
+
+    if(dres->v4)
+        dyn_aset_build(sttl_tbl, res->aset_v4, dres->v4, res->table_size);
+    if(dres->v6)
+        dyn_aset_build(sttl_tbl, res->aset_v6, dres->v6, res->table_size);
+    dres->gen = gen;
+    return dres;
+}
+
+// Hashes the first "bits" bits of the client address
+F_NONNULL F_PURE
+static uint32_t client_hash(const dmn_anysin_t* client, const unsigned bits) {
+    const uint8_t* src;
+    unsigned len;
+    if(client->sa.sa_family == AF_INET6) {
+        src = client->sin6.sin6_addr.s6_addr;
+        len = 16U;
+    }
+    else {
+        dmn_assert(client->sa.sa_family == AF_INET);
+        src = (const uint8_t*)&client->sin.sin_addr.s_addr;
+        len = 4U;
+    }
+    dmn_assert(bits <= len * 8U);
+
+    uint8_t key[16];
+    memset(key, 0, sizeof(key));
+    const unsigned whole = bits >> 3;
+    memcpy(key, src, whole);
+    if(bits & 7U)
+        key[whole] = src[whole] & (uint8_t)(0xFFU << (8U - (bits & 7U)));
+
+    return gdnsd_lookup2(key, len);
+}
+
+/*********************************/
+/* Exported callbacks start here */
+/*********************************/
+
+void plugin_chash_load_config(vscf_data_t* config, const unsigned num_threads V_UNUSED) {
+    if(!config)
+        log_fatal("chash plugin requires a 'plugins' configuration stanza");
+
+    dmn_assert(vscf_is_hash(config));
+
+    num_resources = vscf_hash_get_len(config);
+
+    // inherit params downhill
+    if(vscf_hash_bequeath_all(config, "up_thresh", true, false))
+        num_resources--;
+    if(vscf_hash_bequeath_all(config, "service_types", true, false))
+        num_resources--;
+    if(vscf_hash_bequeath_all(config, "table_size", true, false))
+        num_resources--;
+    if(vscf_hash_bequeath_all(config, "v4_prefix", true, false))
+        num_resources--;
+    if(vscf_hash_bequeath_all(config, "v6_prefix", true, false))
+        num_resources--;
+
+    resources = xcalloc(num_resources, sizeof(res_t));
+    unsigned residx = 0;
+    vscf_hash_iterate(config, true, config_res, &residx);
+    gdnsd_dyn_addr_max(have_v4 ? 1U : 0U, have_v6 ? 1U : 0U);
+}
+
+int plugin_chash_map_res(const char* resname, const uint8_t* origin V_UNUSED) {
+    if(resname) {
+        for(unsigned i = 0; i < num_resources; i++)
+            if(!strcmp(resname, resources[i].name))
+                return (int)i;
+        log_err("plugin_chash: Unknown resource '%s'", resname);
+    }
+    else {
+        log_err("plugin_chash: resource name required");
+    }
+
+    return -1;
+}
+
+void plugin_chash_iothread_init(const unsigned threadnum V_UNUSED) {
+    dyn_res = xcalloc(num_resources, sizeof(dyn_res_t*));
+}
+
+gdnsd_sttl_t plugin_chash_resolve(unsigned resnum, const uint8_t* origin V_UNUSED, const client_info_t* cinfo, dyn_result_t* result) {
+    const res_t* res = &resources[resnum];
+    const gdnsd_sttl_tbl_t* sttl_tbl = gdnsd_mon_get_sttl_table();
+    const dyn_res_t* dres = dyn_res_get(sttl_tbl, resnum);
+
+    // Key on the edns-client-subnet if we have one, else the cache's own
+    //   address, truncated to the configured prefix.  With ECS the answer
+    //   is valid for the whole prefix, which becomes the scope.
+    const bool ecs = !!cinfo->edns_client_mask;
+    const dmn_anysin_t* client = ecs ? &cinfo->edns_client : &cinfo->dns_source;
+    const unsigned prefix = client->sa.sa_family == AF_INET6
+        ? res->v6_prefix
+        : res->v4_prefix;
+    const unsigned bits = (ecs && cinfo->edns_client_mask < prefix)
+        ? cinfo->edns_client_mask
+        : prefix;
+    const unsigned slot = client_hash(client, bits) % res->table_size;
+
+    gdnsd_sttl_t rv = GDNSD_STTL_TTL_MAX;
+    if(dres->v4) {
+        gdnsd_result_add_anysin(result, &res->aset_v4->backends[dres->v4->table[slot]].addr);
+        rv = dres->v4->rv;
+    }
+    if(dres->v6) {
+        gdnsd_result_add_anysin(result, &res->aset_v6->backends[dres->v6->table[slot]].addr);
+        rv = gdnsd_sttl_min2(rv, dres->v6->rv);
+    }
+
+    if(ecs)
+        gdnsd_result_add_scope_mask(result, prefix);
+
+    assert_valid_sttl(rv);
+    return rv;
+}
@@ -0,0 +1,726 @@
+/* Copyright © 2012 Brandon L Black <blblack@gmail.com>
+ *
+ * This file is part of gdnsd.
+ *
+ * gdnsd is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gdnsd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gdnsd.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Structurally this follows tcp_connect.c, but the regular queries
+//   for all monitors of an address family share a single UDP socket,
+//   and responses are matched up with monitors by their query ID.
+// A truncated UDP response optionally causes a retry over TCP,
+//   which uses a private socket for that monitor for that one check.
+
+#include <config.h>
+
+#define GDNSD_PLUGIN_NAME dns_query
+#include <gdnsd/plugin.h>
+
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <netinet/in_systm.h>
+#include <netinet/ip.h>
+#include <netinet/tcp.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <fcntl.h>
+
+// The core's dnswire.h isn't available to plugins, and we
+//   only need a few bits of the message format here anyways
+#define DNS_HDR_LEN 12U
+#define DNS_MAX_QUERY (DNS_HDR_LEN + 255U + 4U)
+#define DNS_FLAG1_QR 0x80U
+#define DNS_FLAG1_TC 0x02U
+#define DNS_FLAG1_RD 0x01U
+#define DNS_FLAG2_RCODE 0x0FU
+#define DNS_CLASS_IN 1U
+#define NUM_QIDS 65536U
+
+typedef struct {
+    const char* name;
+    unsigned num;
+} dns_const_t;
+
+static const dns_const_t qtypes[] = {
+    { "A",      1U },
+    { "NS",     2U },
+    { "CNAME",  5U },
+    { "SOA",    6U },
+    { "PTR",   12U },
+    { "MX",    15U },
+    { "TXT",   16U },
+    { "AAAA",  28U },
+    { "SRV",   33U },
+    { "NAPTR", 35U },
+    { "ANY",  255U },
+    { "CAA",  257U },
+};
+
+static const dns_const_t rcodes[] = {
+    { "NOERROR",  0U },
+    { "FORMERR",  1U },
+    { "SERVFAIL", 2U },
+    { "NXDOMAIN", 3U },
+    { "NOTIMP",   4U },
+    { "REFUSED",  5U },
+};
+
+typedef struct {
+    const char* name;
+    uint8_t* query; // full query message, with a zero ID
+    unsigned query_len;
+    unsigned rcode;
+    unsigned port;
+    unsigned timeout;
+    unsigned interval;
+    bool tcp_fallback;
+} dnsq_svc_t;
+
+typedef enum {
+    DNSQ_STATE_WAITING = 0,
+    DNSQ_STATE_UDP,
+    DNSQ_STATE_TCP_WRITING,
+    DNSQ_STATE_TCP_READING
+} dnsq_state_t;
+
+typedef struct {
+    const char* desc;
+    dnsq_svc_t* dnsq_svc;
+    ev_io* tcp_watcher;
+    ev_timer* timeout_watcher;
+    ev_timer* interval_watcher;
+    dmn_anysin_t addr;
+    unsigned idx;
+    dnsq_state_t dnsq_state;
+    unsigned qid;
+    int sock; // TCP fallback only
+    unsigned tcp_done; // bytes written or read so far
+    ev_tstamp check_start; // for the check latency
+    bool seen_once; // has a result from the initial round
+    uint8_t tcp_buf[DNS_MAX_QUERY + 2U];
+} dnsq_events_t;
+
+typedef enum {
+    RESP_INVALID = 0, // not a response to our query at all
+    RESP_TRUNC,       // truncated, should retry over TCP
+    RESP_RCODE_OK,
+    RESP_RCODE_FAIL,
+} dnsq_resp_t;
+
+static unsigned num_dnsq_svcs = 0;
+static unsigned num_mons = 0;
+static dnsq_svc_t* service_types = NULL;
+static dnsq_events_t** mons = NULL;
+
+// the shared UDP sockets, by address family
+static int udp_sock_v4 = -1;
+static int udp_sock_v6 = -1;
+static ev_io* udp_watcher_v4 = NULL;
+static ev_io* udp_watcher_v6 = NULL;
+
+// The UDP read watchers would keep the initial round's loop running
+//   forever, so they're stopped once every monitor has its first
+//   result, and restarted by plugin_dns_query_start_monitors().
+static bool init_phase = true;
+static unsigned init_phase_count = 0;
+
+// in-flight checks, indexed by query ID
+static dnsq_events_t** pending = NULL;
+static unsigned num_pending = 0;
+static gdnsd_rstate32_t* rstate = NULL;
+
+F_NONNULL
+static bool qid_alloc(dnsq_events_t* md) {
+    if(num_pending == NUM_QIDS)
+        return false;
+    const uint32_t rval = gdnsd_rand32_get(rstate);
+    unsigned qid = rval & (NUM_QIDS - 1U);
+    while(pending[qid])
+        qid = (qid + 1U) & (NUM_QIDS - 1U);
+    pending[qid] = md;
+    md->qid = qid;
+    num_pending++;
+    return true;
+}
+
+F_NONNULL
+static void qid_free(dnsq_events_t* md) {
+    dmn_assert(pending[md->qid] == md);
+    pending[md->qid] = NULL;
+    num_pending--;
+}
+
+F_NONNULL
+static void udp_watchers_stop(struct ev_loop* loop) {
+    if(udp_watcher_v4)
+        ev_io_stop(loop, udp_watcher_v4);
+    if(udp_watcher_v6)
+        ev_io_stop(loop, udp_watcher_v6);
+}
+
+F_NONNULL
+static void mon_result(struct ev_loop* loop, dnsq_events_t* md, const bool success) {
+    gdnsd_mon_state_updater_timed(md->idx, success, ev_now(loop) - md->check_start);
+    if(init_phase && !md->seen_once) {
+        md->seen_once = true;
+        if(++init_phase_count == num_mons)
+            udp_watchers_stop(loop);
+    }
+}
+
+// errno values from non-blocking socket calls which just mean "later"
+F_CONST
+static bool errno_is_retry(const int err) {
+    switch(err) {
+        case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+        case EWOULDBLOCK:
+#endif
+        case EINTR:
+            return true;
+        default:
+            return false;
+    }
+}
+
+F_NONNULL F_PURE
+static bool addr_matches(const dmn_anysin_t* a, const dmn_anysin_t* b) {
+    if(a->sa.sa_family != b->sa.sa_family)
+        return false;
+    if(a->sa.sa_family == AF_INET)
+        return a->sin.sin_port == b->sin.sin_port
+            && a->sin.sin_addr.s_addr == b->sin.sin_addr.s_addr;
+    return a->sin6.sin6_port == b->sin6.sin6_port
+        && !memcmp(&a->sin6.sin6_addr, &b->sin6.sin6_addr, sizeof(struct in6_addr));
+}
+
+// Check a response (UDP, or TCP without the length prefix) against
+//   our query.  Servers are free to omit the question section in
+//   error responses, but if there is one it must match ours.
+F_NONNULL
+static dnsq_resp_t check_response(const dnsq_events_t* md, const uint8_t* pkt, const unsigned len, const bool allow_trunc) {
+    const dnsq_svc_t* svc = md->dnsq_svc;
+
+    if(len < DNS_HDR_LEN)
+        return RESP_INVALID;
+    if((((unsigned)pkt[0] << 8) | pkt[1]) != md->qid)
+        return RESP_INVALID;
+    if(!(pkt[2] & DNS_FLAG1_QR))
+        return RESP_INVALID;
+
+    const unsigned qdcount = ((unsigned)pkt[4] << 8) | pkt[5];
+    if(qdcount) {
+        if(qdcount != 1U || len < svc->query_len)
+            return RESP_INVALID;
+        // qname case-insensitively, then qtype + qclass exactly
+        const unsigned qname_end = svc->query_len - 4U;
+        for(unsigned i = DNS_HDR_LEN; i < qname_end; i++) {
+            uint8_t c = pkt[i];
+            if(c >= 'A' && c <= 'Z')
+                c |= 0x20;
+            if(c != svc->query[i])
+                return RESP_INVALID;
+        }
+        if(memcmp(&pkt[qname_end], &svc->query[qname_end], 4U))
+            return RESP_INVALID;
+    }
+
+    if(allow_trunc && (pkt[2] & DNS_FLAG1_TC))
+        return RESP_TRUNC;
+
+    const unsigned rcode = pkt[3] & DNS_FLAG2_RCODE;
+    if(rcode != svc->rcode) {
+        log_debug("plugin_dns_query: State poll of %s got rcode %u, wanted %u", md->desc, rcode, svc->rcode);
+        return RESP_RCODE_FAIL;
+    }
+    return RESP_RCODE_OK;
+}
+
+F_NONNULL
+static void mon_finish(struct ev_loop* loop, dnsq_events_t* md, const bool success) {
+    dmn_assert(md->dnsq_state != DNSQ_STATE_WAITING);
+
+    if(md->sock != -1) {
+        ev_io_stop(loop, md->tcp_watcher);
+        shutdown(md->sock, SHUT_RDWR);
+        close(md->sock);
+        md->sock = -1;
+    }
+    ev_timer_stop(loop, md->timeout_watcher);
+    qid_free(md);
+    md->dnsq_state = DNSQ_STATE_WAITING;
+
+    log_debug("plugin_dns_query: State poll of %s %s", md->desc, success ? "succeeded" : "failed");
+    mon_result(loop, md, success);
+}
+
+F_NONNULL
+static bool tcp_start(struct ev_loop* loop, dnsq_events_t* md) {
+    dmn_assert(md->sock == -1);
+
+    const bool isv6 = md->addr.sa.sa_family == AF_INET6;
+
+    const int sock = socket(isv6 ? PF_INET6 : PF_INET, SOCK_STREAM, gdnsd_getproto_tcp());
+    if(sock == -1) {
+        log_err("plugin_dns_query: Failed to create TCP monitoring socket: %s", dmn_logf_errno());
+        return false;
+    }
+
+    if(fcntl(sock, F_SETFL, (fcntl(sock, F_GETFL, 0)) | O_NONBLOCK) == -1) {
+        log_err("plugin_dns_query: Failed to set O_NONBLOCK on TCP monitoring socket: %s", dmn_logf_errno());
+        close(sock);
+        return false;
+    }
+
+    if(connect(sock, &md->addr.sa, md->addr.len) == -1 && errno != EINPROGRESS) {
+        log_debug("plugin_dns_query: TCP connect() for %s failed quickly: %s", md->desc, dmn_logf_errno());
+        close(sock);
+        return false;
+    }
+
+    // the query, with a length prefix, is sent once we're writable
+    const unsigned qlen = md->dnsq_svc->query_len;
+    md->tcp_buf[0] = (uint8_t)(qlen >> 8);
+    md->tcp_buf[1] = (uint8_t)(qlen & 0xFF);
+    memcpy(&md->tcp_buf[2], md->dnsq_svc->query, qlen);
+    md->tcp_buf[2] = (uint8_t)(md->qid >> 8);
+    md->tcp_buf[3] = (uint8_t)(md->qid & 0xFF);
+    md->tcp_done = 0;
+
+    md->sock = sock;
+    md->dnsq_state = DNSQ_STATE_TCP_WRITING;
+    ev_io_set(md->tcp_watcher, sock, EV_WRITE);
+    ev_io_start(loop, md->tcp_watcher);
+    return true;
+}
+
+F_NONNULL
+static void mon_tcp_write(struct ev_loop* loop, dnsq_events_t* md) {
+    const unsigned total = md->dnsq_svc->query_len + 2U;
+    const ssize_t send_rv = send(md->sock, &md->tcp_buf[md->tcp_done], total - md->tcp_done, MSG_NOSIGNAL);
+    if(send_rv < 0) {
+        if(errno_is_retry(errno))
+            return;
+        // this is also where failed non-blocking connects end up
+        log_debug("plugin_dns_query: TCP send() for %s failed: %s", md->desc, dmn_logf_errno());
+        mon_finish(loop, md, false);
+        return;
+    }
+
+    md->tcp_done += (unsigned)send_rv;
+    if(md->tcp_done == total) {
+        md->tcp_done = 0;
+        md->dnsq_state = DNSQ_STATE_TCP_READING;
+        ev_io_stop(loop, md->tcp_watcher);
+        ev_io_set(md->tcp_watcher, md->sock, EV_READ);
+        ev_io_start(loop, md->tcp_watcher);
+    }
+}
+
+// We only read as much of the response as we need to validate
+//   it: the length prefix, the header, and the question.
+F_NONNULL
+static void mon_tcp_read(struct ev_loop* loop, dnsq_events_t* md) {
+    const unsigned qlen = md->dnsq_svc->query_len;
+    unsigned msg_len = 0;
+    unsigned want = 2U;
+    if(md->tcp_done >= 2U) {
+        msg_len = ((unsigned)md->tcp_buf[0] << 8) | md->tcp_buf[1];
+        want += msg_len < qlen ? msg_len : qlen;
+    }
+
+    const ssize_t recv_rv = recv(md->sock, &md->tcp_buf[md->tcp_done], want - md->tcp_done, 0);
+    if(recv_rv < 0) {
+        if(errno_is_retry(errno))
+            return;
+        log_debug("plugin_dns_query: TCP recv() for %s failed: %s", md->desc, dmn_logf_errno());
+        mon_finish(loop, md, false);
+        return;
+    }
+    if(!recv_rv) {
+        log_debug("plugin_dns_query: TCP connection for %s closed before a full response", md->desc);
+        mon_finish(loop, md, false);
+        return;
+    }
+
+    md->tcp_done += (unsigned)recv_rv;
+    if(md->tcp_done < want || want == 2U)
+        return; // more to read (the length prefix doesn't count)
+
+    const dnsq_resp_t resp = check_response(md, &md->tcp_buf[2], want - 2U, false);
+    if(resp == RESP_INVALID)
+        log_debug("plugin_dns_query: Invalid TCP response for %s", md->desc);
+    mon_finish(loop, md, resp == RESP_RCODE_OK);
+}
+
+F_NONNULL
+static void mon_tcp_cb(struct ev_loop* loop, struct ev_io* io, const int revents V_UNUSED) {
+    dnsq_events_t* md = io->data;
+
+    dmn_assert(md);
+    dmn_assert(md->sock > -1);
+    dmn_assert(ev_is_active(md->timeout_watcher) || ev_is_pending(md->timeout_watcher));
+
+    if(md->dnsq_state == DNSQ_STATE_TCP_WRITING) {
+        dmn_assert(revents == EV_WRITE);
+        mon_tcp_write(loop, md);
+    }
+    else {
+        dmn_assert(md->dnsq_state == DNSQ_STATE_TCP_READING);
+        dmn_assert(revents == EV_READ);
+        mon_tcp_read(loop, md);
+    }
+}
+
+F_NONNULL
+static void udp_read_cb(struct ev_loop* loop, struct ev_io* io, const int revents V_UNUSED) {
+    dmn_assert(revents == EV_READ);
+
+    // we're always in the one monitoring thread
+    static uint8_t buf[65536];
+
+    while(1) {
+        dmn_anysin_t src;
+        src.len = DMN_ANYSIN_MAXLEN;
+        const ssize_t recv_rv = recvfrom(io->fd, buf, sizeof(buf), 0, &src.sa, &src.len);
+        if(recv_rv < 0) {
+            if(!errno_is_retry(errno))
+                log_err("plugin_dns_query: recvfrom() on UDP monitoring socket failed: %s", dmn_logf_errno());
+            break;
+        }
+        if(recv_rv < 2)
+            continue;
+
+        // responses to anything we're no longer waiting on (e.g. after
+        //   timeout, or a duplicate), or from the wrong source, are ignored
+        const unsigned qid = ((unsigned)buf[0] << 8) | buf[1];
+        dnsq_events_t* md = pending[qid];
+        if(!md || md->dnsq_state != DNSQ_STATE_UDP || !addr_matches(&src, &md->addr))
+            continue;
+
+        const dnsq_resp_t resp = check_response(md, buf, (unsigned)recv_rv, md->dnsq_svc->tcp_fallback);
+        if(resp == RESP_INVALID) {
+            log_debug("plugin_dns_query: Ignoring invalid UDP response for %s", md->desc);
+        }
+        else if(resp == RESP_TRUNC) {
+            log_debug("plugin_dns_query: Truncated UDP response for %s, retrying over TCP", md->desc);
+            if(!tcp_start(loop, md))
+                mon_finish(loop, md, false);
+        }
+        else {
+            mon_finish(loop, md, resp == RESP_RCODE_OK);
+        }
+    }
+}
+
+F_NONNULL
+static bool udp_send(const dnsq_events_t* md) {
+    const dnsq_svc_t* svc = md->dnsq_svc;
+    const int sock = md->addr.sa.sa_family == AF_INET6 ? udp_sock_v6 : udp_sock_v4;
+    dmn_assert(sock > -1);
+
+    uint8_t buf[DNS_MAX_QUERY];
+    memcpy(buf, svc->query, svc->query_len);
+    buf[0] = (uint8_t)(md->qid >> 8);
+    buf[1] = (uint8_t)(md->qid & 0xFF);
+
+    const ssize_t send_rv = sendto(sock, buf, svc->query_len, 0, &md->addr.sa, md->addr.len);
+    if(send_rv != (ssize_t)svc->query_len) {
+        log_debug("plugin_dns_query: UDP sendto() for %s failed: %s", md->desc, dmn_logf_errno());
+        return false;
+    }
+    return true;
+}
+
+F_NONNULL
+static void mon_interval_cb(struct ev_loop* loop, struct ev_timer* t, const int revents V_UNUSED) {
+    dmn_assert(revents == EV_TIMER);
+
+    dnsq_events_t* md = t->data;
+
+    dmn_assert(md);
+
+    // apply the service type's jitter, if any, to the next regular
+    //   check (the initial round is a single-shot timer)
+    if(t->repeat > 0.0) {
+        const double next = gdnsd_mon_get_next_delay(md->idx);
+        if(next > 0.0) {
+            t->repeat = next;
+            ev_timer_again(loop, t);
+        }
+    }
+
+    if(md->dnsq_state != DNSQ_STATE_WAITING) {
+        log_warn("plugin_dns_query: A monitoring request attempt seems to have "
+            "lasted longer than the monitoring interval. "
+            "Skipping this round of monitoring - are you "
+            "starved for CPU time?");
+        return;
+    }
+
+    dmn_assert(md->sock == -1);
+    dmn_assert(!ev_is_active(md->tcp_watcher));
+    dmn_assert(!ev_is_active(md->timeout_watcher) && !ev_is_pending(md->timeout_watcher));
+
+    log_debug("plugin_dns_query: Starting state poll of %s", md->desc);
+    md->check_start = ev_now(loop);
+
+    if(!qid_alloc(md)) {
+        log_err("plugin_dns_query: Too many outstanding queries to check %s", md->desc);
+        mon_result(loop, md, false);
+        return;
+    }
+
+    if(!udp_send(md)) {
+        qid_free(md);
+        mon_result(loop, md, false);
+        return;
+    }
+
+    md->dnsq_state = DNSQ_STATE_UDP;
+    ev_timer_set(md->timeout_watcher, md->dnsq_svc->timeout, 0);
+    ev_timer_start(loop, md->timeout_watcher);
+}
+
+F_NONNULL
+static void mon_timeout_cb(struct ev_loop* loop, struct ev_timer* t, const int revents V_UNUSED) {
+    dmn_assert(revents == EV_TIMER);
+
+    dnsq_events_t* md = t->data;
+
+    dmn_assert(md);
+    dmn_assert(md->dnsq_state != DNSQ_STATE_WAITING);
+
+    log_debug("plugin_dns_query: State poll of %s timed out", md->desc);
+    mon_finish(loop, md, false);
+}
+
+#define SVC_OPT_UINT(_hash, _typnam, _loc, _min, _max) \
+    do { \
+        vscf_data_t* _data = vscf_hash_get_data_byconstkey(_hash, #_loc, true); \
+        if(_data) { \
+            unsigned long _val; \
+            if(!vscf_is_simple(_data) \
+            || !vscf_simple_get_as_ulong(_data, &_val)) \
+                log_fatal("plugin_dns_query: Service type '%s': option '%s': Value must be a positive integer", _typnam, #_loc); \
+            if(_val < _min || _val > _max) \
+                log_fatal("plugin_dns_query: Service type '%s': option '%s': Value out of range (%lu, %lu)", _typnam, #_loc, _min, _max); \
+            _loc = (unsigned) _val; \
+        } \
+    } while(0)
+
+#define SVC_OPT_STR(_hash, _typnam, _loc) \
+    do { \
+        vscf_data_t* _data = vscf_hash_get_data_byconstkey(_hash, #_loc, true); \
+        if(_data) { \
+            if(!vscf_is_simple(_data)) \
+                log_fatal("plugin_dns_query: Service type '%s': option %s: Wrong type (should be string)", _typnam, #_loc); \
+            _loc = vscf_simple_get_data(_data); \
+        } \
+    } while(0)
+
+#define SVC_OPT_BOOL(_hash, _typnam, _loc) \
+    do { \
+        vscf_data_t* _data = vscf_hash_get_data_byconstkey(_hash, #_loc, true); \
+        if(_data) { \
+            if(!vscf_is_simple(_data) || !vscf_simple_get_as_bool(_data, &_loc)) \
+                log_fatal("plugin_dns_query: Service type '%s': option '%s': Value must be 'true' or 'false'", _typnam, #_loc); \
+        } \
+    } while(0)
+
+// Look up a mnemonic from one of the tables above, also allowing
+//   plain numbers up to "max".  Returns false on failure.
+F_NONNULL
+static bool parse_dns_const(const dns_const_t* tbl, const unsigned tbl_len, const char* text, const unsigned long max, unsigned* out) {
+    for(unsigned i = 0; i < tbl_len; i++) {
+        if(!strcasecmp(text, tbl[i].name)) {
+            *out = tbl[i].num;
+            return true;
+        }
+    }
+
+    char* eptr;
+    errno = 0;
+    const unsigned long val = strtoul(text, &eptr, 10);
+    if(errno || eptr == text || *eptr || val > max)
+        return false;
+    *out = (unsigned)val;
+    return true;
+}
+
+F_NONNULL
+static void make_query(dnsq_svc_t* s, const char* qname, const unsigned qtype, const bool rd) {
+    uint8_t dname[256];
+    const unsigned qname_len = strlen(qname);
+    if(!qname_len)
+        log_fatal("plugin_dns_query: Service type '%s': option 'qname' cannot be empty", s->name);
+    const gdnsd_dname_status_t status = gdnsd_dname_from_string(dname, qname, qname_len);
+    if(status == DNAME_INVALID)
+        log_fatal("plugin_dns_query: Service type '%s': option 'qname': '%s' is not a valid domainname", s->name, qname);
+    if(status == DNAME_PARTIAL)
+        gdnsd_dname_terminate(dname); // always treated as fully-qualified
+
+    const unsigned wire_len = dname[0];
+    s->query_len = DNS_HDR_LEN + wire_len + 4U;
+    s->query = xcalloc(1, s->query_len);
+    s->query[2] = rd ? DNS_FLAG1_RD : 0;
+    s->query[5] = 1; // qdcount
+    memcpy(&s->query[DNS_HDR_LEN], &dname[1], wire_len);
+    uint8_t* qtail = &s->query[DNS_HDR_LEN + wire_len];
+    qtail[0] = (uint8_t)(qtype >> 8);
+    qtail[1] = (uint8_t)(qtype & 0xFF);
+    qtail[2] = 0;
+    qtail[3] = DNS_CLASS_IN;
+}
+
+void plugin_dns_query_add_svctype(const char* name, vscf_data_t* svc_cfg, const unsigned interval, const unsigned timeout) {
+    // defaults
+    const char* qname = ".";
+    const char* qtype = "SOA";
+    const char* rcode = "NOERROR";
+    unsigned port = 53U;
+    bool recursion_desired = false;
+    bool tcp_fallback = true;
+
+    service_types = xrealloc(service_types, (num_dnsq_svcs + 1) * sizeof(dnsq_svc_t));
+    dnsq_svc_t* this_svc = &service_types[num_dnsq_svcs++];
+
+    this_svc->name = strdup(name);
+
+    SVC_OPT_STR(svc_cfg, name, qname);
+    SVC_OPT_STR(svc_cfg, name, qtype);
+    SVC_OPT_STR(svc_cfg, name, rcode);
+    SVC_OPT_UINT(svc_cfg, name, port, 1LU, 65535LU);
+    SVC_OPT_BOOL(svc_cfg, name, recursion_desired);
+    SVC_OPT_BOOL(svc_cfg, name, tcp_fallback);
+
+    unsigned qtype_num;
+    if(!parse_dns_const(qtypes, sizeof(qtypes) / sizeof(qtypes[0]), qtype, 65535LU, &qtype_num) || !qtype_num)
+        log_fatal("plugin_dns_query: Service type '%s': option 'qtype': '%s' is not a supported type name or a number in the range 1-65535", name, qtype);
+    if(!parse_dns_const(rcodes, sizeof(rcodes) / sizeof(rcodes[0]), rcode, 15LU, &this_svc->rcode))
+        log_fatal("plugin_dns_query: Service type '%s': option 'rcode': '%s' is not a supported rcode name or a number in the range 0-15", name, rcode);
+
+    make_query(this_svc, qname, qtype_num, recursion_desired);
+    this_svc->port = port;
+    this_svc->tcp_fallback = tcp_fallback;
+    this_svc->timeout = timeout;
+    this_svc->interval = interval;
+}
+
+void plugin_dns_query_add_mon_addr(const char* desc, const char* svc_name, const char* cname V_UNUSED, const dmn_anysin_t* addr, const unsigned idx) {
+    dnsq_events_t* this_mon = xcalloc(1, sizeof(dnsq_events_t));
+    this_mon->desc = strdup(desc);
+    this_mon->idx = idx;
+
+    for(unsigned i = 0; i < num_dnsq_svcs; i++) {
+        if(!strcmp(service_types[i].name, svc_name)) {
+            this_mon->dnsq_svc = &service_types[i];
+            break;
+        }
+    }
+
+    dmn_assert(this_mon->dnsq_svc);
+
+    memcpy(&this_mon->addr, addr, sizeof(dmn_anysin_t));
+    if(this_mon->addr.sa.sa_family == AF_INET) {
+        this_mon->addr.sin.sin_port = htons(this_mon->dnsq_svc->port);
+    }
+    else {
+        dmn_assert(this_mon->addr.sa.sa_family == AF_INET6);
+        this_mon->addr.sin6.sin6_port = htons(this_mon->dnsq_svc->port);
+    }
+
+    this_mon->dnsq_state = DNSQ_STATE_WAITING;
+    this_mon->sock = -1;
+
+    this_mon->tcp_watcher = xmalloc(sizeof(ev_io));
+    ev_io_init(this_mon->tcp_watcher, &mon_tcp_cb, -1, 0);
+    this_mon->tcp_watcher->data = this_mon;
+
+    this_mon->timeout_watcher = xmalloc(sizeof(ev_timer));
+    ev_timer_init(this_mon->timeout_watcher, &mon_timeout_cb, 0, 0);
+    this_mon->timeout_watcher->data = this_mon;
+
+    this_mon->interval_watcher = xmalloc(sizeof(ev_timer));
+    ev_timer_init(this_mon->interval_watcher, &mon_interval_cb, 0, 0);
+    this_mon->interval_watcher->data = this_mon;
+
+    mons = xrealloc(mons, sizeof(dnsq_events_t*) * (num_mons + 1));
+    mons[num_mons++] = this_mon;
+}
+
+F_NONNULL
+static int udp_sock_setup(struct ev_loop* mon_loop, const bool isv6, ev_io** watcher_out) {
+    const int sock = socket(isv6 ? PF_INET6 : PF_INET, SOCK_DGRAM, gdnsd_getproto_udp());
+    if(sock == -1)
+        log_fatal("plugin_dns_query: Failed to create %s UDP monitoring socket: %s", isv6 ? "IPv6" : "IPv4", dmn_logf_errno());
+    if(fcntl(sock, F_SETFL, (fcntl(sock, F_GETFL, 0)) | O_NONBLOCK) == -1)
+        log_fatal("plugin_dns_query: Failed to set O_NONBLOCK on UDP monitoring socket: %s", dmn_logf_errno());
+    if(fcntl(sock, F_SETFD, FD_CLOEXEC) == -1)
+        log_fatal("plugin_dns_query: Failed to set FD_CLOEXEC on UDP monitoring socket: %s", dmn_logf_errno());
+
+    ev_io* watcher = xmalloc(sizeof(ev_io));
+    ev_io_init(watcher, &udp_read_cb, sock, EV_READ);
+    ev_io_start(mon_loop, watcher);
+    *watcher_out = watcher;
+    return sock;
+}
+
+void plugin_dns_query_init_monitors(struct ev_loop* mon_loop) {
+    if(!num_mons)
+        return;
+
+    pending = xcalloc(NUM_QIDS, sizeof(dnsq_events_t*));
+    rstate = gdnsd_rand32_init();
+
+    for(unsigned i = 0; i < num_mons; i++) {
+        if(mons[i]->addr.sa.sa_family == AF_INET6) {
+            if(udp_sock_v6 == -1)
+                udp_sock_v6 = udp_sock_setup(mon_loop, true, &udp_watcher_v6);
+        }
+        else if(udp_sock_v4 == -1) {
+            udp_sock_v4 = udp_sock_setup(mon_loop, false, &udp_watcher_v4);
+        }
+    }
+
+    for(unsigned i = 0; i < num_mons; i++) {
+        ev_timer* ival_watcher = mons[i]->interval_watcher;
+        dmn_assert(mons[i]->sock == -1);
+        ev_timer_set(ival_watcher, 0, 0);
+        ev_timer_start(mon_loop, ival_watcher);
+    }
+}
+
+// Unlike tcp_connect and http_status, all of our monitors stay in the
+//   primary monitoring loop (see gdnsd_mon_get_loop()), as they share
+//   the UDP sockets and the query ID table.
+void plugin_dns_query_start_monitors(struct ev_loop* mon_loop) {
+    init_phase = false;
+    if(udp_watcher_v4)
+        ev_io_start(mon_loop, udp_watcher_v4);
+    if(udp_watcher_v6)
+        ev_io_start(mon_loop, udp_watcher_v6);
+    for(unsigned i = 0; i < num_mons; i++) {
+        dnsq_events_t* mon = mons[i];
+        dmn_assert(mon->sock == -1);
+        const unsigned ival = mon->dnsq_svc->interval;
+        ev_timer* ival_watcher = mon->interval_watcher;
+        ev_timer_set(ival_watcher, gdnsd_mon_get_start_delay(mon->idx), ival);
+        ev_timer_start(mon_loop, ival_watcher);
+    }
+}
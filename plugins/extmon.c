@@ -47,7 +47,9 @@ typedef struct {
     unsigned timeout;
     unsigned interval;
     unsigned max_proc;
+    unsigned jitter_ms;
     bool direct;
+    bool persistent;
 } svc_t;
 
 typedef struct {
@@ -152,7 +154,8 @@ static void helper_read_cb(struct ev_loop* loop, ev_io* w, int revents V_UNUSED)
             gdnsd_mon_sttl_updater(this_mon->idx, new_sttl);
         }
         else {
-            gdnsd_mon_state_updater(this_mon->idx, !failed); // wants true for success
+            gdnsd_mon_state_updater_timed(this_mon->idx, !failed, // wants true for success
+                emc_decode_mon_latency_ms(data) / 1000.0);
         }
 
         if(init_phase) {
@@ -222,17 +225,25 @@ static void send_cmd(const unsigned idx, const mon_t* mon) {
 
     const unsigned thing_len = strlen(mon->thing);
 
+    // persistent workers are started with the literal args, and
+    //   are sent the item with each check request instead
     for(unsigned i = 0; i < mon->svc->num_args; i++)
-        this_args[i] = thing_xlate(mon->svc->args[i], mon->thing, thing_len);
+        this_args[i] = mon->svc->persistent
+            ? strdup(mon->svc->args[i])
+            : thing_xlate(mon->svc->args[i], mon->thing, thing_len);
 
     extmon_cmd_t this_cmd = {
         .idx = idx,
         .timeout = mon->svc->timeout,
         .interval = mon->svc->interval,
         .max_proc = mon->svc->max_proc,
+        .start_delay_ms = (unsigned)(gdnsd_mon_get_start_delay(mon->idx) * 1000.0),
+        .jitter_ms = mon->svc->jitter_ms,
         .num_args = mon->svc->num_args,
+        .worker = mon->svc->persistent ? (unsigned)(mon->svc - svcs) + 1U : 0U,
         .args = this_args,
         .desc = mon->desc,
+        .item = mon->svc->persistent ? mon->thing : NULL,
     };
 
     if(emc_write_command(helper_write_fd, &this_cmd)
@@ -391,6 +402,14 @@ void plugin_extmon_add_svctype(const char* name, vscf_data_t* svc_cfg, const uns
     SVC_OPT_UINT_NOMIN(svc_cfg, name, max_proc, 65534LU);
     this_svc->max_proc = max_proc;
 
+    // the generic "jitter" option was already validated by the core,
+    //   but the helper needs to apply it on our behalf
+    this_svc->jitter_ms = 0;
+    vscf_data_t* jitter_cfg = vscf_hash_get_data_byconstkey(svc_cfg, "jitter", true);
+    double jitter;
+    if(jitter_cfg && vscf_simple_get_as_double(jitter_cfg, &jitter))
+        this_svc->jitter_ms = (unsigned)(jitter * 1000.0);
+
     vscf_data_t* args_cfg = vscf_hash_get_data_byconstkey(svc_cfg, "cmd", true);
     if(!args_cfg)
         log_fatal("plugin_extmon: service_type '%s': option 'cmd' must be defined!", name);
@@ -411,6 +430,16 @@ void plugin_extmon_add_svctype(const char* name, vscf_data_t* svc_cfg, const uns
     vscf_data_t* direct_cfg = vscf_hash_get_data_byconstkey(svc_cfg, "direct", true);
     if(direct_cfg && !vscf_simple_get_as_bool(direct_cfg, &this_svc->direct))
         log_fatal("plugin_extmon: service type '%s': option 'direct' must have the value 'true' or 'false'", name);
+
+    this_svc->persistent = false;
+    vscf_data_t* persistent_cfg = vscf_hash_get_data_byconstkey(svc_cfg, "persistent", true);
+    if(persistent_cfg && !vscf_simple_get_as_bool(persistent_cfg, &this_svc->persistent))
+        log_fatal("plugin_extmon: service type '%s': option 'persistent' must have the value 'true' or 'false'", name);
+    if(this_svc->persistent) {
+        for(unsigned i = 0; i < this_svc->num_args; i++)
+            if(strstr(this_svc->args[i], "%%ITEM%%"))
+                log_fatal("plugin_extmon: service_type '%s': option 'cmd' cannot contain %%%%ITEM%%%% when 'persistent' is set", name);
+    }
 }
 
 static void add_mon_any(const char* desc, const char* svc_name, const char* thing, const unsigned idx) {
@@ -94,7 +94,8 @@ bool emc_write_command(const int fd, const extmon_cmd_t* cmd) {
     memcpy(buf, "CMD:", 4);
     len += 4;
 
-    // 2-byte index, 2-byte timeout, 2-byte interval, 2-byte max_proc
+    // 2-byte index, 2-byte timeout, 2-byte interval, 2-byte max_proc,
+    //   2-byte worker, 4-byte start_delay_ms, 4-byte jitter_ms
     buf[len++] = (char)(cmd->idx >> 8);
     buf[len++] = (char)(cmd->idx & 0xFF);
     buf[len++] = (char)(cmd->timeout >> 8);
@@ -103,8 +104,14 @@ bool emc_write_command(const int fd, const extmon_cmd_t* cmd) {
     buf[len++] = (char)(cmd->interval & 0xFF);
     buf[len++] = (char)(cmd->max_proc >> 8);
     buf[len++] = (char)(cmd->max_proc & 0xFF);
+    buf[len++] = (char)(cmd->worker >> 8);
+    buf[len++] = (char)(cmd->worker & 0xFF);
+    for(unsigned shift = 24; shift < 32; shift -= 8)
+        buf[len++] = (char)((cmd->start_delay_ms >> shift) & 0xFF);
+    for(unsigned shift = 24; shift < 32; shift -= 8)
+        buf[len++] = (char)((cmd->jitter_ms >> shift) & 0xFF);
 
-    // skip 2-byte len for rest of packet at offset 12
+    // skip 2-byte len for rest of packet at offset 22
     len += 2;
 
     // arg count + NUL-terminated arguments
@@ -128,11 +135,23 @@ bool emc_write_command(const int fd, const extmon_cmd_t* cmd) {
     memcpy(&buf[len], cmd->desc, desc_len);
     len += desc_len;
 
+    // NUL-terminated item string for persistent workers only
+    if(cmd->worker) {
+        dmn_assert(cmd->item);
+        const unsigned item_len = strlen(cmd->item) + 1;
+        while((len + item_len + 16) > alloc) {
+            alloc *= 2;
+            buf = xrealloc(buf, alloc);
+        }
+        memcpy(&buf[len], cmd->item, item_len);
+        len += item_len;
+    }
+
     // now go back and fill in the overall len
-    //   of the variable area for desc/args.
-    const unsigned var_len = len - 14;
-    buf[12] = (char)(var_len >> 8);
-    buf[13] = (char)(var_len & 0xFF);
+    //   of the variable area for desc/args/item.
+    const unsigned var_len = len - 24;
+    buf[22] = (char)(var_len >> 8);
+    buf[23] = (char)(var_len & 0xFF);
 
     bool rv = emc_write_string(fd, buf, len);
     free(buf);
@@ -155,8 +174,8 @@ extmon_cmd_t* emc_read_command(const int fd) {
     extmon_cmd_t* cmd = NULL;
 
     {
-        uint8_t fixed_part[14];
-        if(emc_read_nbytes(fd, 14, fixed_part)
+        uint8_t fixed_part[24];
+        if(emc_read_nbytes(fd, 24, fixed_part)
             || strncmp((char*)fixed_part, "CMD:", 4)) {
             log_debug("emc_read_command() failed to read CMD: prefix");
             goto out_error;
@@ -167,11 +186,17 @@ extmon_cmd_t* emc_read_command(const int fd) {
         cmd->timeout = ((unsigned)fixed_part[6] << 8) + fixed_part[7];
         cmd->interval = ((unsigned)fixed_part[8] << 8) + fixed_part[9];
         cmd->max_proc = ((unsigned)fixed_part[10] << 8) + fixed_part[11];
+        cmd->worker = ((unsigned)fixed_part[12] << 8) + fixed_part[13];
+        cmd->start_delay_ms = ((unsigned)fixed_part[14] << 24) + ((unsigned)fixed_part[15] << 16)
+            + ((unsigned)fixed_part[16] << 8) + fixed_part[17];
+        cmd->jitter_ms = ((unsigned)fixed_part[18] << 24) + ((unsigned)fixed_part[19] << 16)
+            + ((unsigned)fixed_part[20] << 8) + fixed_part[21];
         cmd->args = NULL;
         cmd->num_args = 0;
+        cmd->item = NULL;
 
         // note we add an extra NULL at the end of args here, for execl()
-        const unsigned var_len = ((unsigned)fixed_part[12] << 8) + fixed_part[13];
+        const unsigned var_len = ((unsigned)fixed_part[22] << 8) + fixed_part[23];
         if(var_len < 4) {
             // 4 bytes would be enough for num_args, a single 1-byte argument
             //   and its NUL termiantor, and a zero-length NUL-terminated desc
@@ -214,6 +239,17 @@ extmon_cmd_t* emc_read_command(const int fd) {
         cmd->desc = strdup((const char*)current);
         current += strlen((const char*)current);
         current++;
+        len_remain = var_len - (unsigned)(current - var_part);
+
+        if(cmd->worker) {
+            if(!nul_within_n_bytes(current, len_remain)) {
+                log_debug("emc_read_command(): item runs off end of buffer");
+                goto out_error;
+            }
+            cmd->item = strdup((const char*)current);
+            current += strlen((const char*)current);
+            current++;
+        }
 
         if(current != (var_part + var_len)) {
             log_debug("emc_read_command(): unused len at end of buffer!");
@@ -34,9 +34,19 @@ typedef struct {
     unsigned interval;
     unsigned max_proc;
     unsigned num_args;
+    // delay before the first regular check after the initial one,
+    //   and the random jitter of each interval, both in milliseconds
+    unsigned start_delay_ms;
+    unsigned jitter_ms;
+    // persistent worker number (one per service type), or zero
+    //   for traditional one-shot commands
+    unsigned worker;
     // all strings NUL-terminated
     char** args; // array-of-strings NULL-terminated
     const char* desc; // NUL-terminated, and we don't own it in plugin
+    // the monitored item sent to the persistent worker in each
+    //   check request, NULL for one-shot commands (not owned in plugin)
+    const char* item;
 } extmon_cmd_t;
 
 // these are used for simple protocol messages during
@@ -58,16 +68,22 @@ extmon_cmd_t* emc_read_command(const int fd);
 
 // encoding of helper -> daemon monitor results as uint32_t.
 // these uin32_t results are the only runtime traffic, and
-// they only flow in the helper->plugin direction
+// they only flow in the helper->plugin direction.
+// The high 16 bits are the monitor index, and the low 16 bits
+//   are the failure flag plus the check latency in milliseconds
+//   (the EMC_LATENCY_MASK bits), which saturates at EMC_LATENCY_MAX
+//   (about 32 seconds) so that no result can look like the exit marker.
+
+#define EMC_FAILED 0x8000U
+#define EMC_LATENCY_MASK 0x7FFFU
+#define EMC_LATENCY_MAX 0x7FFEU
 
 F_CONST F_UNUSED
-static uint32_t emc_encode_mon(const unsigned idx, const bool failed) {
+static uint32_t emc_encode_mon(const unsigned idx, const bool failed, const unsigned latency_ms) {
     dmn_assert(idx < 0x10000);
     return (idx << 16)
-        | (failed
-            ? (((unsigned)'F' << 8) | (unsigned)'A')
-            : (((unsigned)'O' << 8) | (unsigned)'K')
-        );
+        | (failed ? EMC_FAILED : 0U)
+        | (latency_ms < EMC_LATENCY_MAX ? latency_ms : EMC_LATENCY_MAX);
 }
 
 // send/recv helper-exit
@@ -81,17 +97,14 @@ static unsigned emc_decode_mon_idx(const uint32_t data) {
     return (data >> 16);
 }
 
-F_UNUSED
+F_CONST F_UNUSED
 static bool emc_decode_mon_failed(const uint32_t data) {
-    const unsigned failflag = data & 0xFFFF;
-    bool rv = true;
-    if(failflag == (((unsigned)'O' << 8) | (unsigned)'K')) {
-        rv = false;
-    }
-    else if(failflag != (((unsigned)'F' << 8) | (unsigned)'A')) {
-        log_err("plugin_extmon: BUG: Invalid monitoring result %x!", data);
-    }
-    return rv;
+    return !!(data & EMC_FAILED);
+}
+
+F_CONST F_UNUSED
+static unsigned emc_decode_mon_latency_ms(const uint32_t data) {
+    return data & EMC_LATENCY_MASK;
 }
 
 #endif // GDNSD_EXTMON_COMMS_H
@@ -24,6 +24,8 @@
 #include <gdnsd/alloc.h>
 #include <gdnsd/compiler.h>
 #include <gdnsd/log.h>
+#include <gdnsd/misc.h>
+#include <gdnsd-prot/misc.h>
 
 #include <stdio.h>
 #include <unistd.h>
@@ -42,20 +44,57 @@
 #  define NSIG 100
 #endif
 
+// A persistent worker is a long-running process shared by all of the
+//   commands of one service type, which is started on demand and
+//   receives check requests on its stdin and answers them on its stdout,
+//   one line per message:
+//     request:  "<id> <item>\n"
+//     response: "<id> OK\n" or "<id> FAIL\n"
+//   <id> is an opaque whitespace-free token which must be echoed back
+//   verbatim, and responses may arrive in any order.
+typedef struct {
+    char** args; // from the first command using this worker
+    pid_t pid; // zero if not running
+    int req_fd; // write side of the worker's stdin
+    int resp_fd; // read side of the worker's stdout
+    ev_io* req_watcher;
+    ev_io* resp_watcher;
+    ev_child* child_watcher;
+    char* reqbuf; // queued, not-yet-written requests
+    unsigned reqbuf_len;
+    unsigned reqbuf_alloc;
+    unsigned respbuf_len;
+    char respbuf[1024]; // partial response line
+} worker_t;
+
+// If this much request data backs up, the worker isn't reading it
+#define WORKER_REQBUF_MAX 1048576U
+
 typedef struct {
     extmon_cmd_t* cmd;
+    worker_t* worker; // NULL for one-shot commands
     ev_timer* interval_timer;
     ev_timer* cmd_timeout;
     ev_child* child_watcher;
     pid_t cmd_pid;
+    unsigned seq; // request sequence for persistent workers
     bool result_pending;
+    bool started; // past the initial check
+    ev_tstamp check_start; // for the check latency
 } mon_t;
 
 static unsigned num_mons = 0;
 static mon_t* mons = NULL;
 
+static unsigned num_workers = 0;
+static worker_t* workers = NULL;
+static ev_timer* worker_kill_timer = NULL;
+
 static unsigned num_proc = 0;
 
+// for jitter
+static gdnsd_rstate32_t* jitter_rstate = NULL;
+
 F_NONNULL F_NORETURN
 static void syserr_for_ev(const char* msg) { log_fatal("%s: %s", msg, dmn_logf_errno()); }
 
@@ -128,6 +167,36 @@ static void sendq_deq_commit(void) {
     sendq_len--;
 }
 
+// Once the initial check has a result, moves the interval timer to this
+//   monitor's start phase, measured from the start of the initial check.
+//   This can't be done any earlier, as a phase shorter than the check
+//   itself would fire the next check while the initial one is running.
+F_NONNULL
+static void mon_start_phase(struct ev_loop* loop, mon_t* mon) {
+    dmn_assert(!mon->started);
+    mon->started = true;
+    if(mon->cmd->start_delay_ms) {
+        double delay = mon->cmd->start_delay_ms / 1000.0 - (ev_now(loop) - mon->check_start);
+        if(delay < 0.0)
+            delay = 0.0;
+        ev_timer_stop(loop, mon->interval_timer);
+        ev_timer_set(mon->interval_timer, delay, mon->cmd->interval);
+        ev_timer_start(loop, mon->interval_timer);
+    }
+}
+
+// Queues the result of a check for the plugin, along with its latency
+F_NONNULL
+static void send_result(struct ev_loop* loop, mon_t* mon, const bool failed) {
+    const double latency_ms = (ev_now(loop) - mon->check_start) * 1000.0;
+    sendq_enq(emc_encode_mon(mon->cmd->idx, failed,
+        latency_ms <= 0.0 ? 0U
+            : latency_ms < EMC_LATENCY_MAX ? (unsigned)latency_ms : EMC_LATENCY_MAX));
+    ev_io_start(loop, plugin_write_watcher);
+    if(!mon->started)
+        mon_start_phase(loop, mon);
+}
+
 /*************************************************************************/
 
 static void mon_timeout_cb(struct ev_loop* loop, ev_timer* w, int revents V_UNUSED) {
@@ -135,6 +204,18 @@ static void mon_timeout_cb(struct ev_loop* loop, ev_timer* w, int revents V_UNUS
 
     mon_t* this_mon = w->data;
     dmn_assert(this_mon->result_pending);
+
+    if(this_mon->worker) {
+        // the worker itself is left alone, and its eventual
+        //   response to this request will be ignored
+        dmn_log_warn("Persistent worker for '%s' timed out after %u seconds.  Marking failed...", this_mon->cmd->desc, this_mon->cmd->timeout);
+        if(!killed_by) {
+            send_result(loop, this_mon, true);
+        }
+        this_mon->result_pending = false;
+        return;
+    }
+
     dmn_log_warn("Monitor child process for '%s' timed out after %u seconds.  Marking failed and sending SIGKILL...", this_mon->cmd->desc, this_mon->cmd->timeout);
     kill(this_mon->cmd_pid, SIGKILL);
     // note we don't stop the child_watcher because we still
@@ -145,8 +226,7 @@ static void mon_timeout_cb(struct ev_loop* loop, ev_timer* w, int revents V_UNUS
     //   giving up on waitpid() of this child.  Not much else we
     //   could do in that case anyways.
     if(!killed_by) {
-        sendq_enq(emc_encode_mon(this_mon->cmd->idx, true));
-        ev_io_start(loop, plugin_write_watcher);
+        send_result(loop, this_mon, true);
     }
     if (num_proc > 0) {
         num_proc--;
@@ -180,8 +260,7 @@ static void mon_child_cb(struct ev_loop* loop, ev_child* w, int revents V_UNUSED
     //   here when we reap the SIGKILL'd child
     if(this_mon->result_pending) {
         if(!killed_by) {
-            sendq_enq(emc_encode_mon(this_mon->cmd->idx, failed));
-            ev_io_start(loop, plugin_write_watcher);
+            send_result(loop, this_mon, failed);
         }
         if (num_proc > 0) {
             num_proc--;
@@ -190,22 +269,10 @@ static void mon_child_cb(struct ev_loop* loop, ev_child* w, int revents V_UNUSED
     }
 }
 
-static void mon_interval_cb(struct ev_loop* loop, ev_timer* w, int revents V_UNUSED) {
-    dmn_assert(loop); dmn_assert(w); dmn_assert(revents == EV_TIMER);
-
-    mon_t* this_mon = w->data;
-    dmn_assert(!this_mon->result_pending);
-
-    if (this_mon->cmd->max_proc > 0 && num_proc >= this_mon->cmd->max_proc) {
-        // If more than max_proc processes are running, reschedule excess
-        //   checks to run 0.1 seconds later. After a few passes, this will
-        //   smooth the schedule out to prevent a thundering herd.
-        ev_timer_stop(loop, this_mon->interval_timer);
-        ev_timer_set(this_mon->interval_timer, 0.1, this_mon->cmd->interval);
-        ev_timer_start(loop, this_mon->interval_timer);
-        return;
-    }
-
+// Forks and execs "args", optionally with stdin and stdout
+//   replaced by "in_fd" and "out_fd" (-1 to leave alone)
+F_NONNULL
+static pid_t fork_exec(char** args, const int in_fd, const int out_fd) {
     // Before forking, block all signals and save the old mask
     //   to avoid a race condition where local sighandlers execute
     //   in the child between fork and exec().
@@ -216,11 +283,11 @@ static void mon_interval_cb(struct ev_loop* loop, ev_timer* w, int revents V_UNU
     if(pthread_sigmask(SIG_SETMASK, &all_sigs, &saved_mask))
         log_fatal("pthread_sigmask() failed");
 
-    this_mon->cmd_pid = fork();
-    if(this_mon->cmd_pid == -1)
+    const pid_t pid = fork();
+    if(pid == -1)
         log_fatal("fork() failed: %s", dmn_logf_strerror(errno));
 
-    if(!this_mon->cmd_pid) { // child
+    if(!pid) { // child
         // reset all signal handlers to default before unblocking
         struct sigaction defaultme;
         sigemptyset(&defaultme.sa_mask);
@@ -237,21 +304,300 @@ static void mon_interval_cb(struct ev_loop* loop, ev_timer* w, int revents V_UNU
         if(pthread_sigmask(SIG_SETMASK, &no_sigs, NULL))
             log_fatal("pthread_sigmask() failed");
 
+        if(in_fd >= 0 && (dup2(in_fd, STDIN_FILENO) < 0 || close(in_fd)))
+            log_fatal("Failed to set up worker stdin: %s", dmn_logf_errno());
+        if(out_fd >= 0 && (dup2(out_fd, STDOUT_FILENO) < 0 || close(out_fd)))
+            log_fatal("Failed to set up worker stdout: %s", dmn_logf_errno());
+
         // technically, we could go ahead and close off stdout/stderr
         //   here for the "startfg" case, but why bother?  If the user
         //   is debugging via startfg they might want to see this crap anyways.
-        execv(this_mon->cmd->args[0], this_mon->cmd->args);
-        log_fatal("execv(%s, ...) failed: %s", this_mon->cmd->args[0], dmn_logf_strerror(errno));
+        execv(args[0], args);
+        log_fatal("execv(%s, ...) failed: %s", args[0], dmn_logf_strerror(errno));
     }
-    num_proc++;
 
     // restore previous signal mask from before fork in parent
     if(pthread_sigmask(SIG_SETMASK, &saved_mask, NULL))
         log_fatal("pthread_sigmask() failed");
 
+    return pid;
+}
+
+/*************************************************************************/
+// Persistent workers
+
+// Fails all pending requests to the worker and shuts it down, if running
+F_NONNULL
+static void worker_stop(struct ev_loop* loop, worker_t* wk) {
+    if(wk->pid) {
+        kill(wk->pid, SIGKILL); // libev reaps it in any case
+        wk->pid = 0;
+    }
+    ev_child_stop(loop, wk->child_watcher);
+    if(wk->req_fd >= 0) {
+        ev_io_stop(loop, wk->req_watcher);
+        close(wk->req_fd);
+        wk->req_fd = -1;
+    }
+    if(wk->resp_fd >= 0) {
+        ev_io_stop(loop, wk->resp_watcher);
+        close(wk->resp_fd);
+        wk->resp_fd = -1;
+    }
+    wk->reqbuf_len = 0;
+    wk->respbuf_len = 0;
+
+    for(unsigned i = 0; i < num_mons; i++) {
+        mon_t* mon = &mons[i];
+        if(mon->worker == wk && mon->result_pending) {
+            ev_timer_stop(loop, mon->cmd_timeout);
+            mon->result_pending = false;
+            if(!killed_by) {
+                send_result(loop, mon, true);
+            }
+        }
+    }
+
+    // during shutdown, once the last worker is gone there's nothing left
+    //   for the kill timer to do, and it would hold up the loop exit
+    if(killed_by) {
+        bool workers_running = false;
+        for(unsigned i = 0; i < num_workers; i++)
+            if(workers[i].pid)
+                workers_running = true;
+        if(!workers_running)
+            ev_timer_stop(loop, worker_kill_timer);
+    }
+}
+
+static void worker_child_cb(struct ev_loop* loop, ev_child* w, int revents V_UNUSED) {
+    dmn_assert(loop); dmn_assert(w); dmn_assert(revents == EV_CHILD);
+
+    worker_t* wk = w->data;
+    const int status = w->rstatus;
+    if(killed_by)
+        log_debug("Persistent worker '%s' exited during shutdown", wk->args[0]);
+    else if(WIFEXITED(status))
+        dmn_log_warn("Persistent worker '%s' exited with status %i", wk->args[0], WEXITSTATUS(status));
+    else if(WIFSIGNALED(status))
+        dmn_log_warn("Persistent worker '%s' terminated by signal %i", wk->args[0], WTERMSIG(status));
+    else
+        dmn_log_warn("Persistent worker '%s' terminated abnormally...", wk->args[0]);
+    wk->pid = 0; // already gone
+    worker_stop(loop, wk);
+}
+
+// Parses the "<idx>.<seq> " prefix of a response line, returning
+//   a pointer to the status string, or NULL if invalid.
+F_NONNULL
+static char* worker_parse_id(char* line, unsigned long* idx_out, unsigned long* seq_out) {
+    char* endp;
+    *idx_out = strtoul(line, &endp, 10);
+    if(endp == line || *endp++ != '.')
+        return NULL;
+    char* seq_str = endp;
+    *seq_out = strtoul(seq_str, &endp, 10);
+    if(endp == seq_str || *endp++ != ' ')
+        return NULL;
+    return endp;
+}
+
+// Handles one complete response line from the worker,
+//   ignoring any stale responses to timed-out requests
+F_NONNULL
+static void worker_response(struct ev_loop* loop, worker_t* wk, char* line) {
+    unsigned long idx;
+    unsigned long seq;
+    const char* status = worker_parse_id(line, &idx, &seq);
+    if(!status || idx >= num_mons || mons[idx].worker != wk) {
+        dmn_log_warn("Persistent worker '%s' sent an invalid response line '%s'", wk->args[0], line);
+        return;
+    }
+
+    mon_t* mon = &mons[idx];
+    if(!mon->result_pending || mon->seq != seq) {
+        log_debug("Ignoring stale response from persistent worker for '%s'", mon->cmd->desc);
+        return;
+    }
+
+    const bool failed = !!strcmp(status, "OK");
+    if(failed && strcmp(status, "FAIL"))
+        dmn_log_warn("Persistent worker for '%s' returned invalid status '%s', marking failed", mon->cmd->desc, status);
+
+    ev_timer_stop(loop, mon->cmd_timeout);
+    mon->result_pending = false;
+    if(!killed_by) {
+        send_result(loop, mon, failed);
+    }
+}
+
+static void worker_resp_cb(struct ev_loop* loop, ev_io* w, int revents V_UNUSED) {
+    dmn_assert(loop); dmn_assert(w); dmn_assert(revents == EV_READ);
+
+    worker_t* wk = w->data;
+    dmn_assert(wk->resp_fd == w->fd);
+
+    const ssize_t read_rv = read(wk->resp_fd, &wk->respbuf[wk->respbuf_len], sizeof(wk->respbuf) - wk->respbuf_len);
+    if(read_rv < 1) {
+        if(read_rv < 0 && (ERRNO_WOULDBLOCK || errno == EINTR))
+            return;
+        if(read_rv < 0)
+            dmn_log_warn("Persistent worker '%s': read() failed: %s", wk->args[0], dmn_logf_errno());
+        else if(!killed_by)
+            dmn_log_warn("Persistent worker '%s' closed its stdout", wk->args[0]);
+        worker_stop(loop, wk);
+        return;
+    }
+    wk->respbuf_len += (unsigned)read_rv;
+
+    // process every complete line, then shift any partial one to the front
+    char* line = wk->respbuf;
+    char* nl;
+    while((nl = memchr(line, '\n', wk->respbuf_len - (unsigned)(line - wk->respbuf)))) {
+        *nl = '\0';
+        worker_response(loop, wk, line);
+        line = nl + 1;
+    }
+    wk->respbuf_len -= (unsigned)(line - wk->respbuf);
+    memmove(wk->respbuf, line, wk->respbuf_len);
+
+    if(wk->respbuf_len == sizeof(wk->respbuf)) {
+        dmn_log_warn("Persistent worker '%s' sent an overlong response line, restarting it", wk->args[0]);
+        worker_stop(loop, wk);
+    }
+}
+
+static void worker_req_cb(struct ev_loop* loop, ev_io* w, int revents V_UNUSED) {
+    dmn_assert(loop); dmn_assert(w); dmn_assert(revents == EV_WRITE);
+
+    worker_t* wk = w->data;
+    dmn_assert(wk->req_fd == w->fd);
+
+    unsigned written = 0;
+    while(written < wk->reqbuf_len) {
+        const ssize_t write_rv = write(wk->req_fd, &wk->reqbuf[written], wk->reqbuf_len - written);
+        if(write_rv < 1) {
+            if(write_rv < 0 && ERRNO_WOULDBLOCK)
+                break; // pipe full, wait for more libev notification of write-ready
+            if(write_rv < 0 && errno == EINTR)
+                continue;
+            dmn_log_warn("Persistent worker '%s': write() failed: %s", wk->args[0], write_rv ? dmn_logf_errno() : "zero-length write");
+            worker_stop(loop, wk);
+            return;
+        }
+        written += (unsigned)write_rv;
+    }
+
+    wk->reqbuf_len -= written;
+    memmove(wk->reqbuf, &wk->reqbuf[written], wk->reqbuf_len);
+    if(!wk->reqbuf_len)
+        ev_io_stop(loop, w);
+}
+
+F_NONNULL
+static void worker_spawn(struct ev_loop* loop, worker_t* wk) {
+    dmn_assert(!wk->pid);
+
+    int req_pipe[2];
+    int resp_pipe[2];
+    if(pipe(req_pipe) || pipe(resp_pipe))
+        log_fatal("pipe() failed: %s", dmn_logf_errno());
+
+    // our ends are non-blocking and must not leak into other children
+    if(fcntl(req_pipe[1], F_SETFL, (fcntl(req_pipe[1], F_GETFL, 0)) | O_NONBLOCK) == -1
+        || fcntl(resp_pipe[0], F_SETFL, (fcntl(resp_pipe[0], F_GETFL, 0)) | O_NONBLOCK) == -1)
+        log_fatal("Failed to set O_NONBLOCK on pipe: %s", dmn_logf_errno());
+    if(fcntl(req_pipe[1], F_SETFD, FD_CLOEXEC) || fcntl(resp_pipe[0], F_SETFD, FD_CLOEXEC))
+        log_fatal("Failed to set FD_CLOEXEC on pipe: %s", dmn_logf_errno());
+
+    wk->pid = fork_exec(wk->args, req_pipe[0], resp_pipe[1]);
+    close(req_pipe[0]);
+    close(resp_pipe[1]);
+    log_debug("Started persistent worker '%s' as pid %li", wk->args[0], (long)wk->pid);
+
+    wk->req_fd = req_pipe[1];
+    wk->resp_fd = resp_pipe[0];
+    ev_io_set(wk->req_watcher, wk->req_fd, EV_WRITE);
+    ev_io_set(wk->resp_watcher, wk->resp_fd, EV_READ);
+    ev_io_start(loop, wk->resp_watcher);
+    ev_child_set(wk->child_watcher, wk->pid, 0);
+    ev_child_start(loop, wk->child_watcher);
+}
+
+// Queues a check request for this_mon to its worker
+F_NONNULL
+static void worker_request(struct ev_loop* loop, mon_t* this_mon) {
+    worker_t* wk = this_mon->worker;
+    if(!wk->pid)
+        worker_spawn(loop, wk);
+
+    this_mon->seq++;
+    char req[1024];
+    const int req_len = snprintf(req, sizeof(req), "%u.%u %s\n", this_mon->cmd->idx, this_mon->seq, this_mon->cmd->item);
+    if(req_len < 0 || (unsigned)req_len >= sizeof(req))
+        log_fatal("Persistent worker request for '%s' is too long", this_mon->cmd->desc);
+
+    if(wk->reqbuf_len + (unsigned)req_len > wk->reqbuf_alloc) {
+        if(wk->reqbuf_len + (unsigned)req_len > WORKER_REQBUF_MAX) {
+            dmn_log_warn("Persistent worker '%s' is not reading its requests, restarting it", wk->args[0]);
+            worker_stop(loop, wk);
+            worker_spawn(loop, wk);
+        }
+        while(wk->reqbuf_len + (unsigned)req_len > wk->reqbuf_alloc)
+            wk->reqbuf_alloc = wk->reqbuf_alloc ? wk->reqbuf_alloc << 1 : 4096U;
+        wk->reqbuf = xrealloc(wk->reqbuf, wk->reqbuf_alloc);
+    }
+    memcpy(&wk->reqbuf[wk->reqbuf_len], req, (unsigned)req_len);
+    wk->reqbuf_len += (unsigned)req_len;
+    ev_io_start(loop, wk->req_watcher);
+}
+
+/*************************************************************************/
+
+static void mon_interval_cb(struct ev_loop* loop, ev_timer* w, int revents V_UNUSED) {
+    dmn_assert(loop); dmn_assert(w); dmn_assert(revents == EV_TIMER);
+
+    mon_t* this_mon = w->data;
+    dmn_assert(!this_mon->result_pending);
+
+    // apply any jitter to each regular interval (the move to the start
+    //   phase happens when the initial check's result arrives)
+    if(this_mon->started && this_mon->cmd->jitter_ms) {
+        const double jitter = this_mon->cmd->jitter_ms / 1000.0;
+        const double r = gdnsd_rand32_get(jitter_rstate) / 4294967296.0;
+        w->repeat = this_mon->cmd->interval + jitter * (r * 2.0 - 1.0);
+        ev_timer_again(loop, w);
+    }
+
+    if(this_mon->worker) {
+        worker_request(loop, this_mon);
+        this_mon->result_pending = true;
+        this_mon->check_start = ev_now(loop);
+        ev_timer_set(this_mon->cmd_timeout, this_mon->cmd->timeout, 0);
+        ev_timer_start(loop, this_mon->cmd_timeout);
+        return;
+    }
+
+    if (this_mon->cmd->max_proc > 0 && num_proc >= this_mon->cmd->max_proc) {
+        // If more than max_proc processes are running, reschedule excess
+        //   checks to run 0.1 seconds later. After a few passes, this will
+        //   smooth the schedule out to prevent a thundering herd.
+        ev_timer_stop(loop, this_mon->interval_timer);
+        ev_timer_set(this_mon->interval_timer, 0.1, this_mon->cmd->interval);
+        ev_timer_start(loop, this_mon->interval_timer);
+        return;
+    }
+
+    this_mon->cmd_pid = fork_exec(this_mon->cmd->args, -1, -1);
+    num_proc++;
+
     this_mon->result_pending = true;
+    this_mon->check_start = ev_now(loop);
     ev_timer_set(this_mon->cmd_timeout, this_mon->cmd->timeout, 0);
     ev_timer_start(loop, this_mon->cmd_timeout);
+    // a timed-out previous child may not have been reaped yet, in which
+    //   case we give up on waiting for it (libev still reaps it)
+    ev_child_stop(loop, this_mon->child_watcher);
     ev_child_set(this_mon->child_watcher, this_mon->cmd_pid, 0);
     ev_child_start(loop, this_mon->child_watcher);
 }
@@ -314,6 +660,31 @@ static void die_gracefully(struct ev_loop* loop) {
                 }
             }
         }
+        // persistent workers get EOF on stdin as a request to exit, and
+        //   are killed if they're still around 2.0s later.
+        bool workers_running = false;
+        for(unsigned i = 0; i < num_workers; i++) {
+            worker_t* wk = &workers[i];
+            if(wk->req_fd >= 0) {
+                ev_io_stop(loop, wk->req_watcher);
+                close(wk->req_fd);
+                wk->req_fd = -1;
+            }
+            if(wk->pid)
+                workers_running = true;
+        }
+        if(workers_running)
+            ev_timer_start(loop, worker_kill_timer);
+    }
+}
+
+static void worker_kill_cb(struct ev_loop* loop, ev_timer* w V_UNUSED, int revents V_UNUSED) {
+    dmn_assert(loop); dmn_assert(w); dmn_assert(revents == EV_TIMER);
+    for(unsigned i = 0; i < num_workers; i++) {
+        if(workers[i].pid) {
+            log_debug("Persistent worker '%s' did not exit, sending SIGKILL", workers[i].args[0]);
+            worker_stop(loop, &workers[i]);
+        }
     }
 }
 
@@ -401,6 +772,8 @@ int main(int argc, char** argv) {
             log_fatal("Failed to read command %u from plugin", i);
         if(i != mons[i].cmd->idx)
             log_fatal("BUG: plugin index issues, %u vs %u", i, mons[i].cmd->idx);
+        if(mons[i].cmd->worker > num_workers)
+            num_workers = mons[i].cmd->worker;
         if(emc_write_string(plugin_write_fd, "CMD_ACK", 7))
             log_fatal("Failed to write CMD_ACK for command %u to plugin", i);
     }
@@ -419,9 +792,17 @@ int main(int argc, char** argv) {
     if(fcntl(plugin_write_fd, F_SETFD, FD_CLOEXEC))
         log_fatal("Failed to set FD_CLOEXEC on plugin write fd: %s", dmn_logf_strerror(errno));
 
+    // Writes to the pipes of dead workers should fail with EPIPE
+    //   rather than kill us (children get default handlers again)
+    signal(SIGPIPE, SIG_IGN);
+
     // init results-sending queue
     sendq_init();
 
+    // for jitter
+    gdnsd_rand_meta_init();
+    jitter_rstate = gdnsd_rand32_init();
+
     // Set up libev error callback
     ev_set_syserr_cb(&syserr_for_ev);
 
@@ -448,6 +829,35 @@ int main(int argc, char** argv) {
     ev_io_init(plugin_write_watcher, plugin_write_cb, plugin_write_fd, EV_WRITE);
     ev_set_priority(plugin_write_watcher, 1);
 
+    // set up the (not yet running) persistent workers, one per
+    //   worker number, using the args of the first command of each
+    workers = xcalloc(num_workers, sizeof(worker_t));
+    for(unsigned i = 0; i < num_workers; i++) {
+        worker_t* wk = &workers[i];
+        wk->req_fd = -1;
+        wk->resp_fd = -1;
+        wk->req_watcher = xmalloc(sizeof(ev_io));
+        ev_io_init(wk->req_watcher, worker_req_cb, -1, EV_WRITE);
+        wk->req_watcher->data = wk;
+        wk->resp_watcher = xmalloc(sizeof(ev_io));
+        ev_io_init(wk->resp_watcher, worker_resp_cb, -1, EV_READ);
+        ev_set_priority(wk->resp_watcher, 1);
+        wk->resp_watcher->data = wk;
+        wk->child_watcher = xmalloc(sizeof(ev_child));
+        ev_child_init(wk->child_watcher, worker_child_cb, 0, 0);
+        wk->child_watcher->data = wk;
+    }
+    for(unsigned i = 0; i < num_mons; i++) {
+        if(mons[i].cmd->worker) {
+            worker_t* wk = &workers[mons[i].cmd->worker - 1];
+            if(!wk->args)
+                wk->args = mons[i].cmd->args;
+            mons[i].worker = wk;
+        }
+    }
+    worker_kill_timer = xmalloc(sizeof(ev_timer));
+    ev_timer_init(worker_kill_timer, worker_kill_cb, 2.0, 0.);
+
     // set up interval watchers for each monitor, initially for immediate firing
     //   for the daemon's monitoring init cycle, then repeating every interval.
     for(unsigned i = 0; i < num_mons; i++) {
@@ -485,6 +895,13 @@ int main(int argc, char** argv) {
             needs_wait = true;
         }
     }
+    for(unsigned i = 0; i < num_workers; i++) {
+        if(workers[i].pid) {
+            log_debug("not-so-graceful shutdown: sending SIGKILL to %li", (long)workers[i].pid);
+            kill(workers[i].pid, SIGKILL);
+            needs_wait = true;
+        }
+    }
 
     if(needs_wait) {
         unsigned i = 500; // 5s for OS to give us all the SIGKILL'd zombies
@@ -22,11 +22,13 @@
 
 #include <config.h>
 
+#include <gdnsd/alloc.h>
 #include <gdnsd/dmn.h>
 #include <gdnsd/log.h>
 #include <gdnsd/vscf.h>
 #include <gdnsd/plugapi.h>
 #include <gdnsd/paths.h>
+#include <gdnsd-prot/paths.h>
 
 #include <gdmaps.h>
 
@@ -34,18 +36,26 @@
 #include <stdio.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <arpa/inet.h>
 #include <netdb.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <time.h>
 
 static gdmaps_t* gdmaps = NULL;
 
 F_NONNULL F_NORETURN
 static void usage(const char* argv0) {
     fprintf(stderr, "\nUsage: %s [-c %s] [map_name addr]\n"
+        "       %s [-c %s] [-C cmp_dir] [-t threads] -b infile map_name\n"
         "  -c\t\tgdnsd config dir, see main gdnsd(8) manpage for details\n"
+        "  -b\t\tBulk mode: read one addr[/mask] per line from infile ('-' for stdin)\n"
+        "  -t\t\tBulk mode: number of lookup threads (default 1)\n"
+        "  -C\t\tBulk mode: compare results against maps from a second config dir\n"
         "  map_name\tMapping name from geoip plugin config\n"
         "  addr\t\tClient IP address to map.\n\n",
+        argv0, gdnsd_get_default_config_dir(),
         argv0, gdnsd_get_default_config_dir());
     exit(1);
 }
@@ -134,6 +144,309 @@ static void do_repl(void) {
     }
 }
 
+/***************************************
+ * Bulk mode
+ **************************************/
+
+// Bulk mode reads the whole input into memory first, so that
+//   only gdmaps_lookup() itself is measured.  Each input line is
+//   an address, optionally with an edns-client-subnet style
+//   "/mask" (host bits beyond the mask are zeroed).
+typedef struct {
+    client_info_t* clients;
+    unsigned count;
+    unsigned alloc;
+} bulk_input_t;
+
+typedef struct {
+    const uint8_t** dclists;
+    unsigned* scopes;
+} bulk_results_t;
+
+typedef struct {
+    const gdmaps_t* maps;
+    unsigned map_idx;
+    const client_info_t* clients;
+    bulk_results_t* results;
+    uint32_t* lat_ns; // NULL for the untimed throughput pass
+    unsigned start;
+    unsigned end;
+} bulk_slice_t;
+
+F_NONNULL
+static bool bulk_parse_line(char* line, client_info_t* cinfo) {
+    unsigned mask = 0;
+    char* slash = strchr(line, '/');
+    if(slash) {
+        *slash++ = '\0';
+        char* eptr;
+        unsigned long mask_ul = strtoul(slash, &eptr, 10);
+        if(eptr == slash || *eptr || mask_ul > 128)
+            return true;
+        mask = (unsigned)mask_ul;
+    }
+
+    memset(cinfo, 0, sizeof(*cinfo));
+    dmn_anysin_t* asin = &cinfo->edns_client;
+    uint8_t* abytes;
+    unsigned alen;
+    if(inet_pton(AF_INET, line, &asin->sin.sin_addr) == 1) {
+        asin->sin.sin_family = AF_INET;
+        asin->len = sizeof(struct sockaddr_in);
+        abytes = (uint8_t*)&asin->sin.sin_addr.s_addr;
+        alen = 32;
+    }
+    else if(inet_pton(AF_INET6, line, &asin->sin6.sin6_addr) == 1) {
+        asin->sin6.sin6_family = AF_INET6;
+        asin->len = sizeof(struct sockaddr_in6);
+        abytes = asin->sin6.sin6_addr.s6_addr;
+        alen = 128;
+    }
+    else {
+        return true;
+    }
+
+    if(!slash) {
+        mask = alen;
+    }
+    else if(mask > alen) {
+        return true;
+    }
+    else {
+        for(unsigned i = mask; i < alen; i++)
+            abytes[i >> 3] &= ~(1U << (7U - (i & 7U)));
+    }
+
+    // a zero mask is legal ECS input, but a zero edns_client_mask means
+    //   "no ECS" to gdmaps_lookup(), which then uses dns_source instead,
+    //   so both are set identically as in do_lookup() above.
+    cinfo->edns_client_mask = mask;
+    memcpy(&cinfo->dns_source, &cinfo->edns_client, sizeof(dmn_anysin_t));
+    return false;
+}
+
+F_NONNULL
+static void bulk_read_input(const char* fn, bulk_input_t* input) {
+    FILE* fp = strcmp(fn, "-") ? fopen(fn, "r") : stdin;
+    if(!fp)
+        log_fatal("Cannot open bulk input file '%s': %s", fn, dmn_logf_errno());
+
+    char linebuf[256];
+    unsigned lineno = 0;
+    while(fgets(linebuf, sizeof(linebuf), fp)) {
+        lineno++;
+        linebuf[strcspn(linebuf, " \t\r\n#")] = '\0';
+        if(!linebuf[0])
+            continue;
+        if(input->count == input->alloc) {
+            input->alloc = input->alloc ? input->alloc << 1 : 4096U;
+            input->clients = xrealloc(input->clients, input->alloc * sizeof(client_info_t));
+        }
+        char orig[256];
+        strcpy(orig, linebuf);
+        if(bulk_parse_line(linebuf, &input->clients[input->count]))
+            log_err("Bulk input line %u: cannot parse '%s', skipping", lineno, orig);
+        else
+            input->count++;
+    }
+
+    if(ferror(fp))
+        log_fatal("Error reading bulk input file '%s'", fn);
+    if(fp != stdin)
+        fclose(fp);
+    if(!input->count)
+        log_fatal("No valid addresses in bulk input file '%s'", fn);
+}
+
+F_NONNULL
+static void* bulk_lookup_thread(void* arg) {
+    bulk_slice_t* slice = arg;
+    bulk_results_t* res = slice->results;
+
+    if(slice->lat_ns) {
+        for(unsigned i = slice->start; i < slice->end; i++) {
+            struct timespec t_start, t_end;
+            clock_gettime(CLOCK_MONOTONIC, &t_start);
+            res->dclists[i] = gdmaps_lookup(slice->maps, slice->map_idx, &slice->clients[i], &res->scopes[i]);
+            clock_gettime(CLOCK_MONOTONIC, &t_end);
+            slice->lat_ns[i] = (uint32_t)((t_end.tv_sec - t_start.tv_sec) * 1000000000L
+                + (t_end.tv_nsec - t_start.tv_nsec));
+        }
+    }
+    else {
+        for(unsigned i = slice->start; i < slice->end; i++)
+            res->dclists[i] = gdmaps_lookup(slice->maps, slice->map_idx, &slice->clients[i], &res->scopes[i]);
+    }
+
+    return NULL;
+}
+
+// Runs all of the input through gdmaps_lookup() across nthreads threads,
+//   returning the wall-clock time taken in seconds
+F_NONNULLX(1, 3, 4)
+static double bulk_run_threads(const gdmaps_t* maps, const unsigned map_idx, const bulk_input_t* input, bulk_results_t* results, uint32_t* lat_ns, const unsigned nthreads) {
+    pthread_t threads[nthreads];
+    bulk_slice_t slices[nthreads];
+
+    const unsigned per_thread = input->count / nthreads;
+    struct timespec t_start, t_end;
+    clock_gettime(CLOCK_MONOTONIC, &t_start);
+    for(unsigned i = 0; i < nthreads; i++) {
+        slices[i].maps = maps;
+        slices[i].map_idx = map_idx;
+        slices[i].clients = input->clients;
+        slices[i].results = results;
+        slices[i].lat_ns = lat_ns;
+        slices[i].start = i * per_thread;
+        slices[i].end = (i == nthreads - 1) ? input->count : (i + 1) * per_thread;
+        int pthread_err = pthread_create(&threads[i], NULL, bulk_lookup_thread, &slices[i]);
+        if(pthread_err)
+            log_fatal("pthread_create() failed: %s", dmn_logf_strerror(pthread_err));
+    }
+    for(unsigned i = 0; i < nthreads; i++)
+        pthread_join(threads[i], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t_end);
+
+    return (t_end.tv_sec - t_start.tv_sec)
+        + (t_end.tv_nsec - t_start.tv_nsec) / 1000000000.0;
+}
+
+F_NONNULL F_PURE
+static int cmp_u32(const void* a, const void* b) {
+    const uint32_t x = *(const uint32_t*)a;
+    const uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+F_NONNULL F_PURE
+static uint32_t percentile(const uint32_t* sorted, const unsigned count, const double pct) {
+    unsigned idx = (unsigned)(count * pct / 100.0);
+    if(idx >= count)
+        idx = count - 1;
+    return sorted[idx];
+}
+
+F_NONNULL F_PURE
+static int cmp_dclist_ptr(const void* a, const void* b) {
+    const uintptr_t x = (uintptr_t)*(const uint8_t* const*)a;
+    const uintptr_t y = (uintptr_t)*(const uint8_t* const*)b;
+    return (x > y) - (x < y);
+}
+
+typedef struct {
+    const uint8_t* dclist;
+    unsigned count;
+} dclist_count_t;
+
+F_NONNULL F_PURE
+static int cmp_dclist_count(const void* a, const void* b) {
+    const unsigned x = ((const dclist_count_t*)a)->count;
+    const unsigned y = ((const dclist_count_t*)b)->count;
+    return (x < y) - (x > y); // descending
+}
+
+// Prints lookups/sec, latency percentiles, and the distribution of
+//   result dclists for one set of maps, leaving the results in "results"
+F_NONNULL
+static void bulk_benchmark(const gdmaps_t* maps, const char* desc, const unsigned map_idx, const bulk_input_t* input, bulk_results_t* results, const unsigned nthreads) {
+    const unsigned count = input->count;
+    uint32_t* lat_ns = xmalloc(count * sizeof(uint32_t));
+
+    const double wall = bulk_run_threads(maps, map_idx, input, results, NULL, nthreads);
+    bulk_run_threads(maps, map_idx, input, results, lat_ns, nthreads);
+
+    printf("%s: %u lookups in %.3fs using %u thread(s): %.0f lookups/sec\n",
+        desc, count, wall, nthreads, count / wall);
+
+    qsort(lat_ns, count, sizeof(uint32_t), cmp_u32);
+    static const double pcts[] = { 50.0, 90.0, 99.0, 99.9 };
+    printf("%s: latency ns:", desc);
+    for(unsigned i = 0; i < sizeof(pcts) / sizeof(pcts[0]); i++)
+        printf(" p%g=%" PRIu32, pcts[i], percentile(lat_ns, count, pcts[i]));
+    printf(" max=%" PRIu32 "\n", lat_ns[count - 1]);
+    free(lat_ns);
+
+    // Each unique result dclist has a unique pointer within a given gdmaps,
+    //   so the distribution is counted by sorting a copy of the pointers.
+    const uint8_t** sorted = xmalloc(count * sizeof(uint8_t*));
+    memcpy(sorted, results->dclists, count * sizeof(uint8_t*));
+    qsort(sorted, count, sizeof(uint8_t*), cmp_dclist_ptr);
+    dclist_count_t* dist = xmalloc(count * sizeof(dclist_count_t));
+    unsigned ndist = 0;
+    for(unsigned i = 0; i < count; i++) {
+        if(!ndist || dist[ndist - 1].dclist != sorted[i]) {
+            dist[ndist].dclist = sorted[i];
+            dist[ndist++].count = 0;
+        }
+        dist[ndist - 1].count++;
+    }
+    free(sorted);
+    qsort(dist, ndist, sizeof(dclist_count_t), cmp_dclist_count);
+
+    printf("%s: %u distinct result dclists:\n", desc, ndist);
+    for(unsigned i = 0; i < ndist; i++) {
+        printf("  %10u (%6.2f%%) %s\n", dist[i].count, 100.0 * dist[i].count / count,
+            gdmaps_logf_dclist(maps, map_idx, dist[i].dclist));
+        dmn_fmtbuf_reset();
+    }
+    free(dist);
+}
+
+F_NONNULL
+static int get_map_idx(const gdmaps_t* maps, const char* map_name) {
+    const int rv = gdmaps_name2idx(maps, map_name);
+    if(rv < 0)
+        log_fatal("Mapping name '%s' not found in configuration", map_name);
+    return rv;
+}
+
+F_NONNULLX(1, 2, 4)
+static void do_bulk(const char* infile, const char* map_name, gdmaps_t* cmp_maps, const char* cmp_dir, const unsigned nthreads) {
+    dmn_assert(gdmaps);
+
+    bulk_input_t input = { NULL, 0, 0 };
+    bulk_read_input(infile, &input);
+
+    const unsigned map_idx = (unsigned)get_map_idx(gdmaps, map_name);
+    bulk_results_t results;
+    results.dclists = xmalloc(input.count * sizeof(uint8_t*));
+    results.scopes = xmalloc(input.count * sizeof(unsigned));
+    bulk_benchmark(gdmaps, "main", map_idx, &input, &results, nthreads);
+
+    if(cmp_maps) {
+        const unsigned cmp_idx = (unsigned)get_map_idx(cmp_maps, map_name);
+        bulk_results_t cmp_results;
+        cmp_results.dclists = xmalloc(input.count * sizeof(uint8_t*));
+        cmp_results.scopes = xmalloc(input.count * sizeof(unsigned));
+        bulk_benchmark(cmp_maps, "compare", cmp_idx, &input, &cmp_results, nthreads);
+
+        // Datacenter numbers are translated back to names for comparison,
+        //   in case the two configs order their datacenters differently.
+        unsigned ndiff = 0;
+        for(unsigned i = 0; i < input.count; i++) {
+            const char* a = gdmaps_logf_dclist(gdmaps, map_idx, results.dclists[i]);
+            const char* b = gdmaps_logf_dclist(cmp_maps, cmp_idx, cmp_results.dclists[i]);
+            if(strcmp(a, b) || results.scopes[i] != cmp_results.scopes[i]) {
+                ndiff++;
+                printf("DIFF %s/%u: main => %s (scope %u), compare => %s (scope %u)\n",
+                    dmn_logf_anysin_noport(&input.clients[i].edns_client),
+                    input.clients[i].edns_client_mask,
+                    a, results.scopes[i], b, cmp_results.scopes[i]);
+            }
+            dmn_fmtbuf_reset();
+        }
+        printf("compare: %u of %u lookups differ with config dir '%s'\n",
+            ndiff, input.count, cmp_dir);
+
+        free(cmp_results.dclists);
+        free(cmp_results.scopes);
+    }
+
+    free(results.dclists);
+    free(results.scopes);
+    free(input.clients);
+}
+
 F_NONNULL
 static vscf_data_t* conf_get_maps(vscf_data_t* cfg_root) {
     // plugins stanza
@@ -176,41 +489,84 @@ static gdmaps_t* gdmaps_standalone_init(const char* input_cfgdir) {
     return rv;
 }
 
+// For -C: must be called after gdmaps_standalone_init()
+F_NONNULL
+static gdmaps_t* gdmaps_compare_init(const char* cmp_cfgdir) {
+    vscf_data_t* cfg_root = gdnsd_reinit_cfg_dir(cmp_cfgdir);
+    if(!cfg_root)
+        log_fatal("gdnsd_geoip_test -C requires an actual config file in '%s'", cmp_cfgdir);
+    vscf_data_t* maps_cfg = conf_get_maps(cfg_root);
+    gdmaps_t* rv = gdmaps_new(maps_cfg);
+    vscf_destroy(cfg_root);
+
+    gdmaps_load_databases(rv);
+
+    return rv;
+}
+
 int main(int argc, char* argv[]) {
     const char* input_cfgdir = NULL;
+    const char* cmp_cfgdir = NULL;
+    const char* bulk_file = NULL;
     const char* map_name = NULL;
     const char* ip_arg = NULL;
-
-    switch(argc) {
-        // gdnsd_geoip_test -c x map_name ip
-        case 5:
-            if(strcmp(argv[1], "-c")) usage(argv[0]);
-            input_cfgdir = argv[2];
-            map_name = argv[3];
-            ip_arg = argv[4];
-            break;
-        // gdnsd_geoip_test map_name ip
-        //   -or-
-        // gdnsd_geoip_test -c x
-        case 3:
-            if(!strcmp(argv[1], "-c")) {
-                input_cfgdir = argv[2];
-            }
-            else {
-                map_name = argv[1];
-                ip_arg = argv[2];
+    unsigned nthreads = 1;
+
+    int optchar;
+    while((optchar = getopt(argc, argv, "c:C:b:t:")) != -1) {
+        switch(optchar) {
+            case 'c':
+                input_cfgdir = optarg;
+                break;
+            case 'C':
+                cmp_cfgdir = optarg;
+                break;
+            case 'b':
+                bulk_file = optarg;
+                break;
+            case 't': {
+                char* eptr;
+                unsigned long nthreads_ul = strtoul(optarg, &eptr, 10);
+                if(eptr == optarg || *eptr || !nthreads_ul || nthreads_ul > 1024)
+                    usage(argv[0]);
+                nthreads = (unsigned)nthreads_ul;
+                break;
             }
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    switch(argc - optind) {
+        // gdnsd_geoip_test [-c x] map_name ip
+        case 2:
+            if(bulk_file) usage(argv[0]);
+            map_name = argv[optind];
+            ip_arg = argv[optind + 1];
             break;
-        // no args at all
+        // gdnsd_geoip_test [-c x] -b infile map_name
         case 1:
+            if(!bulk_file) usage(argv[0]);
+            map_name = argv[optind];
+            break;
+        // gdnsd_geoip_test [-c x]
+        case 0:
+            if(bulk_file) usage(argv[0]);
             break;
         default:
             usage(argv[0]);
     }
 
+    if((cmp_cfgdir || nthreads > 1) && !bulk_file)
+        usage(argv[0]);
+
     gdmaps = gdmaps_standalone_init(input_cfgdir);
 
-    if(map_name) {
+    if(bulk_file) {
+        gdmaps_t* cmp_maps = cmp_cfgdir ? gdmaps_compare_init(cmp_cfgdir) : NULL;
+        do_bulk(bulk_file, map_name, cmp_maps, cmp_cfgdir, nthreads);
+    }
+    else if(map_name) {
         dmn_assert(ip_arg);
         do_lookup(map_name, ip_arg);
     }
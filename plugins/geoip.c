@@ -30,6 +30,10 @@
 #include <stdbool.h>
 
 static gdmaps_t* gdmaps;
+static unsigned num_maps = 0;
+
+// per-thread cache of map lookups within one query, one slot per map
+static __thread gdnsd_query_cache_t* map_qcache = NULL;
 
 F_NONNULL
 static unsigned res_get_mapnum(vscf_data_t* res_cfg, const char* res_name) {
@@ -67,6 +71,7 @@ static bool top_config_hook(vscf_data_t* top_config) {
         log_fatal("plugin_geoip: 'maps' stanza must contain one or more maps");
 
     gdmaps = gdmaps_new(maps);
+    num_maps = vscf_hash_get_len(maps);
 
     bool undef_dc_ok = false;
     vscf_data_t* undef_dc_ok_vscf = vscf_hash_get_data_byconstkey(top_config, "undefined_datacenters_ok", true);
@@ -91,16 +96,32 @@ void plugin_geoip_pre_run(void) {
 F_NONNULL
 static const uint8_t* map_get_dclist(const unsigned mapnum, const client_info_t* cinfo, unsigned* scope_out) {
     dmn_assert(gdmaps);
-    return gdmaps_lookup(gdmaps, mapnum, cinfo, scope_out);
+    dmn_assert(map_qcache); // iothread_init
+
+    const uint8_t* dclist = gdnsd_query_cache_get(map_qcache, cinfo, mapnum, scope_out);
+    if(!dclist) {
+        dclist = gdmaps_lookup(gdmaps, mapnum, cinfo, scope_out);
+        gdnsd_query_cache_put(map_qcache, cinfo, mapnum, dclist, *scope_out);
+    }
+    return dclist;
 }
 
 static unsigned map_get_mon_idx(const unsigned mapnum, const unsigned dcnum) {
     return gdmaps_map_mon_idx(gdmaps, mapnum, dcnum);
 }
 
+static unsigned map_get_gen(const unsigned mapnum) {
+    return gdmaps_map_gen(gdmaps, mapnum);
+}
+
 #define PNSTR "geoip"
 #define CB_LOAD_CONFIG plugin_geoip_load_config
 #define CB_MAP plugin_geoip_map_res
 #define CB_RES plugin_geoip_resolve
 #define META_MAP_ADMIN 1
 #include "meta_core.inc"
+
+void plugin_geoip_iothread_init(const unsigned threadnum V_UNUSED) {
+    map_qcache = gdnsd_query_cache_new(num_maps);
+    meta_iothread_init();
+}
@@ -24,6 +24,8 @@
 
 #include <stdbool.h>
 #include <string.h>
+#include <strings.h>
+#include <ctype.h>
 #include <unistd.h>
 #include <netinet/in_systm.h>
 #include <netinet/ip.h>
@@ -36,12 +38,14 @@
 typedef struct {
     const char* name;
     unsigned* ok_codes;
-    char* req_data;
+    char* req_data; // NULL for keepalive w/o vhost, see add_mon_addr
     unsigned req_data_len;
     unsigned num_ok_codes;
     unsigned port;
     unsigned timeout;
     unsigned interval;
+    char* url_path;
+    bool keepalive;
 } http_svc_t;
 
 typedef enum {
@@ -50,6 +54,22 @@ typedef enum {
     HTTP_STATE_READING  // trying to receive the response
 } http_state_t;
 
+// Response framing states, for keepalive connections only.  Without
+//   keepalive, we only ever look at the status line and then close.
+typedef enum {
+    KA_HEADERS = 0, // status line and headers
+    KA_BODY_LEN,    // body delimited by Content-Length
+    KA_BODY_EOF,    // body delimited by connection close
+    KA_CHUNK_SIZE,  // chunk-size line
+    KA_CHUNK_DATA,  // chunk data
+    KA_CHUNK_CRLF,  // line ending after chunk data
+    KA_TRAILER,     // trailer lines after the final chunk
+    KA_DONE
+} ka_state_t;
+
+// Max length of the response headers (and of chunk-size and trailer lines)
+#define KA_BUF_MAX 4096U
+
 typedef struct {
     const char* desc;
     http_svc_t* http_svc;
@@ -64,6 +84,17 @@ typedef struct {
     http_state_t hstate;
     unsigned done;
     bool already_connected;
+    const char* req_data;
+    unsigned req_data_len;
+    ev_tstamp check_start; // for the check latency
+    // the rest is only used with keepalive
+    bool reused; // this check started on a connection from a previous one
+    bool ka_ok; // status code was in ok_codes
+    bool ka_close; // connection can't be reused after this response
+    ka_state_t ka_state;
+    unsigned long ka_left; // remaining body or chunk bytes
+    unsigned ka_buf_len;
+    char* ka_buf;
 } http_events_t;
 
 static unsigned num_http_svcs = 0;
@@ -71,6 +102,9 @@ static unsigned num_mons = 0;
 static http_svc_t* service_types = NULL;
 static http_events_t** mons = NULL;
 
+F_NONNULL
+static bool mon_connect(struct ev_loop* loop, http_events_t* md);
+
 F_NONNULL
 static void mon_interval_cb(struct ev_loop* loop, struct ev_timer* t, const int revents V_UNUSED) {
     dmn_assert(revents == EV_TIMER);
@@ -79,6 +113,16 @@ static void mon_interval_cb(struct ev_loop* loop, struct ev_timer* t, const int
 
     dmn_assert(md);
 
+    // apply the service type's jitter, if any, to the next regular
+    //   check (the initial round is a single-shot timer)
+    if(t->repeat > 0.0) {
+        const double next = gdnsd_mon_get_next_delay(md->idx);
+        if(next > 0.0) {
+            t->repeat = next;
+            ev_timer_again(loop, t);
+        }
+    }
+
     if(md->hstate != HTTP_STATE_WAITING) {
         log_warn("plugin_http_status: A monitoring request attempt seems to have "
             "lasted longer than the monitoring interval. "
@@ -87,12 +131,40 @@ static void mon_interval_cb(struct ev_loop* loop, struct ev_timer* t, const int
         return;
     }
 
-    dmn_assert(md->sock == -1);
+    dmn_assert(md->sock == -1 || md->http_svc->keepalive);
     dmn_assert(!ev_is_active(md->read_watcher));
     dmn_assert(!ev_is_active(md->write_watcher));
     dmn_assert(!ev_is_active(md->timeout_watcher) && !ev_is_pending(md->timeout_watcher));
 
     log_debug("plugin_http_status: Starting state poll of %s", md->desc);
+    md->check_start = ev_now(loop);
+
+    if(md->sock != -1) {
+        // connection kept alive from the previous check
+        md->reused = true;
+        md->already_connected = true;
+        md->hstate = HTTP_STATE_WRITING;
+        md->done = 0;
+        ev_io_set(md->write_watcher, md->sock, EV_WRITE);
+        ev_io_start(loop, md->write_watcher);
+    }
+    else if(!mon_connect(loop, md)) {
+        log_debug("plugin_http_status: State poll of %s failed very quickly", md->desc);
+        md->hstate = HTTP_STATE_WAITING;
+        gdnsd_mon_state_updater_timed(md->idx, false, ev_now(loop) - md->check_start);
+        return;
+    }
+
+    ev_timer_set(md->timeout_watcher, md->http_svc->timeout, 0);
+    ev_timer_start(loop, md->timeout_watcher);
+}
+
+// Starts a fresh connection, returning false on immediate failure
+F_NONNULL
+static bool mon_connect(struct ev_loop* loop, http_events_t* md) {
+    dmn_assert(md->sock == -1);
+
+    md->reused = false;
 
     do {
         const bool isv6 = md->addr.sa.sa_family == AF_INET6;
@@ -134,15 +206,36 @@ static void mon_interval_cb(struct ev_loop* loop, struct ev_timer* t, const int
         md->done = 0;
         ev_io_set(md->write_watcher, sock, EV_WRITE);
         ev_io_start(loop, md->write_watcher);
-        ev_timer_set(md->timeout_watcher, md->http_svc->timeout, 0);
-        ev_timer_start(loop, md->timeout_watcher);
-        return;
+        return true;
     } while(0);
 
     // This is only reachable via "break"'s above, which indicate an immediate failure
-    log_debug("plugin_http_status: State poll of %s failed very quickly", md->desc);
-    md->hstate = HTTP_STATE_WAITING;
-    gdnsd_mon_state_updater(md->idx, false);
+    return false;
+}
+
+// With keepalive, a failure on a connection reused from a previous check
+//   (e.g. because the server closed it while idle) doesn't count against
+//   the service right away.  It's retried once on a fresh connection,
+//   within the same timeout.  Returns true if it has dealt with the
+//   failure, which is always the case for reused connections.
+F_NONNULL
+static bool mon_retry(struct ev_loop* loop, http_events_t* md) {
+    if(!md->reused)
+        return false;
+
+    log_debug("plugin_http_status: Reused connection for %s failed, retrying with a new connection", md->desc);
+    ev_io_stop(loop, md->read_watcher);
+    ev_io_stop(loop, md->write_watcher);
+    close(md->sock);
+    md->sock = -1;
+
+    if(!mon_connect(loop, md)) {
+        log_debug("plugin_http_status: State poll of %s failed very quickly", md->desc);
+        ev_timer_stop(loop, md->timeout_watcher);
+        md->hstate = HTTP_STATE_WAITING;
+        gdnsd_mon_state_updater_timed(md->idx, false, ev_now(loop) - md->check_start);
+    }
+    return true;
 }
 
 F_NONNULL
@@ -182,17 +275,17 @@ static void mon_write_cb(struct ev_loop* loop, struct ev_io* io, const int reven
             ev_io_stop(loop, md->write_watcher);
             ev_timer_stop(loop, md->timeout_watcher);
             md->hstate = HTTP_STATE_WAITING;
-            gdnsd_mon_state_updater(md->idx, false);
+            gdnsd_mon_state_updater_timed(md->idx, false, ev_now(loop) - md->check_start);
             return;
         }
         md->already_connected = true;
     }
 
-    dmn_assert(md->done < md->http_svc->req_data_len);
-    const unsigned to_send = md->http_svc->req_data_len - md->done;
+    dmn_assert(md->done < md->req_data_len);
+    const unsigned to_send = md->req_data_len - md->done;
     dmn_assert(to_send > 0);
 
-    const ssize_t send_rv = send(sock, md->http_svc->req_data + md->done, to_send, 0);
+    const ssize_t send_rv = send(sock, md->req_data + md->done, to_send, MSG_NOSIGNAL);
     if(unlikely(send_rv < 0)) {
         switch(errno) {
             case EAGAIN:
@@ -211,13 +304,15 @@ static void mon_write_cb(struct ev_loop* loop, struct ev_io* io, const int reven
             default:
                 log_err("plugin_http_status: send() to monitoring socket failed, possible local problem: %s", dmn_logf_errno());
         }
+        if(mon_retry(loop, md))
+            return;
         shutdown(sock, SHUT_RDWR);
         close(sock);
         md->sock = -1;
         ev_io_stop(loop, md->write_watcher);
         ev_timer_stop(loop, md->timeout_watcher);
         md->hstate = HTTP_STATE_WAITING;
-        gdnsd_mon_state_updater(md->idx, false);
+        gdnsd_mon_state_updater_timed(md->idx, false, ev_now(loop) - md->check_start);
         return;
     }
 
@@ -231,11 +326,249 @@ static void mon_write_cb(struct ev_loop* loop, struct ev_io* io, const int reven
 
     md->done = 0;
     md->hstate = HTTP_STATE_READING;
+    md->ka_state = KA_HEADERS;
+    md->ka_buf_len = 0;
     ev_io_stop(loop, md->write_watcher);
     ev_io_set(md->read_watcher, sock, EV_READ);
     ev_io_start(loop, md->read_watcher);
 }
 
+// Handles the end of the status line and headers in md->ka_buf, which
+//   must already be NUL-terminated.  Returns false if they're invalid.
+F_NONNULL
+static bool ka_headers_done(http_events_t* md) {
+    char* buf = md->ka_buf;
+
+    if(strncmp(buf, "HTTP/1.", 7) || (buf[7] != '0' && buf[7] != '1') || buf[8] != ' '
+        || !isdigit((unsigned char)buf[9]) || !isdigit((unsigned char)buf[10])
+        || !isdigit((unsigned char)buf[11]) || !isspace((unsigned char)buf[12]))
+        return false;
+
+    const unsigned code = (unsigned)(buf[9] - '0') * 100U
+        + (unsigned)(buf[10] - '0') * 10U + (unsigned)(buf[11] - '0');
+
+    // Interim 1xx responses are followed by the real one
+    if(code < 200U) {
+        md->ka_buf_len = 0;
+        return true;
+    }
+
+    md->ka_ok = false;
+    for(unsigned i = 0; i < md->http_svc->num_ok_codes; i++) {
+        if(code == md->http_svc->ok_codes[i]) {
+            md->ka_ok = true;
+            break;
+        }
+    }
+
+    md->ka_close = (buf[7] == '0');
+    bool chunked = false;
+    bool have_len = false;
+    unsigned long content_len = 0;
+
+    char* line = strchr(buf, '\n');
+    while(line && *++line) {
+        char* eol = strchr(line, '\n');
+        if(!eol)
+            break;
+        *eol = '\0';
+        if(eol > line && eol[-1] == '\r')
+            eol[-1] = '\0';
+        char* colon = strchr(line, ':');
+        if(colon) {
+            *colon = '\0';
+            char* val = colon + 1;
+            while(*val == ' ' || *val == '\t')
+                val++;
+            char* val_end = val + strlen(val);
+            while(val_end > val && (val_end[-1] == ' ' || val_end[-1] == '\t'))
+                *--val_end = '\0';
+            const unsigned val_len = (unsigned)(val_end - val);
+
+            if(!strcasecmp(line, "Content-Length")) {
+                char* num_end;
+                errno = 0;
+                content_len = strtoul(val, &num_end, 10);
+                if(errno || num_end == val || *num_end || *val == '-')
+                    return false;
+                have_len = true;
+            }
+            else if(!strcasecmp(line, "Transfer-Encoding")) {
+                chunked = (val_len >= 7U && !strcasecmp(val_end - 7, "chunked"));
+            }
+            else if(!strcasecmp(line, "Connection")) {
+                if(!strcasecmp(val, "close"))
+                    md->ka_close = true;
+                else if(!strcasecmp(val, "keep-alive"))
+                    md->ka_close = false;
+            }
+        }
+        line = eol;
+    }
+
+    md->ka_buf_len = 0;
+    if(code == 204U || code == 304U) {
+        md->ka_state = KA_DONE;
+    }
+    else if(chunked) {
+        md->ka_state = KA_CHUNK_SIZE;
+    }
+    else if(have_len) {
+        md->ka_left = content_len;
+        md->ka_state = content_len ? KA_BODY_LEN : KA_DONE;
+    }
+    else {
+        md->ka_state = KA_BODY_EOF;
+        md->ka_close = true;
+    }
+
+    return true;
+}
+
+// Appends one byte to md->ka_buf, returning true if that completed a line.
+//   *overflow is set if the buffer is full.
+F_NONNULL
+static bool ka_buf_add(http_events_t* md, const char c, bool* overflow) {
+    if(md->ka_buf_len == KA_BUF_MAX - 1U) {
+        *overflow = true;
+        return false;
+    }
+    md->ka_buf[md->ka_buf_len++] = c;
+    md->ka_buf[md->ka_buf_len] = '\0';
+    return c == '\n';
+}
+
+// Feeds received response data through the framing state machine.
+//   Returns -1 if the response is invalid, 1 if it's complete, and
+//   0 if more data is needed.
+F_NONNULL
+static int ka_parse(http_events_t* md, const char* data, unsigned len) {
+    bool overflow = false;
+
+    while(len) {
+        switch(md->ka_state) {
+            case KA_HEADERS:
+                if(ka_buf_add(md, *data, &overflow)) {
+                    const unsigned l = md->ka_buf_len;
+                    // blank line, with or without CR, ends the headers
+                    if((l >= 2U && md->ka_buf[l - 2U] == '\n')
+                        || (l >= 3U && md->ka_buf[l - 2U] == '\r' && md->ka_buf[l - 3U] == '\n'))
+                        if(!ka_headers_done(md))
+                            return -1;
+                }
+                data++; len--;
+                break;
+            case KA_BODY_LEN:
+            case KA_CHUNK_DATA: {
+                const unsigned chunk = md->ka_left < len ? (unsigned)md->ka_left : len;
+                md->ka_left -= chunk;
+                data += chunk; len -= chunk;
+                if(!md->ka_left)
+                    md->ka_state = (md->ka_state == KA_BODY_LEN) ? KA_DONE : KA_CHUNK_CRLF;
+                break;
+            }
+            case KA_BODY_EOF:
+                return 0;
+            case KA_CHUNK_SIZE:
+                if(ka_buf_add(md, *data, &overflow)) {
+                    char* size_end;
+                    errno = 0;
+                    md->ka_left = strtoul(md->ka_buf, &size_end, 16);
+                    if(errno || size_end == md->ka_buf || !(*size_end == ';' || isspace((unsigned char)*size_end)))
+                        return -1;
+                    md->ka_buf_len = 0;
+                    md->ka_state = md->ka_left ? KA_CHUNK_DATA : KA_TRAILER;
+                }
+                data++; len--;
+                break;
+            case KA_CHUNK_CRLF:
+                if(*data == '\n')
+                    md->ka_state = KA_CHUNK_SIZE;
+                else if(*data != '\r')
+                    return -1;
+                data++; len--;
+                break;
+            case KA_TRAILER:
+                if(ka_buf_add(md, *data, &overflow)) {
+                    if(md->ka_buf[0] == '\n' || md->ka_buf[0] == '\r')
+                        md->ka_state = KA_DONE;
+                    md->ka_buf_len = 0;
+                }
+                data++; len--;
+                break;
+            case KA_DONE:
+                // unexpected extra data, don't trust the connection further
+                md->ka_close = true;
+                return 1;
+            default:
+                dmn_assert(0);
+        }
+        if(overflow)
+            return -1;
+    }
+
+    return md->ka_state == KA_DONE ? 1 : 0;
+}
+
+F_NONNULL
+static void mon_ka_finish(struct ev_loop* loop, http_events_t* md, const bool final_status, const bool keep) {
+    log_debug("plugin_http_status: State poll of %s %s", md->desc, final_status ? "succeeded" : "failed");
+    ev_io_stop(loop, md->read_watcher);
+    ev_timer_stop(loop, md->timeout_watcher);
+    if(!keep) {
+        shutdown(md->sock, SHUT_RDWR);
+        close(md->sock);
+        md->sock = -1;
+    }
+    md->hstate = HTTP_STATE_WAITING;
+    gdnsd_mon_state_updater_timed(md->idx, final_status, ev_now(loop) - md->check_start);
+}
+
+// The keepalive version of the read callback, which has to consume
+//   the whole response to leave the connection usable for the next check
+F_NONNULL
+static void mon_read_ka(struct ev_loop* loop, http_events_t* md) {
+    char buf[4096];
+    const ssize_t recv_rv = recv(md->sock, buf, sizeof(buf), 0);
+    if(recv_rv < 0) {
+        switch(errno) {
+            case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+            case EWOULDBLOCK:
+#endif
+            case EINTR:
+                return;
+            case ETIMEDOUT:
+            case ENOTCONN:
+            case ECONNRESET:
+            case EPIPE:
+                break;
+            default:
+                log_err("plugin_http_status: read() from monitoring socket failed, possible local problem: %s", dmn_logf_errno());
+        }
+        if(!mon_retry(loop, md))
+            mon_ka_finish(loop, md, false, false);
+        return;
+    }
+
+    if(!recv_rv) {
+        if(md->ka_state == KA_BODY_EOF)
+            mon_ka_finish(loop, md, md->ka_ok, false);
+        else if(!mon_retry(loop, md))
+            mon_ka_finish(loop, md, false, false);
+        return;
+    }
+
+    const int parse_rv = ka_parse(md, buf, (unsigned)recv_rv);
+    if(parse_rv < 0) {
+        log_debug("plugin_http_status: Invalid HTTP response from %s", md->desc);
+        mon_ka_finish(loop, md, false, false);
+    }
+    else if(parse_rv > 0) {
+        mon_ka_finish(loop, md, md->ka_ok, !md->ka_close);
+    }
+}
+
 F_NONNULL
 static void mon_read_cb(struct ev_loop* loop, struct ev_io* io, const int revents V_UNUSED) {
     dmn_assert(revents == EV_READ);
@@ -248,6 +581,11 @@ static void mon_read_cb(struct ev_loop* loop, struct ev_io* io, const int revent
     dmn_assert(!ev_is_active(md->write_watcher));
     dmn_assert(md->sock > -1);
 
+    if(md->http_svc->keepalive) {
+        mon_read_ka(loop, md);
+        return;
+    }
+
     bool final_status = false;
     const unsigned to_recv = 13U - md->done;
     const ssize_t recv_rv = recv(md->sock, md->res_buf + md->done, to_recv, 0);
@@ -297,7 +635,7 @@ static void mon_read_cb(struct ev_loop* loop, struct ev_io* io, const int revent
     ev_io_stop(loop, md->read_watcher);
     ev_timer_stop(loop, md->timeout_watcher);
     md->hstate = HTTP_STATE_WAITING;
-    gdnsd_mon_state_updater(md->idx, final_status);
+    gdnsd_mon_state_updater_timed(md->idx, final_status, ev_now(loop) - md->check_start);
 }
 
 F_NONNULL
@@ -320,7 +658,7 @@ static void mon_timeout_cb(struct ev_loop* loop, struct ev_timer* t, const int r
     close(md->sock);
     md->sock = -1;
     md->hstate = HTTP_STATE_WAITING;
-    gdnsd_mon_state_updater(md->idx, false);
+    gdnsd_mon_state_updater_timed(md->idx, false, ev_now(loop) - md->check_start);
 }
 
 #define SVC_OPT_UINT(_hash, _typnam, _loc, _min, _max) \
@@ -347,6 +685,15 @@ static void mon_timeout_cb(struct ev_loop* loop, struct ev_timer* t, const int r
         } \
     } while(0)
 
+#define SVC_OPT_BOOL(_hash, _typnam, _loc) \
+    do { \
+        vscf_data_t* _data = vscf_hash_get_data_byconstkey(_hash, #_loc, true); \
+        if(_data) { \
+            if(!vscf_is_simple(_data) || !vscf_simple_get_as_bool(_data, &_loc)) \
+                log_fatal("plugin_http_status: Service type '%s': option '%s': Value must be 'true' or 'false'", _typnam, #_loc); \
+        } \
+    } while(0)
+
 // _LEN sizes below are without trailing NUL, and without
 //   and printf templates (%s) either.
 
@@ -356,10 +703,29 @@ static const unsigned REQ_TMPL_LEN = sizeof(REQ_TMPL) - 2 - 1;
 static const char REQ_TMPL_VHOST[] = "GET %s HTTP/1.0\r\nHost: %s\r\nUser-Agent: gdnsd-monitor\r\n\r\n";
 static const unsigned REQ_TMPL_VHOST_LEN = sizeof(REQ_TMPL_VHOST) - 2 - 2 - 1;
 
+// HTTP/1.1 requires Host, and defaults to persistent connections
+static const char REQ_TMPL_KA[] = "GET %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: gdnsd-monitor\r\n\r\n";
+static const unsigned REQ_TMPL_KA_LEN = sizeof(REQ_TMPL_KA) - 2 - 2 - 1;
+
+F_NONNULL
+static char* make_req_ka(const char* url_path, const char* host, unsigned* len_out) {
+    const unsigned len = REQ_TMPL_KA_LEN + strlen(url_path) + strlen(host);
+    char* req = xmalloc(len + 1);
+    snprintf(req, len + 1, REQ_TMPL_KA, url_path, host);
+    *len_out = len;
+    return req;
+}
+
 F_NONNULLX(1, 2)
 static void make_req_data(http_svc_t* s, const char* url_path, const char* vhost) {
     const unsigned url_len = strlen(url_path);
-    if(vhost) {
+    if(s->keepalive) {
+        // Without a vhost, the Host header is per-address, see add_mon_addr
+        s->url_path = strdup(url_path);
+        if(vhost)
+            s->req_data = make_req_ka(url_path, vhost, &s->req_data_len);
+    }
+    else if(vhost) {
         s->req_data_len = REQ_TMPL_VHOST_LEN + url_len + strlen(vhost);
         s->req_data = xmalloc(s->req_data_len + 1);
         snprintf(s->req_data, s->req_data_len + 1, REQ_TMPL_VHOST, url_path, vhost);
@@ -376,6 +742,7 @@ void plugin_http_status_add_svctype(const char* name, vscf_data_t* svc_cfg, cons
     const char* url_path = "/";
     const char* vhost = NULL;
     unsigned port = 80;
+    bool keepalive = false;
 
     service_types = xrealloc(service_types, (num_http_svcs + 1) * sizeof(http_svc_t));
     http_svc_t* this_svc = &service_types[num_http_svcs++];
@@ -388,6 +755,7 @@ void plugin_http_status_add_svctype(const char* name, vscf_data_t* svc_cfg, cons
     SVC_OPT_STR(svc_cfg, name, url_path);
     SVC_OPT_STR(svc_cfg, name, vhost);
     SVC_OPT_UINT(svc_cfg, name, port, 1LU, 65534LU);
+    SVC_OPT_BOOL(svc_cfg, name, keepalive);
     vscf_data_t* ok_codes_cfg = vscf_hash_get_data_byconstkey(svc_cfg, "ok_codes", true);
     if(ok_codes_cfg) {
         ok_codes_set = true;
@@ -411,6 +779,9 @@ void plugin_http_status_add_svctype(const char* name, vscf_data_t* svc_cfg, cons
         this_svc->ok_codes[0] = 200LU;
     }
 
+    this_svc->keepalive = keepalive;
+    this_svc->url_path = NULL;
+    this_svc->req_data = NULL;
     make_req_data(this_svc, url_path, vhost);
     this_svc->port = port;
     this_svc->timeout = timeout;
@@ -440,6 +811,20 @@ void plugin_http_status_add_mon_addr(const char* desc, const char* svc_name, con
         this_mon->addr.sin6.sin6_port = htons(this_mon->http_svc->port);
     }
 
+    if(this_mon->http_svc->req_data) {
+        this_mon->req_data = this_mon->http_svc->req_data;
+        this_mon->req_data_len = this_mon->http_svc->req_data_len;
+    }
+    else {
+        dmn_assert(this_mon->http_svc->keepalive);
+        char host[DMN_ANYSIN_MAXSTR];
+        dmn_anysin2str(&this_mon->addr, host);
+        this_mon->req_data = make_req_ka(this_mon->http_svc->url_path, host, &this_mon->req_data_len);
+    }
+
+    if(this_mon->http_svc->keepalive)
+        this_mon->ka_buf = xmalloc(KA_BUF_MAX);
+
     this_mon->hstate = HTTP_STATE_WAITING;
     this_mon->sock = -1;
 
@@ -472,14 +857,14 @@ void plugin_http_status_init_monitors(struct ev_loop* mon_loop) {
     }
 }
 
-void plugin_http_status_start_monitors(struct ev_loop* mon_loop) {
+void plugin_http_status_start_monitors(struct ev_loop* mon_loop V_UNUSED) {
     for(unsigned i = 0; i < num_mons; i++) {
         http_events_t* mon = mons[i];
-        dmn_assert(mon->sock == -1);
+        // an idle keepalive connection from the initial round may remain
+        dmn_assert(mon->sock == -1 || mon->http_svc->keepalive);
         const unsigned ival = mon->http_svc->interval;
-        const double stagger = (((double)i) / ((double)num_mons)) * ((double)ival);
         ev_timer* ival_watcher = mon->interval_watcher;
-        ev_timer_set(ival_watcher, stagger, ival);
-        ev_timer_start(mon_loop, ival_watcher);
+        ev_timer_set(ival_watcher, gdnsd_mon_get_start_delay(mon->idx), ival);
+        ev_timer_start(gdnsd_mon_get_loop(mon->idx), ival_watcher);
     }
 }
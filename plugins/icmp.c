@@ -0,0 +1,485 @@
+/* Copyright © 2012 Brandon L Black <blblack@gmail.com>
+ *
+ * This file is part of gdnsd.
+ *
+ * gdnsd is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gdnsd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gdnsd.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Structurally this follows dns_query.c: the echo requests for all
+//   monitors of an address family share a single ICMP socket, and
+//   replies are matched up with monitors by their sequence number.
+// Unprivileged "ping" sockets (SOCK_DGRAM with IPPROTO_ICMP or
+//   IPPROTO_ICMPV6) are used if the system allows them, otherwise raw
+//   sockets.  The sockets are opened while loading the configuration,
+//   before the daemon drops privileges, so that raw sockets work when
+//   the daemon is started as root.  Failing to open them only becomes
+//   fatal when monitoring is initialized, so that configuration-only
+//   runs such as "checkconf" don't need any permissions for them.
+
+#include <config.h>
+
+#define GDNSD_PLUGIN_NAME icmp
+#include <gdnsd/plugin.h>
+
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/icmp6.h>
+#include <fcntl.h>
+
+#define ICMP_HDR_LEN 8U
+#define ICMP_COOKIE_LEN 4U
+#define ICMP_PKT_LEN (ICMP_HDR_LEN + ICMP_COOKIE_LEN + 12U)
+#define ICMP4_ECHO_REQUEST 8U
+#define ICMP4_ECHO_REPLY 0U
+#define ICMP6_ECHO_REQUEST_TYPE 128U
+#define ICMP6_ECHO_REPLY_TYPE 129U
+#define NUM_SEQS 65536U
+
+// fills the rest of the payload after the cookie
+static const uint8_t payload_fill[ICMP_PKT_LEN - ICMP_HDR_LEN - ICMP_COOKIE_LEN] = "gdnsd-icmp!";
+
+typedef struct {
+    const char* name;
+    unsigned timeout;
+    unsigned interval;
+} icmp_svc_t;
+
+// One of these per address family
+typedef struct {
+    int fd;
+    bool isv6;
+    bool raw; // raw socket, as opposed to a ping socket
+    bool tried; // opening it was attempted at config load
+    unsigned ident; // echo identifier (ping sockets have their own)
+    int dgram_errno; // if both attempts failed, why
+    int raw_errno;
+} icmp_sock_t;
+
+typedef struct {
+    const char* desc;
+    icmp_svc_t* icmp_svc;
+    icmp_sock_t* sock;
+    ev_timer* timeout_watcher;
+    ev_timer* interval_watcher;
+    dmn_anysin_t addr;
+    unsigned idx;
+    unsigned seq;
+    uint8_t cookie[ICMP_COOKIE_LEN];
+    bool in_flight;
+    ev_tstamp check_start; // for the check latency
+    bool seen_once; // has a result from the initial round
+} icmp_events_t;
+
+static unsigned num_icmp_svcs = 0;
+static unsigned num_mons = 0;
+static icmp_svc_t* service_types = NULL;
+static icmp_events_t** mons = NULL;
+
+static icmp_sock_t sock_v4 = { -1, false, false, false, 0, 0, 0 };
+static icmp_sock_t sock_v6 = { -1, true, false, false, 0, 0, 0 };
+static ev_io* sock_watcher_v4 = NULL;
+static ev_io* sock_watcher_v6 = NULL;
+
+// As with dns_query, the socket read watchers would keep the initial
+//   round's loop running forever, so they're stopped once every monitor
+//   has its first result, and restarted by plugin_icmp_start_monitors().
+static bool init_phase = true;
+static unsigned init_phase_count = 0;
+
+// in-flight checks, indexed by sequence number
+static icmp_events_t** pending = NULL;
+static unsigned num_pending = 0;
+static gdnsd_rstate32_t* rstate = NULL;
+
+F_NONNULL
+static bool seq_alloc(icmp_events_t* md) {
+    if(num_pending == NUM_SEQS)
+        return false;
+    const uint32_t rval = gdnsd_rand32_get(rstate);
+    unsigned seq = rval & (NUM_SEQS - 1U);
+    while(pending[seq])
+        seq = (seq + 1U) & (NUM_SEQS - 1U);
+    pending[seq] = md;
+    md->seq = seq;
+    num_pending++;
+    return true;
+}
+
+F_NONNULL
+static void seq_free(icmp_events_t* md) {
+    dmn_assert(pending[md->seq] == md);
+    pending[md->seq] = NULL;
+    num_pending--;
+}
+
+F_NONNULL
+static void sock_watchers_stop(struct ev_loop* loop) {
+    if(sock_watcher_v4)
+        ev_io_stop(loop, sock_watcher_v4);
+    if(sock_watcher_v6)
+        ev_io_stop(loop, sock_watcher_v6);
+}
+
+F_NONNULL
+static void mon_result(struct ev_loop* loop, icmp_events_t* md, const bool success) {
+    gdnsd_mon_state_updater_timed(md->idx, success, ev_now(loop) - md->check_start);
+    if(init_phase && !md->seen_once) {
+        md->seen_once = true;
+        if(++init_phase_count == num_mons)
+            sock_watchers_stop(loop);
+    }
+}
+
+// errno values from non-blocking socket calls which just mean "later"
+F_CONST
+static bool errno_is_retry(const int err) {
+    switch(err) {
+        case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+        case EWOULDBLOCK:
+#endif
+        case EINTR:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Compares addresses only, as there are no ports here
+F_NONNULL F_PURE
+static bool addr_matches(const dmn_anysin_t* a, const dmn_anysin_t* b) {
+    if(a->sa.sa_family != b->sa.sa_family)
+        return false;
+    if(a->sa.sa_family == AF_INET)
+        return a->sin.sin_addr.s_addr == b->sin.sin_addr.s_addr;
+    return !memcmp(&a->sin6.sin6_addr, &b->sin6.sin6_addr, sizeof(struct in6_addr));
+}
+
+// The standard internet checksum, which we have to provide for ICMP
+//   over IPv4 (the kernel does it for ICMPv6 in all cases)
+F_NONNULL F_PURE
+static unsigned icmp4_cksum(const uint8_t* data, const unsigned len) {
+    uint32_t sum = 0;
+    for(unsigned i = 0; i + 1U < len; i += 2U)
+        sum += ((uint32_t)data[i] << 8) | data[i + 1U];
+    if(len & 1U)
+        sum += (uint32_t)data[len - 1U] << 8;
+    while(sum >> 16)
+        sum = (sum & 0xFFFFU) + (sum >> 16);
+    return ~sum & 0xFFFFU;
+}
+
+F_NONNULL
+static void mon_finish(struct ev_loop* loop, icmp_events_t* md, const bool success) {
+    dmn_assert(md->in_flight);
+
+    ev_timer_stop(loop, md->timeout_watcher);
+    seq_free(md);
+    md->in_flight = false;
+
+    log_debug("plugin_icmp: State poll of %s %s", md->desc, success ? "succeeded" : "failed");
+    mon_result(loop, md, success);
+}
+
+F_NONNULL
+static void icmp_read_cb(struct ev_loop* loop, struct ev_io* io, const int revents V_UNUSED) {
+    dmn_assert(revents == EV_READ);
+
+    const icmp_sock_t* isock = io->data;
+    const unsigned reply_type = isock->isv6 ? ICMP6_ECHO_REPLY_TYPE : ICMP4_ECHO_REPLY;
+
+    // we're always in the one monitoring thread
+    static uint8_t buf[65536];
+
+    while(1) {
+        dmn_anysin_t src;
+        src.len = DMN_ANYSIN_MAXLEN;
+        const ssize_t recv_rv = recvfrom(io->fd, buf, sizeof(buf), 0, &src.sa, &src.len);
+        if(recv_rv < 0) {
+            if(!errno_is_retry(errno))
+                log_err("plugin_icmp: recvfrom() on ICMP monitoring socket failed: %s", dmn_logf_errno());
+            break;
+        }
+
+        // raw IPv4 sockets deliver the IP header as well
+        const uint8_t* pkt = buf;
+        unsigned len = (unsigned)recv_rv;
+        if(isock->raw && !isock->isv6) {
+            if(len < 20U)
+                continue;
+            const unsigned ihl = (buf[0] & 0x0FU) << 2;
+            if(len < ihl)
+                continue;
+            pkt += ihl;
+            len -= ihl;
+        }
+
+        // Raw sockets see all echo replies (and for IPv4, all ICMP
+        //   traffic), not just the ones to our own identifier, and
+        //   anything we're no longer waiting on is ignored as well
+        if(len < ICMP_PKT_LEN || pkt[0] != reply_type)
+            continue;
+        if(isock->raw && ((((unsigned)pkt[4] << 8) | pkt[5]) != isock->ident))
+            continue;
+        icmp_events_t* md = pending[((unsigned)pkt[6] << 8) | pkt[7]];
+        if(!md || md->sock != isock || !addr_matches(&src, &md->addr)
+            || memcmp(&pkt[ICMP_HDR_LEN], md->cookie, ICMP_COOKIE_LEN))
+            continue;
+
+        mon_finish(loop, md, true);
+    }
+}
+
+F_NONNULL
+static bool icmp_send(icmp_events_t* md) {
+    const icmp_sock_t* isock = md->sock;
+    dmn_assert(isock->fd > -1);
+
+    const uint32_t cookie = gdnsd_rand32_get(rstate);
+    memcpy(md->cookie, &cookie, ICMP_COOKIE_LEN);
+
+    uint8_t pkt[ICMP_PKT_LEN];
+    pkt[0] = (uint8_t)(isock->isv6 ? ICMP6_ECHO_REQUEST_TYPE : ICMP4_ECHO_REQUEST);
+    pkt[1] = 0; // code
+    pkt[2] = pkt[3] = 0; // checksum
+    pkt[4] = (uint8_t)(isock->ident >> 8);
+    pkt[5] = (uint8_t)(isock->ident & 0xFF);
+    pkt[6] = (uint8_t)(md->seq >> 8);
+    pkt[7] = (uint8_t)(md->seq & 0xFF);
+    memcpy(&pkt[ICMP_HDR_LEN], md->cookie, ICMP_COOKIE_LEN);
+    memcpy(&pkt[ICMP_HDR_LEN + ICMP_COOKIE_LEN], payload_fill, sizeof(payload_fill));
+    if(!isock->isv6) {
+        const unsigned cksum = icmp4_cksum(pkt, ICMP_PKT_LEN);
+        pkt[2] = (uint8_t)(cksum >> 8);
+        pkt[3] = (uint8_t)(cksum & 0xFF);
+    }
+
+    const ssize_t send_rv = sendto(isock->fd, pkt, ICMP_PKT_LEN, 0, &md->addr.sa, md->addr.len);
+    if(send_rv != (ssize_t)ICMP_PKT_LEN) {
+        log_debug("plugin_icmp: sendto() for %s failed: %s", md->desc, dmn_logf_errno());
+        return false;
+    }
+    return true;
+}
+
+F_NONNULL
+static void mon_interval_cb(struct ev_loop* loop, struct ev_timer* t, const int revents V_UNUSED) {
+    dmn_assert(revents == EV_TIMER);
+
+    icmp_events_t* md = t->data;
+
+    dmn_assert(md);
+
+    // apply the service type's jitter, if any, to the next regular
+    //   check (the initial round is a single-shot timer)
+    if(t->repeat > 0.0) {
+        const double next = gdnsd_mon_get_next_delay(md->idx);
+        if(next > 0.0) {
+            t->repeat = next;
+            ev_timer_again(loop, t);
+        }
+    }
+
+    if(md->in_flight) {
+        log_warn("plugin_icmp: A monitoring request attempt seems to have "
+            "lasted longer than the monitoring interval. "
+            "Skipping this round of monitoring - are you "
+            "starved for CPU time?");
+        return;
+    }
+
+    dmn_assert(!ev_is_active(md->timeout_watcher) && !ev_is_pending(md->timeout_watcher));
+
+    log_debug("plugin_icmp: Starting state poll of %s", md->desc);
+    md->check_start = ev_now(loop);
+
+    if(!seq_alloc(md)) {
+        log_err("plugin_icmp: Too many outstanding echo requests to check %s", md->desc);
+        mon_result(loop, md, false);
+        return;
+    }
+
+    if(!icmp_send(md)) {
+        seq_free(md);
+        mon_result(loop, md, false);
+        return;
+    }
+
+    md->in_flight = true;
+    ev_timer_set(md->timeout_watcher, md->icmp_svc->timeout, 0);
+    ev_timer_start(loop, md->timeout_watcher);
+}
+
+F_NONNULL
+static void mon_timeout_cb(struct ev_loop* loop, struct ev_timer* t, const int revents V_UNUSED) {
+    dmn_assert(revents == EV_TIMER);
+
+    icmp_events_t* md = t->data;
+
+    dmn_assert(md);
+    dmn_assert(md->in_flight);
+
+    log_debug("plugin_icmp: State poll of %s timed out", md->desc);
+    mon_finish(loop, md, false);
+}
+
+// Opens the socket for one address family, preferring a ping socket.
+//   If neither kind can be created, the reasons are saved for
+//   plugin_icmp_init_monitors() to fail on.
+F_NONNULL
+static void icmp_sock_open(icmp_sock_t* isock) {
+    dmn_assert(isock->fd == -1);
+    dmn_assert(!isock->tried);
+    isock->tried = true;
+
+    const int pf = isock->isv6 ? PF_INET6 : PF_INET;
+    const int proto = isock->isv6 ? IPPROTO_ICMPV6 : IPPROTO_ICMP;
+    const char* fam = isock->isv6 ? "ICMPv6" : "ICMP";
+
+    int fd = socket(pf, SOCK_DGRAM, proto);
+    if(fd == -1) {
+        const int dgram_errno = errno;
+        fd = socket(pf, SOCK_RAW, proto);
+        if(fd == -1) {
+            isock->dgram_errno = dgram_errno;
+            isock->raw_errno = errno;
+            return;
+        }
+        isock->raw = true;
+        isock->ident = gdnsd_rand32_get(rstate) & 0xFFFFU;
+        if(isock->isv6) {
+            struct icmp6_filter filt;
+            ICMP6_FILTER_SETBLOCKALL(&filt);
+            ICMP6_FILTER_SETPASS(ICMP6_ECHO_REPLY_TYPE, &filt);
+            if(setsockopt(fd, IPPROTO_ICMPV6, ICMP6_FILTER, &filt, sizeof(filt)) == -1)
+                log_warn("plugin_icmp: Failed to set ICMP6_FILTER on raw ICMPv6 socket: %s", dmn_logf_errno());
+        }
+    }
+
+    if(fcntl(fd, F_SETFL, (fcntl(fd, F_GETFL, 0)) | O_NONBLOCK) == -1)
+        log_fatal("plugin_icmp: Failed to set O_NONBLOCK on %s monitoring socket: %s", fam, dmn_logf_errno());
+    if(fcntl(fd, F_SETFD, FD_CLOEXEC) == -1)
+        log_fatal("plugin_icmp: Failed to set FD_CLOEXEC on %s monitoring socket: %s", fam, dmn_logf_errno());
+
+    log_debug("plugin_icmp: Using a %s socket for %s monitoring", isock->raw ? "raw" : "ping", fam);
+    isock->fd = fd;
+}
+
+void plugin_icmp_add_svctype(const char* name, vscf_data_t* svc_cfg V_UNUSED, const unsigned interval, const unsigned timeout) {
+    service_types = xrealloc(service_types, (num_icmp_svcs + 1) * sizeof(icmp_svc_t));
+    icmp_svc_t* this_svc = &service_types[num_icmp_svcs++];
+
+    this_svc->name = strdup(name);
+    this_svc->timeout = timeout;
+    this_svc->interval = interval;
+}
+
+void plugin_icmp_add_mon_addr(const char* desc, const char* svc_name, const char* cname V_UNUSED, const dmn_anysin_t* addr, const unsigned idx) {
+    icmp_events_t* this_mon = xcalloc(1, sizeof(icmp_events_t));
+    this_mon->desc = strdup(desc);
+    this_mon->idx = idx;
+
+    for(unsigned i = 0; i < num_icmp_svcs; i++) {
+        if(!strcmp(service_types[i].name, svc_name)) {
+            this_mon->icmp_svc = &service_types[i];
+            break;
+        }
+    }
+
+    dmn_assert(this_mon->icmp_svc);
+
+    if(!rstate)
+        rstate = gdnsd_rand32_init();
+
+    // ICMP has no ports, and raw IPv6 sockets insist on zero
+    memcpy(&this_mon->addr, addr, sizeof(dmn_anysin_t));
+    if(this_mon->addr.sa.sa_family == AF_INET) {
+        this_mon->addr.sin.sin_port = 0;
+        this_mon->sock = &sock_v4;
+    }
+    else {
+        dmn_assert(this_mon->addr.sa.sa_family == AF_INET6);
+        this_mon->addr.sin6.sin6_port = 0;
+        this_mon->sock = &sock_v6;
+    }
+
+    // this is our only chance at a raw socket when started as root
+    if(!this_mon->sock->tried)
+        icmp_sock_open(this_mon->sock);
+
+    this_mon->timeout_watcher = xmalloc(sizeof(ev_timer));
+    ev_timer_init(this_mon->timeout_watcher, &mon_timeout_cb, 0, 0);
+    this_mon->timeout_watcher->data = this_mon;
+
+    this_mon->interval_watcher = xmalloc(sizeof(ev_timer));
+    ev_timer_init(this_mon->interval_watcher, &mon_interval_cb, 0, 0);
+    this_mon->interval_watcher->data = this_mon;
+
+    mons = xrealloc(mons, sizeof(icmp_events_t*) * (num_mons + 1));
+    mons[num_mons++] = this_mon;
+}
+
+F_NONNULL
+static void icmp_sock_watch(struct ev_loop* mon_loop, icmp_sock_t* isock, ev_io** watcher_out) {
+    if(!isock->tried)
+        return;
+    if(isock->fd == -1)
+        log_fatal("plugin_icmp: Failed to create an %s monitoring socket: ping socket: %s, raw socket: %s (ping sockets may need to be allowed for gdnsd's group via the sysctl net.ipv4.ping_group_range, and raw sockets need gdnsd to be started as root)",
+            isock->isv6 ? "ICMPv6" : "ICMP", dmn_logf_strerror(isock->dgram_errno), dmn_logf_strerror(isock->raw_errno));
+    ev_io* watcher = xmalloc(sizeof(ev_io));
+    ev_io_init(watcher, &icmp_read_cb, isock->fd, EV_READ);
+    watcher->data = isock;
+    ev_io_start(mon_loop, watcher);
+    *watcher_out = watcher;
+}
+
+void plugin_icmp_init_monitors(struct ev_loop* mon_loop) {
+    if(!num_mons)
+        return;
+
+    pending = xcalloc(NUM_SEQS, sizeof(icmp_events_t*));
+    icmp_sock_watch(mon_loop, &sock_v4, &sock_watcher_v4);
+    icmp_sock_watch(mon_loop, &sock_v6, &sock_watcher_v6);
+
+    for(unsigned i = 0; i < num_mons; i++) {
+        ev_timer* ival_watcher = mons[i]->interval_watcher;
+        ev_timer_set(ival_watcher, 0, 0);
+        ev_timer_start(mon_loop, ival_watcher);
+    }
+}
+
+// As with dns_query, all of our monitors stay in the primary
+//   monitoring loop (see gdnsd_mon_get_loop()), as they share
+//   the sockets and the sequence number table.
+void plugin_icmp_start_monitors(struct ev_loop* mon_loop) {
+    init_phase = false;
+    if(sock_watcher_v4)
+        ev_io_start(mon_loop, sock_watcher_v4);
+    if(sock_watcher_v6)
+        ev_io_start(mon_loop, sock_watcher_v6);
+
+    for(unsigned i = 0; i < num_mons; i++) {
+        icmp_events_t* mon = mons[i];
+        dmn_assert(!mon->in_flight);
+        const unsigned ival = mon->icmp_svc->interval;
+        ev_timer* ival_watcher = mon->interval_watcher;
+        ev_timer_set(ival_watcher, gdnsd_mon_get_start_delay(mon->idx), ival);
+        ev_timer_start(mon_loop, ival_watcher);
+    }
+}
@@ -0,0 +1,140 @@
+/* Copyright © 2012 Brandon L Black <blblack@gmail.com>
+ *
+ * This file is part of gdnsd.
+ *
+ * gdnsd-plugin-geoip is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gdnsd-plugin-geoip is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gdnsd.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#define GDNSD_PLUGIN_NAME latency
+#include <gdnsd/plugin.h>
+
+#include <gdmaps.h>
+
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <stdbool.h>
+
+// plugin_latency is plugin_geoip restricted to maps driven by measured
+//   RTT matrices ("rtt_db", see libgdmaps/rttdb.h) rather than GeoIP
+//   databases.  The map data is reloaded and swapped by libgdmaps just
+//   as it is for GeoIP, and lookups are the same ntree walk.
+
+static gdmaps_t* gdmaps;
+static unsigned num_maps = 0;
+
+// per-thread cache of map lookups within one query, one slot per map
+static __thread gdnsd_query_cache_t* map_qcache = NULL;
+
+F_NONNULL
+static unsigned res_get_mapnum(vscf_data_t* res_cfg, const char* res_name) {
+    // Get 'map' name, convert to gdmaps index
+    vscf_data_t* map_cfg = vscf_hash_get_data_byconstkey(res_cfg, "map", true);
+    if(!map_cfg)
+        log_fatal("plugin_latency: resource '%s': required key 'map' is missing", res_name);
+    if(!vscf_is_simple(map_cfg))
+        log_fatal("plugin_latency: resource '%s': 'map' must be a string", res_name);
+    const char* map_name = vscf_simple_get_data(map_cfg);
+    const int rv = gdmaps_name2idx(gdmaps, map_name);
+    if(rv < 0)
+        log_fatal("plugin_latency: resource '%s': map '%s' does not exist", res_name, map_name);
+    return (unsigned)rv;
+}
+
+static unsigned map_get_len(const unsigned mapnum) {
+    return gdmaps_get_dc_count(gdmaps, mapnum);
+}
+
+static unsigned map_get_dcidx(const unsigned mapnum, const char* dcname) {
+    return gdmaps_dcname2num(gdmaps, mapnum, dcname);
+}
+
+F_NONNULL
+static bool map_check_rtt(const char* map_name, unsigned klen V_UNUSED, vscf_data_t* map_cfg, void* data V_UNUSED) {
+    if(vscf_is_hash(map_cfg) && !vscf_hash_get_data_byconstkey(map_cfg, "rtt_db", false))
+        log_fatal("plugin_latency: map '%s': required key 'rtt_db' is missing", map_name);
+    return true;
+}
+
+F_NONNULL
+static bool top_config_hook(vscf_data_t* top_config) {
+    dmn_assert(vscf_is_hash(top_config));
+
+    vscf_data_t* maps = vscf_hash_get_data_byconstkey(top_config, "maps", true);
+    if(!maps)
+        log_fatal("plugin_latency: config has no 'maps' stanza");
+    if(!vscf_is_hash(maps))
+        log_fatal("plugin_latency: 'maps' stanza must be a hash");
+    if(!vscf_hash_get_len(maps))
+        log_fatal("plugin_latency: 'maps' stanza must contain one or more maps");
+
+    vscf_hash_iterate(maps, false, map_check_rtt, NULL);
+    gdmaps = gdmaps_new(maps);
+    num_maps = vscf_hash_get_len(maps);
+
+    bool undef_dc_ok = false;
+    vscf_data_t* undef_dc_ok_vscf = vscf_hash_get_data_byconstkey(top_config, "undefined_datacenters_ok", true);
+    if(undef_dc_ok_vscf) {
+        if(!vscf_is_simple(undef_dc_ok_vscf) || !vscf_simple_get_as_bool(undef_dc_ok_vscf, &undef_dc_ok))
+            log_fatal("plugin_latency: 'undef_dc_ok' must be a boolean value ('true' or 'false')");
+    }
+
+    return undef_dc_ok;
+}
+
+static void bottom_config_hook(void) {
+    dmn_assert(gdmaps);
+    gdmaps_load_databases(gdmaps);
+}
+
+void plugin_latency_pre_run(void) {
+    dmn_assert(gdmaps);
+    gdmaps_setup_watchers(gdmaps);
+}
+
+F_NONNULL
+static const uint8_t* map_get_dclist(const unsigned mapnum, const client_info_t* cinfo, unsigned* scope_out) {
+    dmn_assert(gdmaps);
+    dmn_assert(map_qcache); // iothread_init
+
+    const uint8_t* dclist = gdnsd_query_cache_get(map_qcache, cinfo, mapnum, scope_out);
+    if(!dclist) {
+        dclist = gdmaps_lookup(gdmaps, mapnum, cinfo, scope_out);
+        gdnsd_query_cache_put(map_qcache, cinfo, mapnum, dclist, *scope_out);
+    }
+    return dclist;
+}
+
+static unsigned map_get_mon_idx(const unsigned mapnum, const unsigned dcnum) {
+    return gdmaps_map_mon_idx(gdmaps, mapnum, dcnum);
+}
+
+static unsigned map_get_gen(const unsigned mapnum) {
+    return gdmaps_map_gen(gdmaps, mapnum);
+}
+
+#define PNSTR "latency"
+#define CB_LOAD_CONFIG plugin_latency_load_config
+#define CB_MAP plugin_latency_map_res
+#define CB_RES plugin_latency_resolve
+#define META_MAP_ADMIN 1
+#include "meta_core.inc"
+
+void plugin_latency_iothread_init(const unsigned threadnum V_UNUSED) {
+    map_qcache = gdnsd_query_cache_new(num_maps);
+    meta_iothread_init();
+}
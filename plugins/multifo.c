@@ -58,6 +58,9 @@ typedef struct {
 static res_t* resources = NULL;
 static unsigned num_resources = 0;
 
+// Per-thread memo of results, indexed by resource number
+static __thread gdnsd_result_memo_t* memo = NULL;
+
 /*********************************/
 /* Local, static functions       */
 /*********************************/
@@ -343,7 +346,7 @@ int plugin_multifo_map_res(const char* resname, const uint8_t* origin V_UNUSED)
 }
 
 F_NONNULL
-static gdnsd_sttl_t resolve(const gdnsd_sttl_t* sttl_tbl, const addrset_t* aset, dyn_result_t* result, const bool isv6) {
+static gdnsd_sttl_t resolve(const gdnsd_sttl_tbl_t* sttl_tbl, const addrset_t* aset, dyn_result_t* result, const bool isv6) {
     dmn_assert(aset->count);
 
     gdnsd_sttl_t rv = GDNSD_STTL_TTL_MAX;
@@ -383,13 +386,21 @@ static gdnsd_sttl_t resolve(const gdnsd_sttl_t* sttl_tbl, const addrset_t* aset,
     return rv;
 }
 
+void plugin_multifo_iothread_init(const unsigned threadnum V_UNUSED) {
+    memo = gdnsd_result_memo_new(num_resources);
+}
+
 gdnsd_sttl_t plugin_multifo_resolve(unsigned resnum, const uint8_t* origin V_UNUSED, const client_info_t* cinfo V_UNUSED, dyn_result_t* result) {
-    const gdnsd_sttl_t* sttl_tbl = gdnsd_mon_get_sttl_table();
+    const gdnsd_sttl_tbl_t* sttl_tbl = gdnsd_mon_get_sttl_table();
 
     res_t* res = &resources[resnum];
 
     gdnsd_sttl_t rv;
 
+    // the result only changes with the sttl table
+    if(gdnsd_result_memo_get(memo, resnum, gdnsd_sttl_tbl_gen(sttl_tbl), result, &rv))
+        return rv;
+
     if(res->aset_v4) {
         rv = resolve(sttl_tbl, res->aset_v4, result, false);
         if(res->aset_v6) {
@@ -403,5 +414,6 @@ gdnsd_sttl_t plugin_multifo_resolve(unsigned resnum, const uint8_t* origin V_UNU
     }
 
     assert_valid_sttl(rv);
+    gdnsd_result_memo_put(memo, resnum, result, rv);
     return rv;
 }
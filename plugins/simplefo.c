@@ -60,6 +60,9 @@ typedef struct {
 static res_t* resources = NULL;
 static unsigned num_resources = 0;
 
+// Per-thread memo of results, indexed by resource number
+static __thread gdnsd_result_memo_t* memo = NULL;
+
 static const char DEFAULT_SVCNAME[] = "up";
 
 /*********************************/
@@ -220,7 +223,7 @@ int plugin_simplefo_map_res(const char* resname, const uint8_t* origin V_UNUSED)
 // down down s        pri   yes
 // ----------------------------
 F_NONNULL
-static gdnsd_sttl_t resolve_addr(const gdnsd_sttl_t* sttl_tbl, const addrstate_t* as, dyn_result_t* result) {
+static gdnsd_sttl_t resolve_addr(const gdnsd_sttl_tbl_t* sttl_tbl, const addrstate_t* as, dyn_result_t* result) {
     const gdnsd_sttl_t p_sttl = gdnsd_sttl_min(sttl_tbl, as->indices[A_PRI], as->num_svcs);
 
     res_which_t which = A_PRI;
@@ -251,13 +254,21 @@ static gdnsd_sttl_t resolve_addr(const gdnsd_sttl_t* sttl_tbl, const addrstate_t
     return sttl_out;
 }
 
+void plugin_simplefo_iothread_init(const unsigned threadnum V_UNUSED) {
+    memo = gdnsd_result_memo_new(num_resources);
+}
+
 gdnsd_sttl_t plugin_simplefo_resolve(unsigned resnum, const uint8_t* origin V_UNUSED, const client_info_t* cinfo V_UNUSED, dyn_result_t* result) {
     res_t* res = &resources[resnum];
 
-    const gdnsd_sttl_t* sttl_tbl = gdnsd_mon_get_sttl_table();
+    const gdnsd_sttl_tbl_t* sttl_tbl = gdnsd_mon_get_sttl_table();
 
     gdnsd_sttl_t rv;
 
+    // the result only changes with the sttl table
+    if(gdnsd_result_memo_get(memo, resnum, gdnsd_sttl_tbl_gen(sttl_tbl), result, &rv))
+        return rv;
+
     if(res->addrs_v4) {
         rv = resolve_addr(sttl_tbl, res->addrs_v4, result);
         if(res->addrs_v6) {
@@ -271,5 +282,6 @@ gdnsd_sttl_t plugin_simplefo_resolve(unsigned resnum, const uint8_t* origin V_UN
     }
 
     assert_valid_sttl(rv);
+    gdnsd_result_memo_put(memo, resnum, result, rv);
     return rv;
 }
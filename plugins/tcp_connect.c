@@ -59,6 +59,7 @@ typedef struct {
     unsigned idx;
     tcp_state_t tcp_state;
     int sock;
+    ev_tstamp check_start; // for the check latency
 } tcp_events_t;
 
 static unsigned num_tcp_svcs = 0;
@@ -74,6 +75,16 @@ static void mon_interval_cb(struct ev_loop* loop, struct ev_timer* t, const int
 
     dmn_assert(md);
 
+    // apply the service type's jitter, if any, to the next regular
+    //   check (the initial round is a single-shot timer)
+    if(t->repeat > 0.0) {
+        const double next = gdnsd_mon_get_next_delay(md->idx);
+        if(next > 0.0) {
+            t->repeat = next;
+            ev_timer_again(loop, t);
+        }
+    }
+
     if(md->tcp_state != TCP_STATE_WAITING) {
         log_warn("plugin_tcp_connect: A monitoring request attempt seems to have "
             "lasted longer than the monitoring interval. "
@@ -87,6 +98,7 @@ static void mon_interval_cb(struct ev_loop* loop, struct ev_timer* t, const int
     dmn_assert(!ev_is_active(md->timeout_watcher) && !ev_is_pending(md->timeout_watcher));
 
     log_debug("plugin_tcp_connect: Starting state poll of %s", md->desc);
+    md->check_start = ev_now(loop);
 
     const bool isv6 = md->addr.sa.sa_family == AF_INET6;
 
@@ -133,7 +145,7 @@ static void mon_interval_cb(struct ev_loop* loop, struct ev_timer* t, const int
     }
 
     close(sock);
-    gdnsd_mon_state_updater(md->idx, success);
+    gdnsd_mon_state_updater_timed(md->idx, success, ev_now(loop) - md->check_start);
 }
 
 F_NONNULL
@@ -178,7 +190,7 @@ static void mon_connect_cb(struct ev_loop* loop, struct ev_io* io, const int rev
     ev_io_stop(loop, md->connect_watcher);
     ev_timer_stop(loop, md->timeout_watcher);
     md->tcp_state = TCP_STATE_WAITING;
-    gdnsd_mon_state_updater(md->idx, success);
+    gdnsd_mon_state_updater_timed(md->idx, success, ev_now(loop) - md->check_start);
 }
 
 F_NONNULL
@@ -198,7 +210,7 @@ static void mon_timeout_cb(struct ev_loop* loop, struct ev_timer* t, const int r
     close(md->sock);
     md->sock = -1;
     md->tcp_state = TCP_STATE_WAITING;
-    gdnsd_mon_state_updater(md->idx, false);
+    gdnsd_mon_state_updater_timed(md->idx, false, ev_now(loop) - md->check_start);
 }
 
 #define SVC_OPT_UINT(_hash, _typnam, _loc, _min, _max) \
@@ -282,14 +294,13 @@ void plugin_tcp_connect_init_monitors(struct ev_loop* mon_loop) {
     }
 }
 
-void plugin_tcp_connect_start_monitors(struct ev_loop* mon_loop) {
+void plugin_tcp_connect_start_monitors(struct ev_loop* mon_loop V_UNUSED) {
     for(unsigned i = 0; i < num_mons; i++) {
         tcp_events_t* mon = mons[i];
         dmn_assert(mon->sock == -1);
         const unsigned ival = mon->tcp_svc->interval;
-        const double stagger = (((double)i) / ((double)num_mons)) * ((double)ival);
         ev_timer* ival_watcher = mon->interval_watcher;
-        ev_timer_set(ival_watcher, stagger, ival);
-        ev_timer_start(mon_loop, ival_watcher);
+        ev_timer_set(ival_watcher, gdnsd_mon_get_start_delay(mon->idx), ival);
+        ev_timer_start(gdnsd_mon_get_loop(mon->idx), ival_watcher);
     }
 }
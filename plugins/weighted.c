@@ -626,6 +626,35 @@ static bool config_res(const char* res_name, unsigned klen V_UNUSED, vscf_data_t
 
 ////// exported callbacks start here
 
+// scratch memory used by alias_build() for a table of _count columns,
+//   including the arena's rounding of its three allocations
+#define ALIAS_SCRATCH(_count) ((_count) * (sizeof(uint64_t) + 2U * sizeof(unsigned)) + 48U)
+
+// scratch memory used by dyn_aset_build(): an alias table per item for
+//   multi, else the item_sums array and one alias table over the items
+F_NONNULL F_PURE
+static size_t aset_scratch(const addrset_t* aset) {
+    if(!aset->multi)
+        return aset->count * sizeof(unsigned) + 16U + ALIAS_SCRATCH(aset->count);
+    size_t rv = 0;
+    for(unsigned i = 0; i < aset->count; i++)
+        rv += ALIAS_SCRATCH(aset->items[i].count);
+    return rv;
+}
+
+// scratch memory used by a dyn_res_get() rebuild of the whole resource
+F_NONNULL F_PURE
+static size_t res_scratch(const resource_t* res) {
+    size_t rv = 0;
+    if(res->cnames)
+        rv += ALIAS_SCRATCH(res->cnames->count);
+    if(res->addrs_v4)
+        rv += aset_scratch(res->addrs_v4);
+    if(res->addrs_v6)
+        rv += aset_scratch(res->addrs_v6);
+    return rv;
+}
+
 void plugin_weighted_load_config(vscf_data_t* config, const unsigned num_threads V_UNUSED) {
     dmn_assert(config);
     dmn_assert(vscf_is_hash(config));
@@ -642,11 +671,16 @@ void plugin_weighted_load_config(vscf_data_t* config, const unsigned num_threads
     unsigned idx = 0;
     vscf_hash_iterate(config, true, config_res, &idx);
 
-    // find maximum per-address-family address output counts...
+    // find maximum per-address-family address output counts, and
+    //   the most scratch memory needed to rebuild any one resource
     unsigned max_v4 = 0;
     unsigned max_v6 = 0;
+    size_t max_scratch = 0;
     for(unsigned i = 0; i < num_resources; i++) {
         resource_t* res = &resources[i];
+        const size_t rs = res_scratch(res);
+        if(rs > max_scratch)
+            max_scratch = rs;
         if(res->addrs_v4) {
             addrset_t* aset = res->addrs_v4;
             const unsigned max = aset->multi
@@ -665,6 +699,7 @@ void plugin_weighted_load_config(vscf_data_t* config, const unsigned num_threads
         }
     }
     gdnsd_dyn_addr_max(max_v4, max_v6);
+    gdnsd_scratch_reserve(max_scratch);
 }
 
 int plugin_weighted_map_res(const char* resname, const uint8_t* origin) {
@@ -695,12 +730,133 @@ int plugin_weighted_map_res(const char* resname, const uint8_t* origin) {
     map_res_err("plugin_weighted: unknown resource '%s'", resname);
 }
 
-void plugin_weighted_iothread_init(const unsigned threadnum V_UNUSED) { init_rand(); }
+// Walker/Vose alias table, for a weighted random choice of one of
+//   "count" items in constant time.  Column N is chosen uniformly, and
+//   then item N is the result with probability prob[N] / total, else
+//   alias[N].  All of the math is integer, so the distribution is
+//   exactly the same as a linear scan over the running total of the
+//   weights.
+typedef struct {
+    unsigned* prob;
+    unsigned* alias;
+    unsigned count;
+    unsigned total; // sum of the weights, can be zero (no choice possible)
+} alias_tbl_t;
+
+// Per-thread dynamic state of each resource, which is derived from the
+//   sttl table and the static config, and is rebuilt whenever the
+//   sttl table generation changes (see dyn_res_get()).
+typedef struct {
+    unsigned* weights; // configured weight of each addr, or 0 if down
+    alias_tbl_t pick;  // choice of one addr, multi mode only
+    unsigned sum;
+    unsigned max;
+} dyn_aitem_t;
+
+typedef struct {
+    dyn_aitem_t* items;
+    alias_tbl_t pick; // choice of one item, single mode only
+    unsigned items_max; // multi mode only
+    gdnsd_sttl_t rv;
+} dyn_aset_t;
+
+typedef struct {
+    alias_tbl_t pick;
+    gdnsd_sttl_t rv;
+} dyn_cnset_t;
+
+typedef struct {
+    dyn_cnset_t* cnames;
+    dyn_aset_t* addrs_v4;
+    dyn_aset_t* addrs_v6;
+    unsigned gen;
+} dyn_res_t;
+
+// indexed by resource number, each allocated on first use by a thread
+static __thread dyn_res_t** dyn_res = NULL;
+
+void plugin_weighted_iothread_init(const unsigned threadnum V_UNUSED) {
+    init_rand();
+    dyn_res = xcalloc(num_resources, sizeof(dyn_res_t*));
+}
+
+F_NONNULL
+static void alias_init(alias_tbl_t* at, const unsigned count) {
+    at->prob = xmalloc(count * sizeof(unsigned));
+    at->alias = xmalloc(count * sizeof(unsigned));
+    at->count = count;
+    at->total = 0;
+}
+
+F_NONNULL
+static void alias_build(alias_tbl_t* at, const unsigned* weights) {
+    const unsigned count = at->count;
+    dmn_assert(count);
+
+    unsigned total = 0;
+    for(unsigned i = 0; i < count; i++)
+        total += weights[i];
+    at->total = total;
+    if(!total)
+        return;
+
+    // Each weight is scaled by count, so that the average column is
+    //   exactly "total".  Columns below that are topped up from above.
+    uint64_t* scaled = gdnsd_scratch_alloc(count * sizeof(uint64_t));
+    unsigned* small = gdnsd_scratch_alloc(count * sizeof(unsigned));
+    unsigned* large = gdnsd_scratch_alloc(count * sizeof(unsigned));
+    unsigned num_small = 0;
+    unsigned num_large = 0;
+    for(unsigned i = 0; i < count; i++) {
+        scaled[i] = (uint64_t)weights[i] * count;
+        if(scaled[i] < total)
+            small[num_small++] = i;
+        else
+            large[num_large++] = i;
+    }
+
+    while(num_small && num_large) {
+        const unsigned s = small[--num_small];
+        const unsigned l = large[num_large - 1U];
+        at->prob[s] = (unsigned)scaled[s];
+        at->alias[s] = l;
+        scaled[l] -= total - scaled[s];
+        if(scaled[l] < total) {
+            num_large--;
+            small[num_small++] = l;
+        }
+    }
+
+    // the leftovers are all exactly full columns
+    while(num_large) {
+        const unsigned l = large[--num_large];
+        at->prob[l] = total;
+        at->alias[l] = l;
+    }
+    while(num_small) {
+        const unsigned s = small[--num_small];
+        at->prob[s] = total;
+        at->alias[s] = s;
+    }
+}
+
+F_NONNULL
+static unsigned alias_pick(const alias_tbl_t* at) {
+    dmn_assert(at->total);
+    const uint64_t r = get_rand((uint64_t)at->count * at->total);
+    const unsigned col = (unsigned)(r / at->total);
+    return (r % at->total) < at->prob[col] ? col : at->alias[col];
+}
 
 F_NONNULL
-static gdnsd_sttl_t resolve_cname(const gdnsd_sttl_t* sttl_tbl, const resource_t* resource, const uint8_t* origin, dyn_result_t* result) {
-    cnset_t* cnset = resource->cnames;
-    dmn_assert(cnset);
+static dyn_cnset_t* dyn_cnset_new(const cnset_t* cnset) {
+    dyn_cnset_t* dcn = xmalloc(sizeof(dyn_cnset_t));
+    alias_init(&dcn->pick, cnset->count);
+    return dcn;
+}
+
+F_NONNULL
+static void dyn_cnset_build(const gdnsd_sttl_tbl_t* sttl_tbl, const cnset_t* cnset, dyn_cnset_t* dcn) {
     dmn_assert(cnset->weight);
 
     gdnsd_sttl_t rv = GDNSD_STTL_TTL_MAX;
@@ -731,11 +887,8 @@ static gdnsd_sttl_t resolve_cname(const gdnsd_sttl_t* sttl_tbl, const resource_t
     //   upstream callers
     if(dyn_sum < cnset->up_weight) {
         rv |= GDNSD_STTL_DOWN;
-        dyn_sum = cnset->weight;
-        for(unsigned i = 0; i < ct; i++) {
-            const res_citem_t* citem = &cnset->items[i];
-            dyn_weights[i] = citem->weight;
-        }
+        for(unsigned i = 0; i < ct; i++)
+            dyn_weights[i] = cnset->items[i].weight;
     }
     // if up_thresh check passed, clear any DOWN flag
     //  which came from an individual CNAME into
@@ -744,152 +897,186 @@ static gdnsd_sttl_t resolve_cname(const gdnsd_sttl_t* sttl_tbl, const resource_t
         rv &= ~GDNSD_STTL_DOWN;
     }
 
-    dmn_assert(dyn_sum);
+    alias_build(&dcn->pick, dyn_weights);
+    dmn_assert(dcn->pick.total);
 
-    // choose the first item that breaks the random threshold
-    const unsigned item_rand = get_rand(dyn_sum);
-    unsigned running_total = 0;
-    unsigned chosen = 0;
-    for(unsigned i = 0; i < ct; i++) {
-        running_total += dyn_weights[i];
-        if(item_rand < running_total) {
-            chosen = i;
-            break;
-        }
-    }
-
-    // set the output stuff
-    gdnsd_result_add_cname(result, cnset->items[chosen].cname, origin);
+    assert_valid_sttl(rv);
+    dcn->rv = rv;
+}
 
-    return rv;
+F_NONNULL
+static dyn_aset_t* dyn_aset_new(const addrset_t* aset) {
+    dyn_aset_t* daset = xmalloc(sizeof(dyn_aset_t));
+    daset->items = xmalloc(aset->count * sizeof(dyn_aitem_t));
+    for(unsigned item_idx = 0; item_idx < aset->count; item_idx++) {
+        dyn_aitem_t* ditem = &daset->items[item_idx];
+        const unsigned num_addrs = aset->items[item_idx].count;
+        ditem->weights = xmalloc(num_addrs * sizeof(unsigned));
+        if(aset->multi)
+            alias_init(&ditem->pick, num_addrs);
+    }
+    if(!aset->multi)
+        alias_init(&daset->pick, aset->count);
+    return daset;
 }
 
 F_NONNULL
-static gdnsd_sttl_t resolve(const gdnsd_sttl_t* sttl_tbl, const addrset_t* aset, dyn_result_t* result) {
+static void dyn_aset_build(const gdnsd_sttl_tbl_t* sttl_tbl, const addrset_t* aset, dyn_aset_t* daset) {
     const unsigned num_items = aset->count;
-    unsigned dyn_items_sum = 0; // sum of dyn_item_sums[]
-    unsigned dyn_items_max = 0; // max of dyn_item_sums[]
-    unsigned dyn_item_sums[num_items]; // sum of dyn_addr_weights[N][]
-    unsigned dyn_item_maxs[num_items]; // max of dyn_addr_weights[N][]
-    // addr cfg weight or 0, depends on status:
-    unsigned dyn_addr_weights[num_items][aset->max_addrs_pergroup];
-
-    // not strictly necessary (we write to every array item we use), but this
-    //   avoids clang-analyzer getting confused and complaining about garbage values :P
-    memset(dyn_addr_weights, 0, sizeof(dyn_addr_weights));
+    unsigned dyn_items_sum = 0; // sum of item sums
+    unsigned dyn_items_max = 0; // max of item sums
 
     gdnsd_sttl_t rv = GDNSD_STTL_TTL_MAX;
 
     // Get dynamic info about each item
     for(unsigned item_idx = 0; item_idx < num_items; item_idx++) {
         const res_aitem_t* res_item = &aset->items[item_idx];
-        dyn_item_sums[item_idx] = 0;
-        dyn_item_maxs[item_idx] = 0;
+        dyn_aitem_t* ditem = &daset->items[item_idx];
+        ditem->sum = 0;
+        ditem->max = 0;
         for(unsigned addr_idx = 0; addr_idx < res_item->count; addr_idx++) {
             const addrstate_t* addr = &res_item->as[addr_idx];
             const gdnsd_sttl_t addr_sttl
                 = gdnsd_sttl_min(sttl_tbl, addr->indices, aset->num_svcs);
             rv = gdnsd_sttl_min2(rv, addr_sttl);
             if(addr_sttl & GDNSD_STTL_DOWN) {
-                dyn_addr_weights[item_idx][addr_idx] = 0;
+                ditem->weights[addr_idx] = 0;
             }
             else {
-                dyn_addr_weights[item_idx][addr_idx] = addr->weight;
-                dyn_item_sums[item_idx] += addr->weight;
-                if(addr->weight > dyn_item_maxs[item_idx])
-                    dyn_item_maxs[item_idx] = addr->weight;
+                ditem->weights[addr_idx] = addr->weight;
+                ditem->sum += addr->weight;
+                if(addr->weight > ditem->max)
+                    ditem->max = addr->weight;
             }
         }
-    }
-
-    // summarize dynamic info at the resource level
-    for(unsigned item_idx = 0; item_idx < num_items; item_idx++) {
-        const unsigned isum = dyn_item_sums[item_idx];
-        dyn_items_sum += isum;
-        if(dyn_items_max < isum)
-            dyn_items_max = isum;
+        dyn_items_sum += ditem->sum;
+        if(dyn_items_max < ditem->sum)
+            dyn_items_max = ditem->sum;
     }
 
     // if all items looked completely-down, treat them all as completely-up
     if(dyn_items_sum < aset->up_weight) {
         rv |= GDNSD_STTL_DOWN;
-        dyn_items_sum = aset->weight;
         dyn_items_max = aset->max_weight;
         for(unsigned item_idx = 0; item_idx < num_items; item_idx++) {
             const res_aitem_t* res_item = &aset->items[item_idx];
-            dyn_item_sums[item_idx] = res_item->weight;
-            dyn_item_maxs[item_idx] = res_item->max_weight;
+            dyn_aitem_t* ditem = &daset->items[item_idx];
+            ditem->sum = res_item->weight;
+            ditem->max = res_item->max_weight;
             for(unsigned addr_idx = 0; addr_idx < res_item->count; addr_idx++)
-                dyn_addr_weights[item_idx][addr_idx] = res_item->as[addr_idx].weight;
+                ditem->weights[addr_idx] = res_item->as[addr_idx].weight;
         }
     }
     else {
         rv &= ~GDNSD_STTL_DOWN;
     }
 
-    dmn_assert(dyn_items_sum);
     dmn_assert(dyn_items_max);
 
     if(aset->multi) {
-        // Outer decision: choose multiple items based on dyn_items_max
+        daset->items_max = dyn_items_max;
         for(unsigned item_idx = 0; item_idx < num_items; item_idx++) {
-            const res_aitem_t* res_item = &aset->items[item_idx];
-            const unsigned item_rand = get_rand(dyn_items_max);
-            const unsigned isum = dyn_item_sums[item_idx];
-            if(item_rand < isum) {
-                dmn_assert(isum); // given that they're both uints
-                // Inner decision: choose one addr based on dyn_item->sum
-                const unsigned addr_rand = get_rand(isum);
-                unsigned addr_running_total = 0;
-                for(unsigned addr_idx = 0; addr_idx < res_item->count; addr_idx++) {
-                    addr_running_total += dyn_addr_weights[item_idx][addr_idx];
-                    if(addr_rand < addr_running_total) {
-                        gdnsd_result_add_anysin(result, &res_item->as[addr_idx].addr);
-                        break;
-                    }
-                }
-            }
+            dyn_aitem_t* ditem = &daset->items[item_idx];
+            alias_build(&ditem->pick, ditem->weights);
         }
     }
     else {
-        // Outer decision: choose one item based on dyn_items_sum
-        const unsigned item_rand = get_rand(dyn_items_sum);
-        unsigned item_running_total = 0;
-        for(unsigned item_idx = 0; item_idx < num_items; item_idx++) {
-            item_running_total += dyn_item_sums[item_idx];
-            if(item_rand < item_running_total) {
-                const res_aitem_t* chosen = &aset->items[item_idx];
-                // Inner decision: choose multiple addrs based on chosen's dynamic max
-                const unsigned addr_max = dyn_item_maxs[item_idx];
-                dmn_assert(addr_max);
-                for(unsigned addr_idx = 0; addr_idx < chosen->count; addr_idx++) {
-                    const unsigned addr_rand = get_rand(addr_max);
-                    if(addr_rand < dyn_addr_weights[item_idx][addr_idx])
-                        gdnsd_result_add_anysin(result, &chosen->as[addr_idx].addr);
-                }
-                break;
+        unsigned* item_sums = gdnsd_scratch_alloc(num_items * sizeof(unsigned));
+        for(unsigned item_idx = 0; item_idx < num_items; item_idx++)
+            item_sums[item_idx] = daset->items[item_idx].sum;
+        alias_build(&daset->pick, item_sums);
+    }
+
+    assert_valid_sttl(rv);
+    daset->rv = rv;
+}
+
+// Fetches this thread's dynamic state for a resource, (re-)building it
+//   if it's missing or out of date with respect to the sttl table
+static const dyn_res_t* dyn_res_get(const gdnsd_sttl_tbl_t* sttl_tbl, const unsigned resnum) {
+    dmn_assert(dyn_res); // iothread_init
+    const resource_t* resource = &resources[resnum];
+    const unsigned gen = gdnsd_sttl_tbl_gen(sttl_tbl);
+
+    dyn_res_t* dres = dyn_res[resnum];
+    if(!dres) {
+        dres = xcalloc(1, sizeof(dyn_res_t));
+        if(resource->cnames)
+            dres->cnames = dyn_cnset_new(resource->cnames);
+        if(resource->addrs_v4)
+            dres->addrs_v4 = dyn_aset_new(resource->addrs_v4);
+        if(resource->addrs_v6)
+            dres->addrs_v6 = dyn_aset_new(resource->addrs_v6);
+        dyn_res[resnum] = dres;
+    }
+    else if(dres->gen == gen) {
+        return dres;
+    }
+
+    if(dres->cnames)
+        dyn_cnset_build(sttl_tbl, resource->cnames, dres->cnames);
+    if(dres->addrs_v4)
+        dyn_aset_build(sttl_tbl, resource->addrs_v4, dres->addrs_v4);
+    if(dres->addrs_v6)
+        dyn_aset_build(sttl_tbl, resource->addrs_v6, dres->addrs_v6);
+    dres->gen = gen;
+    return dres;
+}
+
+F_NONNULL
+static gdnsd_sttl_t resolve_cname(const resource_t* resource, const dyn_cnset_t* dcn, const uint8_t* origin, dyn_result_t* result) {
+    const unsigned chosen = alias_pick(&dcn->pick);
+    gdnsd_result_add_cname(result, resource->cnames->items[chosen].cname, origin);
+    return dcn->rv;
+}
+
+F_NONNULL
+static gdnsd_sttl_t resolve(const addrset_t* aset, const dyn_aset_t* daset, dyn_result_t* result) {
+    if(aset->multi) {
+        // Outer decision: choose multiple items based on items_max
+        for(unsigned item_idx = 0; item_idx < aset->count; item_idx++) {
+            const dyn_aitem_t* ditem = &daset->items[item_idx];
+            const unsigned item_rand = get_rand(daset->items_max);
+            if(item_rand < ditem->sum) {
+                // Inner decision: choose one addr based on its dynamic weight
+                const unsigned addr_idx = alias_pick(&ditem->pick);
+                gdnsd_result_add_anysin(result, &aset->items[item_idx].as[addr_idx].addr);
             }
         }
     }
+    else {
+        // Outer decision: choose one item based on the item sums
+        const unsigned item_idx = alias_pick(&daset->pick);
+        const res_aitem_t* chosen = &aset->items[item_idx];
+        const dyn_aitem_t* ditem = &daset->items[item_idx];
+        // Inner decision: choose multiple addrs based on chosen's dynamic max
+        const unsigned addr_max = ditem->max;
+        dmn_assert(addr_max);
+        for(unsigned addr_idx = 0; addr_idx < chosen->count; addr_idx++) {
+            const unsigned addr_rand = get_rand(addr_max);
+            if(addr_rand < ditem->weights[addr_idx])
+                gdnsd_result_add_anysin(result, &chosen->as[addr_idx].addr);
+        }
+    }
 
-    assert_valid_sttl(rv);
-    return rv;
+    assert_valid_sttl(daset->rv);
+    return daset->rv;
 }
 
 F_NONNULL
-static gdnsd_sttl_t resolve_addr(const gdnsd_sttl_t* sttl_tbl, const resource_t* res, dyn_result_t* result) {
+static gdnsd_sttl_t resolve_addr(const resource_t* res, const dyn_res_t* dres, dyn_result_t* result) {
     gdnsd_sttl_t rv;
 
     if(res->addrs_v4) {
-        rv = resolve(sttl_tbl, res->addrs_v4, result);
+        rv = resolve(res->addrs_v4, dres->addrs_v4, result);
         if(res->addrs_v6) {
-            const gdnsd_sttl_t v6_rv = resolve(sttl_tbl, res->addrs_v6, result);
+            const gdnsd_sttl_t v6_rv = resolve(res->addrs_v6, dres->addrs_v6, result);
             rv = gdnsd_sttl_min2(rv, v6_rv);
         }
     }
     else {
         dmn_assert(res->addrs_v6);
-        rv = resolve(sttl_tbl, res->addrs_v6, result);
+        rv = resolve(res->addrs_v6, dres->addrs_v6, result);
     }
 
     assert_valid_sttl(rv);
@@ -902,14 +1089,15 @@ gdnsd_sttl_t plugin_weighted_resolve(unsigned resnum, const uint8_t* origin, con
 
     gdnsd_sttl_t rv;
 
-    const gdnsd_sttl_t* sttl_tbl = gdnsd_mon_get_sttl_table();
+    const gdnsd_sttl_tbl_t* sttl_tbl = gdnsd_mon_get_sttl_table();
+    const dyn_res_t* dres = dyn_res_get(sttl_tbl, resnum);
 
     if(resource->cnames) {
         dmn_assert(origin); // map_res validates this
-        rv = resolve_cname(sttl_tbl, resource, origin, result);
+        rv = resolve_cname(resource, dres->cnames, origin, result);
     }
     else {
-        rv = resolve_addr(sttl_tbl, resource, result);
+        rv = resolve_addr(resource, dres, result);
     }
 
     assert_valid_sttl(rv);
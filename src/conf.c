@@ -23,6 +23,10 @@
 #include "main.h"
 #include "socks.h"
 
+#ifdef GDNSD_BUILTIN_PLUGINS
+#include "plugins_builtin.h"
+#endif
+
 #include <gdnsd-prot/mon.h>
 #include <gdnsd-prot/plugapi.h>
 #include <gdnsd/alloc.h>
@@ -74,6 +78,7 @@ static const cfg_t cfg_defaults = {
     .max_cname_depth = 16U,
     .max_addtl_rrsets = 64U,
     .zones_rfc1035_auto_interval = 31U,
+    .monitor_threads = 1U,
     .zones_rfc1035_quiesce = 3.0,
 };
 
@@ -260,6 +265,7 @@ cfg_t* conf_load(const vscf_data_t* cfg_root, const socks_cfg_t* socks_cfg, cons
         if(!vscf_hash_get_data_byconstkey(options, "zones_rfc1035_auto", true))
             log_warn("The default value of the global option 'zones_rfc1035_auto' will likely change from 'true' to 'false' in a future version.  Setting the value explicitly for forward-compatibility is recommended!");
         CFG_OPT_UINT(options, zones_rfc1035_auto_interval, 10LU, 600LU);
+        CFG_OPT_UINT(options, monitor_threads, 1LU, 64LU);
         CFG_OPT_DBL(options, zones_rfc1035_quiesce, 1.02, 60.0);
         if(vscf_hash_get_data_byconstkey(options, "zones_rfc1035_min_quiesce", true))
             log_warn("The global option 'zones_rfc1035_min_quiesce' is deprecated and no longer has any effect");
@@ -284,6 +290,9 @@ cfg_t* conf_load(const vscf_data_t* cfg_root, const socks_cfg_t* socks_cfg, cons
         : NULL;
 
     // setup plugin searching...
+#ifdef GDNSD_BUILTIN_PLUGINS
+    gdnsd_plugins_set_builtins(builtin_plugins);
+#endif
     gdnsd_plugins_set_search_path(psearch_array);
 
     // Phase 1 of service_types config
@@ -53,6 +53,7 @@ typedef struct {
     unsigned max_cname_depth;
     unsigned max_addtl_rrsets;
     unsigned zones_rfc1035_auto_interval;
+    unsigned monitor_threads;
     double zones_rfc1035_quiesce;
 } cfg_t;
 
@@ -48,6 +48,21 @@ typedef struct {
     unsigned prev_arcount; // c->arcount before this rrset was added
 } addtl_rrset_t;
 
+// Cached wire encoding of the last dynamic result of a DYNA rrset for one
+//   address family, see enc_dyn_cached().  These are direct-mapped by
+//   rrset address into a per-context table of DYNENC_SLOTS.
+#define DYNENC_SLOTS 256U
+
+typedef struct {
+    const ltree_rrset_addr_t* rrset; // owner of the slot, NULL if unused
+    uint8_t* addrs;  // copy of the result's raw addresses
+    uint8_t* rrs;    // "count" whole RRs, name included, if rrs_valid
+    unsigned count;  // count of addresses in the result
+    unsigned alloc;  // count that "addrs" and "rrs" have room for
+    unsigned ttl;    // network order
+    bool rrs_valid;  // "rrs" has been built for this result
+} dynenc_t;
+
 // per-thread packet context.
 typedef struct {
     // whether the thread using this context is a udp or tcp thread
@@ -71,8 +86,8 @@ typedef struct {
     //  should be plenty.
     comptarget_t* comptargets;
 
-    // used to pseudo-randomly rotate some RRsets (A, AAAA, and NS)
-    gdnsd_rstate32_t* rand_state;
+    // used to rotate some RRsets (A, AAAA, and NS), see rotate_start()
+    uint32_t rotate_state;
 
     // Allocated at dnspacket startup, needs room for gcfg->max_cname_depth * 256
     uint8_t* dync_store;
@@ -87,6 +102,10 @@ typedef struct {
     // allocated at startup, memset to zero before each callback
     dyn_result_t* dyn;
 
+    // DYNA encoding caches, DYNENC_SLOTS each
+    dynenc_t* dynenc_v4;
+    dynenc_t* dynenc_v6;
+
 // From this point (answer_addr_rrset) on, all of this gets reset to zero
 //  at the start of each request...
 
@@ -130,6 +149,9 @@ static pthread_cond_t stats_init_cond = PTHREAD_COND_INITIALIZER;
 static unsigned stats_initialized = 0;
 static unsigned result_v6_offset = 0;
 
+// Source of client_info_t.query_id, see gdnsd/plugapi.h
+static __thread uint64_t last_query_id = 0;
+
 dnspacket_stats_t** dnspacket_stats;
 
 // Allocates the array of pointers to stats structures, one per I/O thread
@@ -153,13 +175,17 @@ void dnspacket_wait_stats(const socks_cfg_t* socks_cfg) {
 void* dnspacket_ctx_init(const bool is_udp) {
     dnsp_ctx_t* ctx = xcalloc(1, sizeof(dnsp_ctx_t));
 
-    ctx->rand_state = gdnsd_rand32_init();
+    gdnsd_rstate32_t* rand_state = gdnsd_rand32_init();
+    ctx->rotate_state = gdnsd_rand32_get(rand_state);
+    free(rand_state);
     ctx->is_udp = is_udp;
     ctx->addtl_rrsets = xmalloc(gcfg->max_addtl_rrsets * sizeof(addtl_rrset_t));
     ctx->comptargets = xmalloc(COMPTARGETS_MAX * sizeof(comptarget_t));
     ctx->dync_store = xmalloc(gcfg->max_cname_depth * 256);
     ctx->addtl_store = xmalloc(gcfg->max_response);
     ctx->dyn = xmalloc(gdnsd_result_get_alloc());
+    ctx->dynenc_v4 = xcalloc(DYNENC_SLOTS, sizeof(dynenc_t));
+    ctx->dynenc_v6 = xcalloc(DYNENC_SLOTS, sizeof(dynenc_t));
 
     return ctx;
 }
@@ -674,11 +700,25 @@ static unsigned repeat_name(dnsp_ctx_t* ctx, unsigned store_at_offset, unsigned
 //  from the sequence 0->(_total-1), and "i" will wrap-around to zero
 //  as appropriate to stay within the _total while iterating _limit times.
 
+// The starting index for rotating an rrset of "total" members.  Rather
+//   than a PRNG call and a modulus per rrset, this steps a per-context
+//   Weyl sequence (randomly seeded at startup) by the 32-bit golden ratio
+//   and scales it into [0, total) with a multiply and shift.  Successive
+//   starts for any one rrset size are spread more evenly than random
+//   ones, even when every response rotates several rrsets of the same
+//   size, though the starts of the rrsets within one response are
+//   correlated with each other.
+F_NONNULL
+static unsigned rotate_start(dnsp_ctx_t* ctx, const unsigned total) {
+    ctx->rotate_state += 0x9E3779B9U;
+    return (unsigned)(((uint64_t)ctx->rotate_state * total) >> 32);
+}
+
 #define OFFSET_LOOP_START(_total, _limit) \
     {\
         const unsigned _tot = (_total);\
         unsigned _x_count = (_limit);\
-        unsigned i = gdnsd_rand32_get(ctx->rand_state) % _tot;\
+        unsigned i = rotate_start(ctx, _tot);\
         while(_x_count--) {\
 
             // Your code using "i" as an rrset index goes here
@@ -741,6 +781,70 @@ static unsigned enc_aaaa_static(dnsp_ctx_t* ctx, unsigned offset, const ltree_rr
     return offset;
 }
 
+// Encodes "limit" of the "count" address RRs of a dynamic result
+//   (rotated as with OFFSET_LOOP_START) from a cached copy of the whole
+//   set's wire encoding, which is kept per rrset and address family.
+//   Resources commonly give the same result to many clients in a row,
+//   and in that case only the name of each RR needs to be written.
+//   The cache is validated by comparing the addresses and TTL, and the
+//   RRs are only encoded into it once the same result is seen twice in
+//   a row, so that resources whose results vary (e.g. weighted) don't
+//   pay for it.
+// Returns the new offset, or zero if the cache wasn't used, in which
+//   case the caller encodes the RRs itself.
+F_NONNULL
+static unsigned enc_dyn_cached(dnsp_ctx_t* ctx, unsigned offset, const ltree_rrset_addr_t* rrset, const unsigned nameptr, const bool is_addtl, const unsigned ttl, dynenc_t* slots, const uint32_t rrfixed, const uint8_t* addrs, const unsigned addr_len, const unsigned count, const unsigned limit) {
+    // cached RRs are only used when the name is a single compression
+    //   pointer, which is what repeat_name() would store in that case
+    const uint8_t* inpkt = ctx->packet;
+    uint16_t name;
+    if(inpkt[nameptr] & 0xC0)
+        name = gdnsd_get_una16(&inpkt[nameptr]);
+    else if(inpkt[nameptr] && nameptr < 16384)
+        name = htons(0xC000 | nameptr);
+    else
+        return 0;
+
+    uint8_t* packet = is_addtl ? ctx->addtl_store : ctx->packet;
+
+    dynenc_t* de = &slots[((uintptr_t)rrset * 2654435761U >> 8) & (DYNENC_SLOTS - 1U)];
+    const unsigned addrs_len = count * addr_len;
+    if(de->rrset != rrset || de->count != count || de->ttl != ttl || memcmp(de->addrs, addrs, addrs_len)) {
+        if(de->alloc < count) {
+            de->addrs = xrealloc(de->addrs, addrs_len);
+            de->rrs = xrealloc(de->rrs, count * (12U + addr_len));
+            de->alloc = count;
+        }
+        memcpy(de->addrs, addrs, addrs_len);
+        de->rrset = rrset;
+        de->count = count;
+        de->ttl = ttl;
+        de->rrs_valid = false;
+        return 0;
+    }
+
+    const unsigned rr_len = 12U + addr_len;
+    if(!de->rrs_valid) {
+        uint8_t* rr = de->rrs;
+        for(unsigned i = 0; i < count; i++) {
+            gdnsd_put_una32(rrfixed, &rr[2]);
+            gdnsd_put_una32(ttl, &rr[6]);
+            gdnsd_put_una16(htons(addr_len), &rr[10]);
+            memcpy(&rr[12], &addrs[i * addr_len], addr_len);
+            rr += rr_len;
+        }
+        de->rrs_valid = true;
+    }
+
+    const unsigned start = rotate_start(ctx, count);
+    const unsigned first = count - start < limit ? count - start : limit;
+    memcpy(&packet[offset], &de->rrs[start * rr_len], first * rr_len);
+    memcpy(&packet[offset + first * rr_len], de->rrs, (limit - first) * rr_len);
+    for(unsigned i = 0; i < limit; i++)
+        gdnsd_put_una16(name, &packet[offset + i * rr_len]);
+    return offset + limit * rr_len;
+}
+
 F_NONNULL
 static unsigned enc_a_dynamic(dnsp_ctx_t* ctx, unsigned offset, const ltree_rrset_addr_t* rrset, const unsigned nameptr, const bool is_addtl, const unsigned ttl) {
     dmn_assert(ctx->packet);
@@ -759,6 +863,10 @@ static unsigned enc_a_dynamic(dnsp_ctx_t* ctx, unsigned offset, const ltree_rrse
     else
         ctx->ancount += limit_v4;
 
+    const unsigned cached_offset = enc_dyn_cached(ctx, offset, rrset, nameptr, is_addtl, ttl, ctx->dynenc_v4, DNS_RRFIXED_A, dr->storage, 4U, dr->count_v4, limit_v4);
+    if(cached_offset)
+        return cached_offset;
+
     OFFSET_LOOP_START(dr->count_v4, limit_v4)
         offset += repeat_name(ctx, offset, nameptr, is_addtl);
         gdnsd_put_una32(DNS_RRFIXED_A, &packet[offset]);
@@ -792,6 +900,10 @@ static unsigned enc_aaaa_dynamic(dnsp_ctx_t* ctx, unsigned offset, const ltree_r
         ctx->ancount += limit_v6;
 
     const uint8_t* v6 = &dr->storage[result_v6_offset];
+    const unsigned cached_offset = enc_dyn_cached(ctx, offset, rrset, nameptr, is_addtl, ttl, ctx->dynenc_v6, DNS_RRFIXED_AAAA, v6, 16U, dr->count_v6, limit_v6);
+    if(cached_offset)
+        return cached_offset;
+
     OFFSET_LOOP_START(dr->count_v6, limit_v6)
         offset += repeat_name(ctx, offset, nameptr, is_addtl);
         gdnsd_put_una32(DNS_RRFIXED_AAAA, &packet[offset]);
@@ -1934,6 +2046,7 @@ static unsigned answer_from_db_outer(dnsp_ctx_t* ctx, dnspacket_stats_t* stats,
 unsigned process_dns_query(void* ctx_asvoid, dnspacket_stats_t* stats, const dmn_anysin_t* asin, uint8_t* packet, const unsigned packet_len) {
     dnsp_ctx_t* ctx = ctx_asvoid;
     reset_context(ctx);
+    gdnsd_scratch_reset();
     ctx->packet = packet;
 
 /*
@@ -1979,6 +2092,7 @@ unsigned process_dns_query(void* ctx_asvoid, dnspacket_stats_t* stats, const dmn
         hdr->flags2 = DNS_RCODE_NOERROR;
         if(likely(!ctx->chaos)) {
             memcpy(&ctx->client_info.dns_source, asin, sizeof(dmn_anysin_t));
+            ctx->client_info.query_id = ++last_query_id;
             res_offset = answer_from_db_outer(ctx, stats, lqname, res_offset);
         }
         else {
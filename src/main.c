@@ -196,6 +196,9 @@ static void start_threads(socks_cfg_t* socks_cfg) {
     if(pthread_err)
         log_fatal("pthread_create() of monitoring thread failed: %s", dmn_logf_strerror(pthread_err));
 
+    // and any additional monitoring threads
+    gdnsd_mon_start_threads();
+
     // Restore the original mask in the main thread, so
     //  we can continue handling signals like normal
     if(pthread_sigmask(SIG_SETMASK, &sigmask_prev, NULL))
@@ -508,7 +511,7 @@ int main(int argc, char** argv) {
         log_fatal("Could not initialize the mon libev loop");
 
     // set up monitoring, which expects an initially empty loop
-    gdnsd_mon_start(mon_loop);
+    gdnsd_mon_start(mon_loop, cfg->monitor_threads);
 
     // Call plugin pre-run actions
     gdnsd_plugins_action_pre_run();
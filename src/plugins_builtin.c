@@ -0,0 +1,87 @@
+/* Copyright © 2012 Brandon L Black <blblack@gmail.com>
+ *
+ * This file is part of gdnsd.
+ *
+ * gdnsd is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gdnsd is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gdnsd.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+#include "plugins_builtin.h"
+
+#include <gdnsd/plugapi.h>
+#include <gdnsd-prot/plugapi.h>
+
+#include <stddef.h>
+
+// The callbacks are declared weak, so that the ones a plugin doesn't
+//   implement are simply NULL, as they would be from dlsym().  Only
+//   get_api_version is mandatory (and defined by <gdnsd/plugin.h>).
+#define BI_CB_DECL(p, cb) \
+    extern __typeof__(*(gdnsd_ ## cb ## _cb_t)0) plugin_ ## p ## _ ## cb __attribute__((__weak__));
+
+#define BI_DECLS(p) \
+    extern __typeof__(*(gdnsd_apiv_cb_t)0) plugin_ ## p ## _get_api_version; \
+    BI_CB_DECL(p, load_config) \
+    BI_CB_DECL(p, map_res) \
+    BI_CB_DECL(p, pre_run) \
+    BI_CB_DECL(p, iothread_init) \
+    BI_CB_DECL(p, resolve) \
+    BI_CB_DECL(p, exit) \
+    BI_CB_DECL(p, add_svctype) \
+    BI_CB_DECL(p, add_mon_addr) \
+    BI_CB_DECL(p, add_mon_cname) \
+    BI_CB_DECL(p, init_monitors) \
+    BI_CB_DECL(p, start_monitors)
+
+#define BI_ENTRY(p) { \
+    #p, \
+    plugin_ ## p ## _get_api_version, \
+    plugin_ ## p ## _load_config, \
+    plugin_ ## p ## _map_res, \
+    plugin_ ## p ## _pre_run, \
+    plugin_ ## p ## _iothread_init, \
+    plugin_ ## p ## _resolve, \
+    plugin_ ## p ## _exit, \
+    plugin_ ## p ## _add_svctype, \
+    plugin_ ## p ## _add_mon_addr, \
+    plugin_ ## p ## _add_mon_cname, \
+    plugin_ ## p ## _init_monitors, \
+    plugin_ ## p ## _start_monitors, \
+}
+
+BI_DECLS(null)
+BI_DECLS(reflect)
+BI_DECLS(static)
+BI_DECLS(simplefo)
+BI_DECLS(multifo)
+BI_DECLS(weighted)
+BI_DECLS(chash)
+BI_DECLS(metafo)
+BI_DECLS(geoip)
+BI_DECLS(latency)
+
+const gdnsd_plugin_builtin_t builtin_plugins[] = {
+    BI_ENTRY(null),
+    BI_ENTRY(reflect),
+    BI_ENTRY(static),
+    BI_ENTRY(simplefo),
+    BI_ENTRY(multifo),
+    BI_ENTRY(weighted),
+    BI_ENTRY(chash),
+    BI_ENTRY(metafo),
+    BI_ENTRY(geoip),
+    BI_ENTRY(latency),
+    { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL },
+};
@@ -1,4 +1,4 @@
-/* Copyright © 2014 Brandon L Black <blblack@gmail.com>
+/* Copyright © 2012 Brandon L Black <blblack@gmail.com>
  *
  * This file is part of gdnsd.
  *
@@ -17,9 +17,14 @@
  *
  */
 
-#ifndef GDNSD_MISC_PRIV_H
-#define GDNSD_MISC_PRIV_H
+#ifndef GDNSD_PLUGINS_BUILTIN_H
+#define GDNSD_PLUGINS_BUILTIN_H
 
-void gdnsd_rand_meta_init(void);
+#include <gdnsd-prot/plugapi.h>
 
-#endif // GDNSD_MISC_PRIV_H
+// The resolver plugins from this source tree which are linked into the
+//   daemon in --enable-builtin-plugins builds, for
+//   gdnsd_plugins_set_builtins().
+extern const gdnsd_plugin_builtin_t builtin_plugins[];
+
+#endif // GDNSD_PLUGINS_BUILTIN_H
@@ -34,6 +34,8 @@
 #include <fcntl.h>
 #include <time.h>
 #include <string.h>
+#include <stdio.h>
+#include <ctype.h>
 #include <sys/uio.h>
 #include <pthread.h>
 
@@ -68,12 +70,14 @@ typedef enum {
     READING_JUNK
 } http_state_t;
 
-// How many bytes of the request we really read()
-#define HTTP_READ_BYTES 18
+// How many bytes of the request we really read(), at most.  We stop
+//   early at the end of the request line.  The shortest legal request
+//   line ("GET / HTTP/1.0\r\n") is 16 bytes.
+#define HTTP_READ_BYTES 512
 
 typedef struct {
     dmn_anysin_t* asin;
-    char read_buffer[HTTP_READ_BYTES];
+    char read_buffer[HTTP_READ_BYTES + 1];
     struct iovec outbufs[2];
     char* hdr_buf;
     char* data_buf;
@@ -410,24 +414,81 @@ static void statio_fill_outbuf_404(struct iovec* outbufs) {
     memcpy(&outbufs[1].iov_base, &http_404_data[0], sizeof(void*));
 }
 
+// Copies the value of query parameter "name" from the request line
+//   into "out" (of size out_size), %-decoding it.  Returns false if
+//   the parameter isn't present, or is too long.
 F_NONNULL
+static bool get_query_param(const char* query, const char* name, char* out, const unsigned out_size) {
+    const unsigned name_len = strlen(name);
+    if(*query != '?')
+        return false;
+    do {
+        query++;
+        if(!strncmp(query, name, name_len) && query[name_len] == '=') {
+            const char* in = &query[name_len + 1];
+            unsigned len = 0;
+            while(*in && !strchr(" &#\r\n", *in)) {
+                if(len == out_size - 1)
+                    return false;
+                unsigned hexval;
+                if(*in == '%' && isxdigit((unsigned char)in[1]) && isxdigit((unsigned char)in[2])
+                    && sscanf(&in[1], "%2x", &hexval) == 1) {
+                    out[len++] = (char)hexval;
+                    in += 3;
+                }
+                else {
+                    out[len++] = *in++;
+                }
+            }
+            out[len] = '\0';
+            return true;
+        }
+        query += strcspn(query, " &#\r\n");
+    } while(*query == '&');
+    return false;
+}
+
+// The check history output can be large, and is only generated on
+//   demand, so it gets a data buffer sized just for it.
+F_NONNULL
+static void statio_fill_outbuf_history(http_data_t* tdata, const char* query) {
+    char glob[HTTP_READ_BYTES];
+    const bool have_glob = get_query_param(query, "m", glob, sizeof(glob));
+
+    const unsigned max_len = gdnsd_mon_hist_get_max_len();
+    if(max_len > data_buffer_size) {
+        tdata->data_buf = xrealloc(tdata->data_buf, max_len);
+        tdata->outbufs[1].iov_base = tdata->data_buf;
+    }
+
+    struct iovec* outbufs = tdata->outbufs;
+    outbufs[1].iov_len = gdnsd_mon_hist_out_json(outbufs[1].iov_base, have_glob ? glob : NULL);
+
+    const int snp_rv = snprintf(outbufs[0].iov_base, hdr_buffer_size, http_headers, "application/json", (unsigned)outbufs[1].iov_len);
+    dmn_assert(snp_rv > 0);
+    outbufs[0].iov_len = (unsigned)snp_rv;
+}
+
 static void log_watcher_cb(struct ev_loop* loop V_UNUSED, ev_timer* t V_UNUSED, int revents V_UNUSED) {
     statio_log_stats();
 }
 
 typedef void (*ob_cb_t)(struct iovec*, const bool);
+typedef void (*ob_query_cb_t)(http_data_t*, const char*);
 
 static struct {
     const char* match;
     const ob_cb_t func;
+    const ob_query_cb_t query_func; // used instead of func if set
 } http_lookup[]
 = {
     // if one match is another's leading substring, the longer
     //   one must come first in the list!
-    { "GET /json",     statio_fill_outbuf_json },
-    { "GET /csv",      statio_fill_outbuf_csv  },
-    { "GET /html",     statio_fill_outbuf_html },
-    { "GET /",         statio_fill_outbuf_html },
+    { "GET /json/history", NULL,                    statio_fill_outbuf_history },
+    { "GET /json",         statio_fill_outbuf_json, NULL },
+    { "GET /csv",          statio_fill_outbuf_csv,  NULL },
+    { "GET /html",         statio_fill_outbuf_html, NULL },
+    { "GET /",             statio_fill_outbuf_html, NULL },
 };
 
 static const unsigned n_http_lookup = ARRAY_SIZE(http_lookup);
@@ -437,7 +498,9 @@ static const unsigned n_http_lookup = ARRAY_SIZE(http_lookup);
 //   be enough to work for these purposes for now.  The "f=1" query
 //   param must be the first.
 F_NONNULL
-static void process_http_query(char* inbuffer, struct iovec* outbufs) {
+static void process_http_query(http_data_t* tdata) {
+    const char* inbuffer = tdata->read_buffer;
+    struct iovec* outbufs = tdata->outbufs;
     bool matched = false;
     for(unsigned i = 0; i < n_http_lookup; i++) {
         const unsigned msize = strlen(http_lookup[i].match);
@@ -449,9 +512,14 @@ static void process_http_query(char* inbuffer, struct iovec* outbufs) {
                 trailptr++;
             // require termination of the name with space, query, or frag
             if(strchr(" ?#", *trailptr)) {
-                // check for f=1 only as first query arg
-                const bool flush = !memcmp(trailptr, "?f=1", 4);
-                http_lookup[i].func(outbufs, flush);
+                if(http_lookup[i].query_func) {
+                    http_lookup[i].query_func(tdata, trailptr);
+                }
+                else {
+                    // check for f=1 only as first query arg
+                    const bool flush = !memcmp(trailptr, "?f=1", 4);
+                    http_lookup[i].func(outbufs, flush);
+                }
                 matched = true;
             }
             break;
@@ -585,13 +653,14 @@ static void read_cb(struct ev_loop* loop, ev_io* io, const int revents V_UNUSED)
     }
     const size_t recvlen = (size_t)recv_rv;
     tdata->read_done += recvlen;
-    if(tdata->read_done < HTTP_READ_BYTES) return;
+    tdata->read_buffer[tdata->read_done] = '\0';
+    if(tdata->read_done < HTTP_READ_BYTES && !memchr(destination, '\n', recvlen)) return;
 
     // We're relying on the OS to buffer the rest of the request while
     //  we write the response.  After we're done writing we'll drain
     //  the rest of it for a proper lingering close.
 
-    process_http_query(tdata->read_buffer, tdata->outbufs);
+    process_http_query(tdata);
     tdata->state = WRITING_RES;
     ev_io_stop(loop, tdata->read_watcher);
     ev_io_start(loop, tdata->write_watcher);
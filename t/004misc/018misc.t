@@ -7,7 +7,7 @@
 
 use _GDT ();
 use JSON::PP;
-use Test::More tests => 14;
+use Test::More tests => 17;
 
 $optrr = Net::DNS::RR->new(
     type => "OPT",
@@ -916,6 +916,74 @@ _GDT->test_dns(
     stats => [qw/udp_reqs edns udp_edns_big noerror/],
 );
 
+# a dynamic, limited additional-section target named past the 16K mark
+#  can't use the cached DYNA encoding, repeated to check that it matches
+#  both the uncached and cached ones from shorter responses below
+my $dyn_addtl = [
+    'dyn.example.com 86400 A 192.0.2.241',
+    'dyn.example.com 86400 A 192.0.2.242',
+    'dyn.example.com 86400 A 192.0.2.243',
+    'dyn.example.com 86400 AAAA 2001:DB8::241',
+    'dyn.example.com 86400 AAAA 2001:DB8::242',
+];
+
+_GDT->test_dns(
+    resopts => { usevc => 0, igntc => 0, udppacketsize => 32000 },
+    qname => 'sixteen-dyn.example.com', qtype => 'ANY',
+    answer => [
+        'sixteen-dyn.example.com 86400 TXT ' . $sixteen_txt,
+        'sixteen-dyn.example.com 86400 MX 0 dyn.example.com',
+    ],
+    auth => [
+        'example.com 86400 NS ns1.example.com',
+        'example.com 86400 NS ns2.example.com',
+    ],
+    addtl => [
+        @$dyn_addtl,
+        'ns1.example.com 86400 A 192.0.2.1',
+        'ns2.example.com 86400 A 192.0.2.2',
+        $optrr,
+    ],
+    limit_v4 => 2,
+    limit_v6 => 1,
+    rep => 3,
+    stats => [qw/udp_reqs edns udp_edns_big noerror/],
+);
+
+_GDT->test_dns(
+    qname => 'sixteen-dyn.example.com', qtype => 'MX',
+    answer => 'sixteen-dyn.example.com 86400 MX 0 dyn.example.com',
+    auth => [
+        'example.com 86400 NS ns1.example.com',
+        'example.com 86400 NS ns2.example.com',
+    ],
+    addtl => [
+        @$dyn_addtl,
+        'ns1.example.com 86400 A 192.0.2.1',
+        'ns2.example.com 86400 A 192.0.2.2',
+    ],
+    limit_v4 => 2,
+    limit_v6 => 1,
+    rep => 3,
+);
+
+_GDT->test_dns(
+    qname => 'dyn.example.com', qtype => 'A',
+    answer => [@$dyn_addtl[0..2]],
+    auth => [
+        'example.com 86400 NS ns1.example.com',
+        'example.com 86400 NS ns2.example.com',
+    ],
+    addtl => [
+        @$dyn_addtl[3..4],
+        'ns1.example.com 86400 A 192.0.2.1',
+        'ns2.example.com 86400 A 192.0.2.2',
+    ],
+    limit_v4 => 2,
+    limit_v6 => 1,
+    rep => 3,
+);
+
 # send edns-client-subnet while disabled in config...
 _GDT->test_dns(
     qname => 'ns1.example.com', qtype => 'A',
@@ -992,7 +1060,7 @@ sub get_json_flushed_stats {
 
 {
     my $stats1 = get_json_flushed_stats();
-    Test::More::is($stats1->{stats}->{noerror}, 20, "Correct noerror stat via JSON");
+    Test::More::is($stats1->{stats}->{noerror}, 38, "Correct noerror stat via JSON");
     my $stats2 = get_json_flushed_stats();
     Test::More::is($stats2->{stats}->{noerror}, 0, "Zero noerror stat post-flush via JSON");
 }
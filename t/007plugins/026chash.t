@@ -0,0 +1,107 @@
+# plugin_chash tests
+# chash3 is repeated to check that all queries from
+#  the same source get the same single address, and then
+#  queried from many client subnets to check that taking one
+#  address down only remaps the subnets that were using it
+
+use _GDT ();
+use Net::DNS;
+use Test::More tests => 14;
+
+my $soa = 'example.com 86400 SOA ns1.example.com hostmaster.example.com 1 7200 1800 259200 900';
+
+my $pid = _GDT->test_spawn_daemon();
+
+_GDT->test_dns(
+    qname => 'example.com', qtype => 'SOA',
+    answer => $soa,
+);
+
+_GDT->test_dns(
+    qname => 'chash1.example.com', qtype => 'A',
+    answer => 'chash1.example.com 86400 A 192.0.2.180',
+    addtl => 'chash1.example.com 86400 AAAA 2001:DB8::180',
+);
+
+_GDT->test_dns(
+    qname => 'chash1.example.com', qtype => 'AAAA',
+    answer => 'chash1.example.com 86400 AAAA 2001:DB8::180',
+    addtl => 'chash1.example.com 86400 A 192.0.2.180',
+);
+
+# With edns-client-subnet, the scope is the configured prefix
+#  (v4_prefix => 16 in this config, v6_prefix defaults to 56)
+_GDT->test_dns(
+    qname => 'chash1.example.com', qtype => 'A',
+    q_optrr => _GDT::optrr_clientsub(addr_v4 => '198.51.100.0', src_mask => 24),
+    answer => 'chash1.example.com 86400 A 192.0.2.180',
+    addtl => [
+        'chash1.example.com 86400 AAAA 2001:DB8::180',
+        _GDT::optrr_clientsub(addr_v4 => '198.51.100.0', src_mask => 24, scope_mask => 16),
+    ],
+    stats => [qw/udp_reqs edns edns_clientsub noerror/],
+);
+
+_GDT->test_dns(
+    qname => 'chash1.example.com', qtype => 'AAAA',
+    q_optrr => _GDT::optrr_clientsub(addr_v6 => '2001:DB8:1234::', src_mask => 48),
+    answer => 'chash1.example.com 86400 AAAA 2001:DB8::180',
+    addtl => [
+        'chash1.example.com 86400 A 192.0.2.180',
+        _GDT::optrr_clientsub(addr_v6 => '2001:DB8:1234::', src_mask => 48, scope_mask => 56),
+    ],
+    stats => [qw/udp_reqs edns edns_clientsub noerror/],
+);
+
+my %seen;
+my $res = _GDT->get_resolver();
+foreach my $i (1..3) {
+    my $resp = $res->send('chash3.example.com', 'A');
+    _GDT->stats_inc(qw/udp_reqs noerror/);
+    $seen{join(' ', map { $_->address } grep { $_->type eq 'A' } $resp->answer)}++;
+}
+
+is(scalar(keys %seen), 1, 'chash3 answers are consistent');
+like((keys %seen)[0], qr/^192\.0\.2\.18[123]$/, 'chash3 answer is a single configured address');
+
+# The chash3 address for each of many client subnets
+my @subnets = map { "10.$_.0.0" } (0..63);
+sub chash3_map {
+    my %map;
+    foreach my $net (@subnets) {
+        my $query = Net::DNS::Packet->new('chash3.example.com', 'A');
+        $query->push(additional => _GDT::optrr_clientsub(addr_v4 => $net, src_mask => 16));
+        my $resp = $res->send($query);
+        _GDT->stats_inc(qw/udp_reqs edns edns_clientsub noerror/);
+        $map{$net} = join(' ', map { $_->address } grep { $_->type eq 'A' } $resp->answer);
+    }
+    return \%map;
+}
+
+my $before = chash3_map();
+my @on_c2 = grep { $before->{$_} eq '192.0.2.182' } @subnets;
+ok(@on_c2 && @on_c2 < @subnets, 'some but not all subnets use c2');
+
+# When c2 goes down, only its subnets move
+_GDT->write_statefile('admin_state', qq{
+    192.0.2.182/up => DOWN/33
+});
+_GDT->test_log_output(q{admin_state: state of '192.0.2.182/up' forced to DOWN/33, real state is UP/MAX});
+
+my $down = chash3_map();
+my @moved = grep { $down->{$_} ne $before->{$_} } @subnets;
+is_deeply([sort @moved], [sort @on_c2], 'only the subnets of the down address moved');
+ok(!grep({ $down->{$_} !~ /^192\.0\.2\.18[13]$/ } @on_c2), 'moved subnets use the remaining addresses');
+
+# ... and they move back when it comes back up
+_GDT->write_statefile('admin_state', qq{});
+_GDT->test_log_output(q{admin_state: state of '192.0.2.182/up' no longer forced (was forced to DOWN/33), real and current state is UP/MAX});
+
+is_deeply(chash3_map(), $before, 'all subnets return to their original addresses');
+
+_GDT->test_dns(
+    qname => 'example.com', qtype => 'SOA',
+    answer => $soa,
+);
+
+_GDT->test_kill_daemon($pid);
@@ -0,0 +1,126 @@
+# DYNA wire encoding cache tests
+# The first response for a DYNA rrset is encoded directly, and repeats
+#  of the same result come from the cached encoding, so each name is
+#  queried repeatedly and compared with the first, uncached, response.
+
+use _GDT ();
+use Net::DNS;
+use Test::More tests => 10;
+
+# Sends $count queries and returns the ordered answer addresses of each
+sub answer_orders {
+    my ($qname, $qtype, $count) = @_;
+    my $res = _GDT->get_resolver();
+    my @orders;
+    foreach (1..$count) {
+        my $resp = $res->send($qname, $qtype);
+        _GDT->stats_inc(qw/udp_reqs noerror/);
+        push(@orders, [ map { $_->address } grep { $_->type eq $qtype } $resp->answer ]);
+    }
+    return \@orders;
+}
+
+# Whether @$got is $len consecutive entries of @$cycle, wrapping around
+sub is_window {
+    my ($got, $cycle, $len) = @_;
+    return 0 unless @$got == $len;
+    foreach my $start (0..$#$cycle) {
+        return 1 if join(' ', @$got) eq join(' ', map { $cycle->[($start + $_) % @$cycle] } (0..($len - 1)));
+    }
+    return 0;
+}
+
+my $fivec_A = [
+    'fivec-lim.example.com 86400 A 192.0.2.131',
+    'fivec-lim.example.com 86400 A 192.0.2.132',
+    'fivec-lim.example.com 86400 A 192.0.2.133',
+    'fivec-lim.example.com 86400 A 192.0.2.134',
+    'fivec-lim.example.com 86400 A 192.0.2.135',
+];
+
+my $mfo1_A = [
+    'mfo1-lim.example.com 86400 A 192.0.2.101',
+    'mfo1-lim.example.com 86400 A 192.0.2.102',
+    'mfo1-lim.example.com 86400 A 192.0.2.103',
+];
+
+my $mfo1_AAAA = [
+    'mfo1-lim.example.com 86400 AAAA 2001:DB8::101',
+    'mfo1-lim.example.com 86400 AAAA 2001:DB8::102',
+];
+
+my $pid = _GDT->test_spawn_daemon();
+
+# The cached encodings rotate the same way as the uncached one: every
+#  answer is a rotation of the first one, and with a limit, a window of it
+my $all = answer_orders('fivec-all.example.com', 'A', 12);
+my $cycle = $all->[0];
+ok(@$cycle == 5 && !grep({ !is_window($_, $cycle, 5) } @$all),
+    'Repeated unlimited answers are rotations of the uncached one')
+    or diag explain $all;
+
+my $lim = answer_orders('fivec-lim.example.com', 'A', 12);
+ok(!grep({ !is_window($_, $cycle, 2) } @$lim),
+    'Repeated limited answers are windows of the uncached rotation')
+    or diag explain $lim;
+
+_GDT->test_dns(
+    qname => 'fivec-lim.example.com', qtype => 'A',
+    answer => $fivec_A,
+    limit_v4 => 2,
+    rep => 4,
+);
+
+_GDT->test_dns(
+    qname => 'mfo1-lim.example.com', qtype => 'A',
+    answer => $mfo1_A,
+    addtl => $mfo1_AAAA,
+    limit_v4 => 2,
+    limit_v6 => 1,
+    rep => 4,
+);
+
+_GDT->test_dns(
+    qname => 'mfo1-lim.example.com', qtype => 'AAAA',
+    answer => $mfo1_AAAA,
+    addtl => $mfo1_A,
+    limit_v4 => 2,
+    limit_v6 => 1,
+    rep => 4,
+);
+
+# Additional-section addresses, with the same limits
+_GDT->test_dns(
+    qname => 'mx-lim.example.com', qtype => 'MX',
+    answer => 'mx-lim.example.com 86400 MX 0 mfo1-lim.example.com',
+    addtl => [@$mfo1_A, @$mfo1_AAAA],
+    limit_v4 => 2,
+    limit_v6 => 1,
+    rep => 4,
+);
+
+# ... and the same rrset in the answer section again afterwards
+_GDT->test_dns(
+    qname => 'mfo1-lim.example.com', qtype => 'A',
+    answer => $mfo1_A,
+    addtl => $mfo1_AAAA,
+    limit_v4 => 2,
+    limit_v6 => 1,
+    rep => 4,
+);
+
+_GDT->test_dns(
+    qname => 'mfo1.example.com', qtype => 'AAAA',
+    answer => [
+        'mfo1.example.com 86400 AAAA 2001:DB8::101',
+        'mfo1.example.com 86400 AAAA 2001:DB8::102',
+    ],
+    addtl => [
+        'mfo1.example.com 86400 A 192.0.2.101',
+        'mfo1.example.com 86400 A 192.0.2.102',
+        'mfo1.example.com 86400 A 192.0.2.103',
+    ],
+    rep => 4,
+);
+
+_GDT->test_kill_daemon($pid);
@@ -0,0 +1,96 @@
+# http_status keepalive tests, against a scripted test http server
+#  which frames its responses differently for each service type's
+#  url_path (see ka_server.pl), and counts connections and requests.
+
+use _GDT ();
+use File::Temp qw/tmpnam/;
+use JSON::PP;
+use Test::More tests => 14;
+
+# We use dns_port_2 as a custom http listener
+#  for something to monitor
+my $http_port = $_GDT::EXTRA_PORT;
+my $state_file = tmpnam();
+my $count_file = "$_GDT::OUTDIR/ka_counts";
+my $server_script = File::Spec->catfile($FindBin::Bin, 'ka_server.pl');
+unlink($count_file);
+my $http_pid = fork();
+if(!defined $http_pid) { diag "Fork failed: $!"; BAIL_OUT($!); }
+if(!$http_pid) { # child, execute test http server
+    exec($^X, $server_script, $http_port, $state_file, $count_file);
+}
+
+# Avoid racing the test http server
+while(!-f $state_file) {
+    select(undef, undef, undef, 0.1); # 100ms
+}
+
+unlink($state_file);
+
+my $pid = _GDT->test_spawn_daemon('etc008');
+
+_GDT->test_dns(
+    qname => 'ns1.example.com', qtype => 'A',
+    answer => 'ns1.example.com 86400 A 192.0.2.254',
+);
+
+_GDT->test_dns(
+    qname => 'ka.example.com', qtype => 'A',
+    answer => 'ka.example.com 60 A 127.0.0.1',
+);
+
+# Let a few more rounds of checks (interval = 2) happen
+sleep(7);
+
+my %counts;
+open(my $count_fh, '<', $count_file) or die "Cannot open $count_file: $!";
+while(<$count_fh>) {
+    my ($path, $conns, $reqs) = split;
+    $counts{$path} = { conns => $conns, reqs => $reqs };
+}
+close($count_fh);
+
+# Responses framed by Content-Length or chunked encoding leave the
+#  connection open for the following checks
+foreach my $path (qw{/length /chunked}) {
+    my $c = $counts{$path};
+    ok($c && $c->{reqs} >= 3 && $c->{conns} == 1,
+        "All checks of $path used one connection")
+        or diag explain $c;
+}
+
+# "Connection: close" gets a new connection for each check, as does
+#  a server closing idle connections, where the check on the closed
+#  connection is retried on a new one
+foreach my $path (qw{/close /idle}) {
+    my $c = $counts{$path};
+    ok($c && $c->{reqs} >= 3 && $c->{conns} == $c->{reqs},
+        "Each check of $path used a new connection")
+        or diag explain $c;
+}
+
+# ... and none of the checks failed
+my $ua = LWP::UserAgent->new(
+    protocols_allowed => ['http'],
+    requests_redirectable => [],
+    max_size => 10240,
+    timeout => 3,
+);
+foreach my $svc (qw/ka_length ka_chunked ka_close ka_idle/) {
+    my $response = $ua->get("http://127.0.0.1:${_GDT::HTTP_PORT}/json/history?m=127.0.0.1/${svc}");
+    my $hist = $response && $response->code == 200 && decode_json($response->content)->{history};
+    my $checks = $hist && @$hist == 1 && $hist->[0]->{checks};
+    ok($checks && @$checks >= 3 && !grep({ !$_->[1] } @$checks),
+        "All checks of 127.0.0.1/${svc} succeeded")
+        or diag explain $hist;
+}
+
+_GDT->test_dns(
+    qname => 'ka.example.com', qtype => 'A',
+    answer => 'ka.example.com 60 A 127.0.0.1',
+);
+
+_GDT->test_kill_daemon($pid);
+_GDT->test_kill_daemon($http_pid);
+
+END { kill(9, $http_pid) if($http_pid && kill(0, $http_pid)) }
@@ -0,0 +1,107 @@
+# Scripted HTTP/1.1 server for the http_status keepalive tests.
+#  The response framing is selected by the request path:
+#   /length  - Content-Length body, connection kept open
+#   /chunked - chunked body with a trailer, connection kept open
+#   /close   - Content-Length body with "Connection: close", then closes
+#   /idle    - Content-Length body, then closes the connection without
+#              notice once it has been idle for a short while
+#  After every request it rewrites $countf with one line per path,
+#  giving the number of connections and requests seen for it.
+
+use strict;
+use warnings;
+use IO::Socket::INET;
+use IO::Select;
+use Time::HiRes qw/time/;
+
+my ($portnum, $statef, $countf) = @ARGV;
+
+$SIG{PIPE} = 'IGNORE';
+
+my $d = IO::Socket::INET->new(
+    LocalAddr => '0.0.0.0',
+    LocalPort => $portnum,
+    Proto => 'tcp',
+    Listen => 16,
+    ReuseAddr => 1,
+);
+if(!$d) {
+    die "Cannot start test http server at address 0.0.0.0:${portnum}: $!"
+}
+
+open(my $statefh, '>', $statef);
+print $statefh "$$\n";
+close($statefh);
+
+my %responses = (
+    '/length' => "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello",
+    '/chunked' => "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+        . "3\r\nhel\r\n2;ext=1\r\nlo\r\n0\r\nX-Trailer: 1\r\n\r\n",
+    '/close' => "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 5\r\n\r\nhello",
+    '/idle' => "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello",
+);
+
+my $IDLE_CLOSE = 0.5;
+
+my %conns; # per-path connection counts
+my %reqs; # per-path request counts
+my %client; # per-socket state: buf, path, idle_since
+
+sub write_counts {
+    open(my $fh, '>', "${countf}.tmp") or die "Cannot write ${countf}.tmp: $!";
+    print $fh "$_ $conns{$_} $reqs{$_}\n" for sort keys %reqs;
+    close($fh);
+    rename("${countf}.tmp", $countf) or die "Cannot rename to ${countf}: $!";
+}
+
+sub drop_client {
+    my ($sel, $c) = @_;
+    $sel->remove($c);
+    delete $client{$c};
+    $c->close;
+}
+
+my $sel = IO::Select->new($d);
+while(1) {
+    foreach my $c ($sel->can_read(0.1)) {
+        if($c == $d) {
+            my $new = $d->accept or next;
+            $sel->add($new);
+            $client{$new} = { buf => '', path => undef, idle_since => undef };
+            next;
+        }
+
+        my $cl = $client{$c};
+        my $rv = sysread($c, $cl->{buf}, 4096, length($cl->{buf}));
+        if(!$rv) {
+            drop_client($sel, $c);
+            next;
+        }
+
+        while($cl->{buf} =~ s/^GET (\S+) HTTP\/1\.[01]\r?\n.*?\r?\n\r?\n//s) {
+            my $path = $1;
+            my $resp = $responses{$path} || "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+            if(!defined $cl->{path}) {
+                $cl->{path} = $path;
+                $conns{$path}++;
+            }
+            $reqs{$path}++;
+            write_counts();
+            syswrite($c, $resp);
+            $cl->{idle_since} = time();
+            if($path eq '/close') {
+                drop_client($sel, $c);
+                last;
+            }
+        }
+    }
+
+    # close idle /idle connections, as servers with short keepalive
+    #   timeouts do, to make the monitor's next check fail and retry
+    foreach my $c ($sel->handles) {
+        next if $c == $d;
+        my $cl = $client{$c};
+        drop_client($sel, $c)
+            if $cl->{path} && $cl->{path} eq '/idle' && time() - $cl->{idle_since} > $IDLE_CLOSE;
+    }
+}
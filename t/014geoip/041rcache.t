@@ -0,0 +1,72 @@
+# geoip result_cache tests
+# Each client network is queried more than once, so that later queries
+#  can be answered from the result cache, and the cached results have to
+#  follow the edns-client-subnet scope, map reloads, and monitored states.
+
+use _GDT ();
+use Test::More tests => 13;
+
+my $nets_file = "$_GDT::OUTDIR/etc/geoip/rcache.nets";
+
+sub rc_test {
+    my ($net, $src_mask, $addr, $ttl) = @_;
+    _GDT->test_dns(
+        qname => 'rc.example.com', qtype => 'A',
+        q_optrr => _GDT::optrr_clientsub(addr_v4 => $net, src_mask => $src_mask),
+        answer => "rc.example.com $ttl A $addr",
+        addtl => _GDT::optrr_clientsub(addr_v4 => $net, src_mask => $src_mask, scope_mask => 8),
+        stats => [qw/udp_reqs edns edns_clientsub noerror/],
+        rep => 3,
+    );
+}
+
+my $pid = _GDT->test_spawn_daemon('etc3');
+
+# queries within the cached scope get the same answer and scope
+rc_test('10.2.3.0', 24, '192.0.2.2', 42);
+rc_test('10.200.0.0', 16, '192.0.2.2', 42);
+
+# ... and outside of it they miss
+rc_test('11.2.3.0', 24, '192.0.2.3', 42);
+rc_test('10.2.3.0', 24, '192.0.2.2', 42);
+
+# a map reload invalidates the cached results
+open(my $nets_fh, '>', "${nets_file}.tmp")
+    or die "Cannot open '${nets_file}.tmp' for writing: $!";
+print $nets_fh "10.0.0.0/8 => [ dc3, dc1 ]\n11.0.0.0/8 => [ dc2, dc1 ]\n";
+close($nets_fh)
+    or die "Cannot close '${nets_file}.tmp': $!";
+# make sure the mtime changes, whatever the filesystem's resolution
+my $mtime = time() + 2;
+utime($mtime, $mtime, "${nets_file}.tmp");
+rename("${nets_file}.tmp", $nets_file)
+    or die "Cannot rename('${nets_file}.tmp', '$nets_file'): $!";
+
+_GDT->test_log_output(q{plugin_geoip: map 'rcmap': Change detected in nets file});
+_GDT->test_log_output(q{plugin_geoip: map 'rcmap' runtime db});
+
+rc_test('10.2.3.0', 24, '192.0.2.3', 42);
+rc_test('11.2.3.0', 24, '192.0.2.2', 42);
+
+# ... as does a change of monitored state
+_GDT->write_statefile('admin_state', qq{
+    192.0.2.3/up => DOWN/33
+});
+_GDT->test_log_output(q{admin_state: state of '192.0.2.3/up' forced to DOWN/33, real state is UP/MAX});
+
+rc_test('10.2.3.0', 24, '192.0.2.1', 33);
+rc_test('11.2.3.0', 24, '192.0.2.2', 42);
+
+_GDT->write_statefile('admin_state', qq{});
+_GDT->test_log_output(q{admin_state: state of '192.0.2.3/up' no longer forced (was forced to DOWN/33), real and current state is UP/MAX});
+
+rc_test('10.2.3.0', 24, '192.0.2.3', 42);
+
+_GDT->test_kill_daemon($pid);
+
+# result_cache is limited to 64 entries
+_GDT->test_spawn_daemon_setup('etc4');
+my $checkconf_out = qx{$_GDT::GDNSD_BIN -c $_GDT::OUTDIR/etc checkconf 2>&1};
+ok($? && $checkconf_out =~ /'result_cache' must be an integer in the range 0 - 64/,
+    'Out of range result_cache fails the config')
+    or diag $checkconf_out;
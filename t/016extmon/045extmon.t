@@ -2,7 +2,7 @@
 
 use _GDT ();
 use Net::DNS;
-use Test::More tests => 10;
+use Test::More tests => 12;
 
 my $pid = _GDT->test_spawn_daemon();
 
@@ -26,6 +26,16 @@ _GDT->test_dns(
     answer => 'down.example.com 40 A 127.0.0.1',
 );
 
+_GDT->test_dns(
+    qname => 'pup.example.com', qtype => 'A',
+    answer => 'pup.example.com 25 A 127.0.0.1',
+);
+
+_GDT->test_dns(
+    qname => 'pdown.example.com', qtype => 'A',
+    answer => 'pdown.example.com 40 A 127.0.0.1',
+);
+
 _GDT->test_dns(
     qname => 'down-100-5.example.com', qtype => 'A',
     answer => 'down-100-5.example.com 40 A 127.0.0.1',
@@ -0,0 +1,32 @@
+# extmon start phases shorter than the check itself
+
+use _GDT ();
+use Net::DNS;
+use Test::More tests => 6;
+
+# the checks record any overlap of two checks of the same address here
+$ENV{GDT_EXTMON_STATE} = "$_GDT::OUTDIR/var/lib/gdnsd";
+
+my $pid = _GDT->test_spawn_daemon('etc002');
+
+_GDT->test_dns(
+    qname => 'slow1.example.com', qtype => 'A',
+    answer => 'slow1.example.com 50 A 127.0.0.1',
+);
+
+# past the first regular checks of the 2.5 and 5 second phases
+sleep(6);
+
+ok(!-e "$ENV{GDT_EXTMON_STATE}/overlap", 'no overlapping checks');
+
+_GDT->test_dns(
+    qname => 'slow1.example.com', qtype => 'A',
+    answer => 'slow1.example.com 50 A 127.0.0.1',
+);
+
+_GDT->test_dns(
+    qname => 'slow2.example.com', qtype => 'A',
+    answer => 'slow2.example.com 50 A 127.0.0.2',
+);
+
+_GDT->test_kill_daemon($pid);
@@ -1,6 +1,7 @@
 use _GDT ();
 use Net::DNS;
-use Test::More tests => 7;
+use JSON::PP;
+use Test::More tests => 8;
 
 _GDT->test_spawn_daemon_setup();
 
@@ -42,4 +43,18 @@ _GDT->test_dns(
     answer => 'd.example.com 66 A 127.0.0.1',
 );
 
+# direct states aren't check results, so they have no check history
+{
+    my $ua = LWP::UserAgent->new(
+        protocols_allowed => ['http'],
+        requests_redirectable => [],
+        max_size => 10240,
+        timeout => 3,
+    );
+    my $response = $ua->get("http://127.0.0.1:${_GDT::HTTP_PORT}/json/history?m=127.0.0.1/extf_d");
+    my $hist = $response && $response->code == 200 && decode_json($response->content)->{history};
+    Test::More::ok($hist && @$hist == 1 && !@{$hist->[0]->{checks}},
+        "No check history for direct extfile states");
+}
+
 _GDT->test_kill_daemon($pid);
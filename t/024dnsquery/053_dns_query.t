@@ -0,0 +1,87 @@
+# dns_query monitoring tests
+
+use _GDT ();
+use JSON::PP;
+use File::Temp qw/tmpnam/;
+use Test::More tests => 9;
+
+# We use the extra port as a custom DNS responder
+#  for something to monitor
+my $dns_port = $_GDT::EXTRA_PORT;
+my $state_file = tmpnam();
+my $server_script = File::Spec->catfile($FindBin::Bin, 'server.pl');
+my $dns_pid = fork();
+if(!defined $dns_pid) { diag "Fork failed: $!"; BAIL_OUT($!); }
+if(!$dns_pid) { # child, execute test dns responder
+    exec($^X, $server_script, $dns_port, $state_file);
+}
+
+# Avoid racing the test dns responder
+while(!-f $state_file) {
+    select(undef, undef, undef, 0.1); # 100ms
+}
+
+unlink($state_file);
+
+my $pid = _GDT->test_spawn_daemon();
+
+_GDT->test_dns(
+    qname => 'up.example.com', qtype => 'A',
+    answer => 'up.example.com 25 A 127.0.0.1',
+);
+
+_GDT->test_dns(
+    qname => 'refused.example.com', qtype => 'A',
+    answer => 'refused.example.com 40 A 127.0.0.1',
+);
+
+_GDT->test_dns(
+    qname => 'refused-ok.example.com', qtype => 'A',
+    answer => 'refused-ok.example.com 25 A 127.0.0.1',
+);
+
+my $_useragent;
+sub get_json_history {
+    my $query = shift;
+    $_useragent ||= LWP::UserAgent->new(
+        protocols_allowed => ['http'],
+        requests_redirectable => [],
+        max_size => 10240,
+        timeout => 3,
+    );
+    my $response = $_useragent->get("http://127.0.0.1:${_GDT::HTTP_PORT}/json/history$query");
+    if(!$response) {
+        die "JSON history fetch: No response...";
+    }
+    elsif($response->code != 200) {
+        die "JSON history fetch: Response code was not 200. Response dump:\n" . $response->as_string("\n");
+    }
+
+    return decode_json($response->content)->{history};
+}
+
+{
+    my $hist = get_json_history('?m=127.0.0.1/dnsq_up');
+    my $checks = (@$hist == 1) && $hist->[0]->{checks};
+    Test::More::ok($checks && @$checks && $checks->[-1]->[1] && defined $checks->[-1]->[2],
+        "Check history of a single service via JSON");
+    $hist = get_json_history('?m=%2A%2Fdnsq_refused%2A');
+    Test::More::is(scalar(@$hist), 2, "Check history selected by glob via JSON");
+}
+
+# The shared UDP sockets' watchers are stopped after the initial round,
+#  so that it can finish, and restarted for runtime monitoring: with
+#  interval = 2, a few more runtime checks must all have succeeded
+sleep(5);
+{
+    my $hist = get_json_history('?m=127.0.0.1/dnsq_up');
+    my $checks = (@$hist == 1) && $hist->[0]->{checks};
+    Test::More::ok($checks && @$checks >= 3 && !grep({ !$_->[1] } @$checks),
+        "Runtime UDP checks succeed after the initial round")
+        or Test::More::diag(explain($hist));
+}
+
+_GDT->test_kill_daemon($pid);
+_GDT->test_kill_daemon($dns_pid);
+
+END { kill(9, $dns_pid) if($dns_pid && kill(0, $dns_pid)) }
@@ -0,0 +1,31 @@
+use IO::Socket::INET;
+
+# A minimal DNS responder for the dns_query monitoring tests.  It answers
+#   every query by echoing it back as a response, with the rcode REFUSED
+#   if the query mentions "refused", and NOERROR otherwise.
+
+my ($portnum, $statef) = @ARGV;
+
+my $sock = IO::Socket::INET->new(
+    LocalAddr => '127.0.0.1',
+    LocalPort => $portnum,
+    Proto => 'udp',
+    ReuseAddr => 1,
+);
+if(!$sock) {
+    die "Cannot start DNS responder at address 127.0.0.1:${portnum}: $@"
+}
+
+open(my $statefh, '>', $statef);
+print $statefh "$$\n";
+close($statefh);
+
+while(1) {
+    my $query;
+    my $peer = $sock->recv($query, 4096);
+    next unless defined $peer && length($query) >= 12;
+    my ($id, $flags1) = unpack('nC', $query);
+    my $rcode = ($query =~ /refused/i) ? 5 : 0;
+    my $resp = pack('nCC', $id, $flags1 | 0x80, $rcode) . substr($query, 4);
+    $sock->send($resp, 0, $peer);
+}
@@ -0,0 +1,72 @@
+# icmp monitoring tests
+
+use _GDT ();
+use JSON::PP;
+use Socket qw/PF_INET SOCK_DGRAM SOCK_RAW/;
+use Test::More;
+
+# The plugin needs either an unprivileged ping socket
+#  (net.ipv4.ping_group_range) or root for a raw socket, which it
+#  opens before dropping privileges
+my $icmp_proto = getprotobyname('icmp') || 1;
+my $can_ping = socket(my $sock, PF_INET, SOCK_DGRAM, $icmp_proto)
+    || socket($sock, PF_INET, SOCK_RAW, $icmp_proto);
+my $no_ping_reason = "Cannot create an ICMP socket: $!";
+close($sock) if $can_ping;
+
+plan tests => 7;
+
+my $_useragent;
+sub get_json_history {
+    my $query = shift;
+    $_useragent ||= LWP::UserAgent->new(
+        protocols_allowed => ['http'],
+        requests_redirectable => [],
+        max_size => 10240,
+        timeout => 3,
+    );
+    my $response = $_useragent->get("http://127.0.0.1:${_GDT::HTTP_PORT}/json/history$query");
+    if(!$response) {
+        die "JSON history fetch: No response...";
+    }
+    elsif($response->code != 200) {
+        die "JSON history fetch: Response code was not 200. Response dump:\n" . $response->as_string("\n");
+    }
+
+    return decode_json($response->content)->{history};
+}
+
+# config-only runs don't fail without the sockets, so this works regardless
+_GDT->test_spawn_daemon_setup();
+ok(!system(qq{$_GDT::GDNSD_BIN -c $_GDT::OUTDIR/etc checkconf >/dev/null 2>&1}),
+    'checkconf does not need ICMP sockets');
+
+SKIP: {
+skip $no_ping_reason, 5 unless $can_ping;
+
+# The socket's read watcher is stopped after the initial round of checks,
+#  or startup would never finish, so this also covers that
+my $pid = _GDT->test_spawn_daemon();
+
+_GDT->test_dns(
+    qname => 'up.example.com', qtype => 'A',
+    answer => 'up.example.com 25 A 127.0.0.1',
+);
+
+_GDT->test_dns(
+    qname => 'down.example.com', qtype => 'A',
+    answer => 'down.example.com 40 A 192.0.2.1',
+);
+
+# ... and it's restarted for runtime monitoring: with interval = 2,
+#  a few more runtime checks of 127.0.0.1 must all have succeeded
+sleep(5);
+my $hist = get_json_history('?m=127.0.0.1/ping');
+my $checks = (@$hist == 1) && $hist->[0]->{checks};
+ok($checks && @$checks >= 3 && !grep({ !$_->[1] } @$checks),
+    'Runtime ICMP checks succeed after the initial round')
+    or diag explain $hist;
+
+_GDT->test_kill_daemon($pid);
+
+}
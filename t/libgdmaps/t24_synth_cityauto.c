@@ -0,0 +1,152 @@
+/* Copyright © 2012 Brandon L Black <blblack@gmail.com>
+ *
+ * This file is part of gdnsd.
+ *
+ * gdnsd-plugin-geoip is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gdnsd-plugin-geoip is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gdnsd.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Unit test + load-time benchmark for city-auto mode with many
+//   datacenters, using a synthetic GeoIP City (REV1, IPv4) database
+//   generated on the fly.  Every /16 gets its own pseudo-random city
+//   location, which produces many thousands of unique dclists.
+
+#include <config.h>
+#include "gdmaps_test.h"
+
+#include <gdnsd/alloc.h>
+#include <gdnsd/log.h>
+#include <gdnsd/paths.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <tap.h>
+
+#define SYNTH_DB "synth-city-v4.dat"
+#define SYNTH_DEPTH 16U
+#define SYNTH_LEAVES (1U << SYNTH_DEPTH)
+#define SYNTH_NODES (SYNTH_LEAVES - 1U)
+#define SYNTH_NUM_DCS 40U
+#define GEOIP_CITY_EDITION_REV1 2
+
+// dc #k is at the coordinates below; the leaf at index (k+1)*256+7,
+//   a.k.a. the network "(k+1).7.0.0/16", is placed exactly on it.
+static double dc_lat(const unsigned k) { return -50.0 + (k % 8U) * 15.0; }
+static double dc_lon(const unsigned k) { return -160.0 + (k / 8U) * 70.0; }
+static unsigned dc_leaf(const unsigned k) { return (k + 1U) * 256U + 7U; }
+
+static void put24(uint8_t* p, const unsigned v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+}
+
+static unsigned raw_coord(const double deg) {
+    return (unsigned)(int)(deg * 10000.0 + 1800000.0);
+}
+
+// Record layout: country, region\0, city\0, postal\0, lat[3], lon[3]
+#define REC_SIZE 10U
+
+static void synth_db_write(const char* pathname) {
+    // offset 0 of the record area is the "not found" record
+    const unsigned rec_area = 1U + SYNTH_LEAVES * REC_SIZE;
+    const unsigned size = SYNTH_NODES * 6U + rec_area + 7U;
+    uint8_t* db = xcalloc(1, size);
+
+    for(unsigned node = 0; node < SYNTH_NODES; node++) {
+        for(unsigned side = 0; side < 2; side++) {
+            const unsigned child = node * 2U + 1U + side;
+            unsigned ptr = child;
+            if(child >= SYNTH_NODES)
+                ptr = SYNTH_NODES + 1U + (child - SYNTH_NODES) * REC_SIZE;
+            put24(&db[node * 6U + side * 3U], ptr);
+        }
+    }
+
+    uint32_t rstate = 12345;
+    uint8_t* recs = &db[SYNTH_NODES * 6U + 1U];
+    for(unsigned leaf = 0; leaf < SYNTH_LEAVES; leaf++) {
+        rstate = rstate * 1103515245U + 12345U;
+        double lat = -60.0 + (rstate >> 8) % 1300000U * 0.0001;
+        rstate = rstate * 1103515245U + 12345U;
+        double lon = -180.0 + (rstate >> 8) % 3600000U * 0.0001;
+        for(unsigned k = 0; k < SYNTH_NUM_DCS; k++) {
+            if(leaf == dc_leaf(k)) {
+                lat = dc_lat(k);
+                lon = dc_lon(k);
+            }
+        }
+        uint8_t* rec = &recs[leaf * REC_SIZE];
+        rec[0] = 225; // "US", irrelevant for auto mode
+        // region, city, postal are all empty strings
+        put24(&rec[4], raw_coord(lat));
+        put24(&rec[7], raw_coord(lon));
+    }
+
+    uint8_t* info = &db[size - 7U];
+    info[0] = info[1] = info[2] = 0xFF;
+    info[3] = GEOIP_CITY_EDITION_REV1;
+    put24(&info[4], SYNTH_NODES);
+
+    FILE* fp = fopen(pathname, "w");
+    if(!fp || fwrite(db, 1, size, fp) != size || fclose(fp))
+        log_fatal("Cannot write synthetic database '%s'", pathname);
+    free(db);
+}
+
+int main(int argc V_UNUSED, char* argv[] V_UNUSED) {
+    gdmaps_test_init(getenv("TEST_CFDIR"));
+    plan_tests(SYNTH_NUM_DCS);
+
+    char* dbpath = gdnsd_resolve_path_cfg(SYNTH_DB, "geoip");
+    synth_db_write(dbpath);
+    free(dbpath);
+
+    char cfg[8192];
+    unsigned len = (unsigned)snprintf(cfg, sizeof(cfg),
+        "synth_map => { geoip_db => " SYNTH_DB ", datacenters => [");
+    for(unsigned k = 0; k < SYNTH_NUM_DCS; k++)
+        len += (unsigned)snprintf(&cfg[len], sizeof(cfg) - len, "%s dc%02u", k ? "," : "", k);
+    len += (unsigned)snprintf(&cfg[len], sizeof(cfg) - len, " ], auto_dc_coords => {");
+    for(unsigned k = 0; k < SYNTH_NUM_DCS; k++)
+        len += (unsigned)snprintf(&cfg[len], sizeof(cfg) - len, " dc%02u => [ %.1f, %.1f ]", k, dc_lat(k), dc_lon(k));
+    snprintf(&cfg[len], sizeof(cfg) - len, " }, auto_dc_limit => 5 }");
+
+    struct timespec t_start, t_end;
+    clock_gettime(CLOCK_MONOTONIC, &t_start);
+    gdmaps_t* gdmaps = gdmaps_test_load(cfg);
+    clock_gettime(CLOCK_MONOTONIC, &t_end);
+    diag("Synthetic city db (%u locations, %u dcs) load time: %.3f ms",
+        SYNTH_LEAVES, SYNTH_NUM_DCS,
+        (t_end.tv_sec - t_start.tv_sec) * 1000.0
+            + (t_end.tv_nsec - t_start.tv_nsec) / 1000000.0);
+
+    const unsigned map_idx = (unsigned)gdmaps_name2idx(gdmaps, "synth_map");
+    for(unsigned k = 0; k < SYNTH_NUM_DCS; k++) {
+        char addr_txt[32];
+        snprintf(addr_txt, sizeof(addr_txt), "%u.%u.1.1", dc_leaf(k) >> 8, dc_leaf(k) & 0xFF);
+        client_info_t cinfo;
+        cinfo.edns_client_mask = 128U;
+        unsigned scope = 175U;
+        if(gdnsd_anysin_getaddrinfo(addr_txt, NULL, &cinfo.edns_client))
+            log_fatal("Cannot parse address '%s'", addr_txt);
+        const uint8_t* dclist = gdmaps_lookup(gdmaps, map_idx, &cinfo, &scope);
+        ok(dclist[0] == k + 1U, "gdmaps_lookup(synth_map, %s) prefers dc%02u (got %s)",
+            addr_txt, k, gdmaps_logf_dclist(gdmaps, map_idx, dclist));
+    }
+
+    exit(exit_status());
+}
@@ -0,0 +1,113 @@
+/* Copyright © 2012 Brandon L Black <blblack@gmail.com>
+ *
+ * This file is part of gdnsd.
+ *
+ * gdnsd-plugin-geoip is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gdnsd-plugin-geoip is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gdnsd.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Unit test for publication of maps via "shm_file", checking
+//   libgdmap_shm lookups against the in-process lookups.
+
+#include <config.h>
+#include "gdmaps_test.h"
+
+#include <gdnsd/alloc.h>
+#include <gdnsd/log.h>
+#include <gdnsd/paths.h>
+#include <gdnsd/gdmap_shm.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <tap.h>
+
+#define SHM_FILE "t25_shm_publish.map"
+
+static const char* addrs[] = {
+    "192.0.2.1",
+    "192.0.2.223",
+    "10.1.2.3",
+    "79.125.18.68",
+    "::10.1.2.3",
+    "::FFFF:69.58.186.119",
+    "::FFFF:0:10.255.255.255",
+    "64:ff9b::69.58.186.119",
+    "2002:453A:BA77::",
+    "2001::BAC5:4588",
+    "1234:5678::",
+    "2600:3c00::f03c:91ff:fe96:6a4f",
+};
+#define NUM_ADDRS (sizeof(addrs) / sizeof(addrs[0]))
+
+int main(int argc V_UNUSED, char* argv[] V_UNUSED) {
+    gdmaps_test_init(getenv("TEST_CFDIR"));
+    plan_tests(5 + (NUM_ADDRS * 2));
+
+    char* shm_path = gdnsd_resolve_path_cfg(SHM_FILE, NULL);
+    unlink(shm_path);
+
+    char cfg[1024];
+    snprintf(cfg, sizeof(cfg),
+        "my_prod_map => {"
+        " datacenters => [ dc01, dc02 ],"
+        " shm_file => \"%s\","
+        " nets => {"
+        "  192.0.2.128/25 => [ dc02 ],"
+        "  10.0.0.0/8 => dc02,"
+        "  1234::/16 => dc01"
+        " }"
+        "}", shm_path);
+    gdmaps_t* gdmaps = gdmaps_test_load(cfg);
+    const unsigned map_idx = (unsigned)gdmaps_name2idx(gdmaps, "my_prod_map");
+
+    // initial publication happens asynchronously in the reload thread
+    gdmaps_setup_watchers(gdmaps);
+    gdmap_shm_t* shm = NULL;
+    const struct timespec wait = { 0, 10000000 };
+    for(unsigned i = 0; !shm && i < 1000; i++) {
+        shm = gdmap_shm_open(shm_path);
+        if(!shm)
+            nanosleep(&wait, NULL);
+    }
+    if(!shm)
+        log_fatal("Cannot open published map '%s': %s", shm_path, dmn_logf_errno());
+
+    ok(gdmap_shm_generation(shm) > 0, "published generation is non-zero");
+    ok(gdmap_shm_dc_count(shm) == 2, "published dc count is correct");
+    ok(!strcmp(gdmap_shm_dc_name(shm, 2), "dc02"), "published dc name is correct");
+    ok(!gdmap_shm_dc_name(shm, 3), "invalid dcnum returns NULL");
+    ok(gdmap_shm_refresh(shm) == 0, "refresh without a new generation is a no-op");
+
+    for(unsigned i = 0; i < NUM_ADDRS; i++) {
+        client_info_t cinfo;
+        cinfo.edns_client_mask = 128U;
+        if(gdnsd_anysin_getaddrinfo(addrs[i], NULL, &cinfo.edns_client))
+            log_fatal("Cannot parse address '%s'", addrs[i]);
+        unsigned scope = 175U;
+        const uint8_t* dclist = gdmaps_lookup(gdmaps, map_idx, &cinfo, &scope);
+        unsigned shm_scope = 175U;
+        const uint8_t* shm_dclist = gdmap_shm_lookup(shm, &cinfo.edns_client.sa, &shm_scope);
+        ok(shm_dclist && !strcmp((const char*)shm_dclist, (const char*)dclist),
+            "gdmap_shm_lookup(%s) returns dclist %s", addrs[i],
+            gdmaps_logf_dclist(gdmaps, map_idx, dclist));
+        ok(shm_scope == scope, "gdmap_shm_lookup(%s) returns scope %u (got %u)", addrs[i], scope, shm_scope);
+    }
+
+    gdmap_shm_close(shm);
+    unlink(shm_path);
+    free(shm_path);
+    exit(exit_status());
+}
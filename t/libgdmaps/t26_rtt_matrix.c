@@ -0,0 +1,163 @@
+/* Copyright © 2012 Brandon L Black <blblack@gmail.com>
+ *
+ * This file is part of gdnsd.
+ *
+ * gdnsd-plugin-geoip is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gdnsd-plugin-geoip is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gdnsd.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Unit test for rtt_db maps, using a small RTT matrix
+//   generated on the fly (see libgdmaps/rttdb.h for the format),
+//   which is then rewritten to check rtt_hysteresis on reload
+
+#include <config.h>
+#include "gdmaps_test.h"
+#include "rttdb.h"
+
+#include <gdnsd/alloc.h>
+#include <gdnsd/log.h>
+#include <gdnsd/misc.h>
+#include <gdnsd/paths.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <utime.h>
+#include <tap.h>
+
+#define RTT_DB "rtt-matrix.dat"
+#define NONE RTTDB_RTT_NONE
+
+// The file has an extra datacenter "dcX" that the map doesn't know
+static const char* file_dcs[] = { "dc03", "dcX", "dc01", "dc02" };
+#define FILE_NUM_DCS 4U
+
+typedef struct {
+    const char* addr;
+    unsigned mask;
+    uint16_t rtts[FILE_NUM_DCS];
+} rtt_net_t;
+
+static const rtt_net_t rtt_nets[] = {
+    { "192.0.2.0",      24, { NONE, 1,   50,   20 } },
+    { "198.51.100.0",   24, { 5,    1,   10,   10 } },
+    { "2001:DB8::",     32, { 20,   1,   30, NONE } },
+};
+#define RTT_NUM_NETS (sizeof(rtt_nets) / sizeof(rtt_nets[0]))
+
+// Each network gets a new best datacenter, within or beyond
+//   the hysteresis of 5 from the previous first choice
+static const rtt_net_t rtt_nets_reload[RTT_NUM_NETS] = {
+    { "192.0.2.0",      24, { NONE, 1,   18,   20 } }, // within (2)
+    { "198.51.100.0",   24, { 20,   1,   10,   12 } }, // beyond (10)
+    { "2001:DB8::",     32, { 20,   1,   15, NONE } }, // at the limit (5)
+};
+
+static void rtt_db_write(const char* pathname, const rtt_net_t* nets) {
+    const unsigned rec_size = RTTDB_REC_SIZE(FILE_NUM_DCS);
+    const unsigned names_size = FILE_NUM_DCS * RTTDB_DCNAME_LEN;
+    const unsigned size = (unsigned)sizeof(rttdb_hdr_t) + names_size + RTT_NUM_NETS * rec_size;
+    uint8_t* db = xcalloc(1, size);
+
+    rttdb_hdr_t hdr;
+    memcpy(hdr.magic, RTTDB_MAGIC, sizeof(hdr.magic));
+    hdr.version = RTTDB_VERSION;
+    hdr.endian = RTTDB_ENDIAN;
+    hdr.num_dcs = FILE_NUM_DCS;
+    hdr.num_nets = RTT_NUM_NETS;
+    memcpy(db, &hdr, sizeof(hdr));
+
+    for(unsigned i = 0; i < FILE_NUM_DCS; i++)
+        strcpy((char*)&db[sizeof(hdr) + i * RTTDB_DCNAME_LEN], file_dcs[i]);
+
+    for(unsigned i = 0; i < RTT_NUM_NETS; i++) {
+        uint8_t* rec = &db[sizeof(hdr) + names_size + i * rec_size];
+        dmn_anysin_t asin;
+        if(gdnsd_anysin_getaddrinfo(nets[i].addr, NULL, &asin))
+            log_fatal("Cannot parse address '%s'", nets[i].addr);
+        if(asin.sa.sa_family == AF_INET) {
+            memcpy(&rec[12], &asin.sin.sin_addr.s_addr, 4);
+            rec[16] = (uint8_t)(nets[i].mask + 96U);
+        }
+        else {
+            memcpy(rec, asin.sin6.sin6_addr.s6_addr, 16);
+            rec[16] = (uint8_t)nets[i].mask;
+        }
+        memcpy(&rec[20], nets[i].rtts, sizeof(nets[i].rtts));
+    }
+
+    // replace it atomically, with a later mtime, for the reload case
+    char* tmppath = gdnsd_str_combine(pathname, ".tmp", NULL);
+    FILE* fp = fopen(tmppath, "w");
+    if(!fp || fwrite(db, 1, size, fp) != size || fclose(fp))
+        log_fatal("Cannot write RTT matrix '%s'", tmppath);
+    const time_t mtime = time(NULL) + 2;
+    const struct utimbuf times = { mtime, mtime };
+    if(utime(tmppath, &times) || rename(tmppath, pathname))
+        log_fatal("Cannot replace RTT matrix '%s': %s", pathname, dmn_logf_errno());
+    free(tmppath);
+    free(db);
+}
+
+static const char cfg[] = QUOTE(
+   my_prod_map => {
+    rtt_db => rtt-matrix.dat,
+    rtt_hysteresis => 5,
+    datacenters => [ dc01, dc02, dc03 ],
+    nets => {
+     198.51.100.128/25 => [ dc02 ],
+    }
+   }
+);
+
+gdmaps_t* gdmaps = NULL;
+
+int main(int argc V_UNUSED, char* argv[] V_UNUSED) {
+    gdmaps_test_init(getenv("TEST_CFDIR"));
+    plan_tests(LOOKUP_CHECK_NTESTS * 9 + 1);
+
+    char* dbpath = gdnsd_resolve_path_cfg(RTT_DB, "geoip");
+    rtt_db_write(dbpath, rtt_nets);
+
+    gdmaps = gdmaps_test_load(cfg);
+    // lowest RTT first, unmeasured last
+    gdmaps_test_lookup_check(gdmaps, "my_prod_map", "192.0.2.1", "\2\1\3", 24);
+    // ties stay in datacenter order
+    gdmaps_test_lookup_check(gdmaps, "my_prod_map", "198.51.100.1", "\3\1\2", 25);
+    // nets override the matrix
+    gdmaps_test_lookup_check(gdmaps, "my_prod_map", "198.51.100.129", "\2", 25);
+    gdmaps_test_lookup_check(gdmaps, "my_prod_map", "2001:DB8::1", "\3\1\2", 32);
+    // the rest of the address space gets the default list
+    gdmaps_test_lookup_check(gdmaps, "my_prod_map", "203.0.113.1", "\1\2\3", 5);
+    gdmaps_test_lookup_check(gdmaps, "my_prod_map", "::FFFF:192.0.2.1", "\2\1\3", 120);
+
+    // reload a changed matrix through the map's file watcher, which
+    //   waits for the change to settle before updating the tree
+    const unsigned map_idx = (unsigned)gdmaps_name2idx(gdmaps, "my_prod_map");
+    const unsigned gen = gdmaps_map_gen(gdmaps, map_idx);
+    gdmaps_setup_watchers(gdmaps);
+    rtt_db_write(dbpath, rtt_nets_reload);
+    free(dbpath);
+    const struct timespec wait = { 0, 100000000 };
+    for(unsigned i = 0; gdmaps_map_gen(gdmaps, map_idx) == gen && i < 600; i++)
+        nanosleep(&wait, NULL);
+    ok(gdmaps_map_gen(gdmaps, map_idx) != gen, "changed RTT matrix was reloaded");
+
+    // the previous first choice is kept within the hysteresis...
+    gdmaps_test_lookup_check(gdmaps, "my_prod_map", "192.0.2.1", "\2\1\3", 24);
+    gdmaps_test_lookup_check(gdmaps, "my_prod_map", "2001:DB8::1", "\3\1\2", 32);
+    // ... and replaced beyond it
+    gdmaps_test_lookup_check(gdmaps, "my_prod_map", "198.51.100.1", "\1\2\3", 25);
+    exit(exit_status());
+}